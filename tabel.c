@@ -4,6 +4,8 @@
  *  Standar: C89 + POSIX.1-2008
  * ============================================================ */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,6 +16,17 @@
 #include <ctype.h>
 #include <errno.h>
 #include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <stddef.h>
 
 /* ============================================================
  * Konstanta
@@ -24,6 +37,28 @@
 #define UNDO_MAX   2048
 #define MAX_FORMULA_LENGTH 256
 #define MAX_NAMA_FILE 256
+#define MAKS_NAMA_STATUS 160
+#define INTERVAL_FRAME_MS 16
+#define MAKS_KLIEN_SOKET 16
+#define MAKS_BARIS_SOKET (MAX_TEXT * MAKS_KOLOM + 64)
+#define MAKS_KELUARAN_SOKET (4 * 1024 * 1024)
+#define POTONGAN_TAIL (256 * 1024)
+#define INTERVAL_TAIL_MS 50
+#define INTERVAL_PANTAU_MS 500
+#define MAKS_SHEET 16
+#define MAKS_NAMA_SHEET 32
+#define MAKS_GAYA 256
+#define MAKS_KUNCI_SORT 8
+#define MAKS_THREAD_SORT 8
+#define MAKS_FANIN_SORT 16
+#define AMBANG_SORT_PARALEL 4096
+#define MAKS_PREDIKAT_FILTER 8
+#define MAKS_KUNCI_PIVOT 4
+#define MAKS_NILAI_PIVOT 8
+#define MAKS_THREAD_PIVOT 8
+#define AMBANG_PIVOT_PARALEL 4096
+#define BIT_KATA ((int)(sizeof(unsigned long) * CHAR_BIT))
+#define JUMLAH_KATA_FILTER ((MAKS_BARIS + BIT_KATA - 1) / BIT_KATA)
 
 /* Unicode garis */
 #define TL "\xE2\x94\x8C"
@@ -54,6 +89,17 @@
 /* Alignment */
 enum align { LEFT, CENTER, RIGHT };
 
+/* Jenis frame yang menunggu digambar, urut dari yang paling ringan */
+enum jenis_frame {
+    FRAME_TIDAK, FRAME_NAVIGASI, FRAME_GULIR, FRAME_SELEKSI, FRAME_PENUH
+};
+
+/* Fungsi agregat pivot */
+enum fungsi_agregat { AGG_SUM, AGG_COUNT, AGG_AVG, AGG_MIN, AGG_MAX };
+
+/* Jenis predikat filter */
+enum jenis_filter { FILTER_SAMA, FILTER_MEMUAT, FILTER_RENTANG };
+
 /* ============================================================
  * Struktur Data
  * ============================================================ */
@@ -68,11 +114,52 @@ struct konfigurasi {
     int prev_y;
 };
 
+/* Format sel; tabel_gaya menyimpan tiap kombinasi sekali */
+struct gaya {
+    enum align align;
+    int desimal;    /* angka ditampilkan dengan n desimal, -1 apa adanya */
+    int warna;      /* rgb teks, -1 bawaan */
+    int tebal;
+};
+
+/* Baris awal..(awal run berikutnya - 1) memakai tabel_gaya[gaya] */
+struct run_gaya {
+    int awal;
+    int gaya;
+};
+
+/* Gaya satu kolom sebagai run urut per baris. Tanpa run berarti seluruh
+ * kolom bergaya bawaan; petunjuk = run yang terakhir ditemukan */
+struct kolom_gaya {
+    struct run_gaya *run;
+    int jumlah;
+    int petunjuk;
+};
+
+/* Potret teks sel kolom x1..x2 pada sejumlah baris; tiap teks di sel
+ * memegang satu referensi pool */
+struct potret_area {
+    const char **sel;   /* jumlah * (x2 - x1 + 1) teks, baris demi baris */
+    int *baris;         /* baris sheet untuk tiap baris potret */
+    int jumlah;
+    int kapasitas;
+    int x1;
+    int x2;
+};
+
 struct op {
     int x;
     int y;
     char before[MAX_TEXT];
     char after[MAX_TEXT];
+    int grup;       /* op dengan grup sama di-undo/redo bersama */
+    int *perm;      /* != NULL: permutasi baris y..y2, kolom x..x2 */
+    int x2;
+    int y2;
+    int sheet;      /* sheet tempat op terjadi */
+    int gaya_ada;   /* != 0: op gaya, `gaya` = run kolom x sebelumnya */
+    struct kolom_gaya gaya;
+    struct potret_area *area; /* != NULL: isi wilayah sebelum/sesudah op */
 };
 
 struct buffer {
@@ -81,17 +168,171 @@ struct buffer {
     size_t capacity;
 };
 
+/* Penghitung kinerja untuk HUD status bar; frame diukur dari awal
+ * render/redraw sampai flush */
+struct kinerja {
+    double awal_frame;
+    double frame_us;
+    size_t byte_frame;
+    unsigned long sel_frame;
+    unsigned long sel_berjalan;
+    unsigned long syscall;
+    unsigned long syscall_tombol;
+    unsigned long syscall_per_tombol;
+    double formula_us;
+    long rss_kb;
+    double rss_berikut;
+};
+
+/* Koneksi soket: baris permintaan yang belum lengkap dan jawaban yang
+ * belum terkirim */
+struct klien_soket {
+    int fd;
+    struct buffer masuk;
+    struct buffer keluar;
+};
+
+/* Template garis grid yang sudah disusun untuk satu layout kolom */
+struct templat_grid {
+    int valid;
+    int col_start;
+    int col_end;
+    int versi;
+    int lebar;              /* lebar tampilan satu garis */
+    unsigned long frame;    /* frame terakhir yang memakainya */
+    struct buffer atas;
+    struct buffer pemisah;
+    struct buffer isi;
+    struct buffer bawah;
+};
+
+/* Satu area grid di layar dengan rentang kolom/baris kontigu dan titik
+ * asalnya sendiri; freeze panes membagi layar hingga empat pane */
+struct pane {
+    int x_awal;
+    int y_awal;
+    int col_start;
+    int col_end;
+    int row_start;
+    int row_end;
+};
+
+/* Persegi seleksi yang sudah dipotong ke satu pane; kosong bila x1 > x2
+ * atau y1 > y2 */
+struct persegi_sel {
+    int x1, y1;
+    int x2, y2;
+};
+
+/* Sisi outline seleksi yang melewati sebuah sel */
+#define SISI_ATAS   1
+#define SISI_BAWAH  2
+#define SISI_KIRI   4
+#define SISI_KANAN  8
+
+/* Satu baris tampilan hasil wrap isi sel */
+struct potongan_baris {
+    short awal;     /* offset byte di isi sel */
+    short panjang;  /* jumlah byte */
+    short lebar;    /* lebar tampilan dalam kolom terminal */
+};
+
+/* Posisi wrap isi satu sel, berlaku untuk lebar kolom dan versi_isi
+ * saat dihitung */
+struct letak_sel {
+    int lebar;
+    int versi;
+    int jumlah;
+    struct potongan_baris garis[1];   /* dialokasikan untuk `jumlah` potongan */
+};
+
+/* Atribut SGR yang dipakai UI; warna -1 = default terminal, selain itu
+ * 0xRRGGBB */
+struct atribut_sgr {
+    int fg;
+    int bg;
+    int tebal;
+};
+
+/* Satu predikat auto-filter pada satu kolom */
+struct predikat_filter {
+    int kolom;
+    enum jenis_filter jenis;
+    char teks[MAX_TEXT];
+    const char *intern;   /* teks di pool, diisi tiap evaluasi (FILTER_SAMA) */
+    double min;
+    double max;
+};
+
+/* Satu teks di pool intern. Sel menyimpan pointer ke `teks`, jadi dua
+ * sel sama jika pointernya sama; ref = jumlah sel yang memakainya */
+struct teks_intern {
+    struct teks_intern *berikut;
+    unsigned int hash;
+    unsigned int ref;
+    char teks[1];   /* dialokasikan seukuran teks beserta NUL */
+};
+
+/* Satu sheet workbook. Sheet aktif dipakai lewat pointer global isi,
+ * gaya_kolom, lebar_kolom dan tinggi_baris; cfg, freeze dan filter
+ * disimpan di sini hanya selama sheet tidak aktif */
+struct sheet {
+    char nama[MAKS_NAMA_SHEET];
+    struct konfigurasi cfg;
+    int beku_baris, beku_kolom;
+    struct predikat_filter predikat[MAKS_PREDIKAT_FILTER];
+    int jumlah_predikat;
+    const char **baris[MAKS_BARIS];
+    struct kolom_gaya gaya[MAKS_KOLOM];
+    int tinggi_baris[MAKS_BARIS];
+    int lebar_kolom[MAKS_KOLOM];
+};
+
+/* Indeks hash satu kolom untuk VLOOKUP/MATCH/XLOOKUP */
+struct indeks_kolom {
+    int valid;
+    int jumlah_baris;
+    unsigned int mask;
+    int *kepala;          /* bucket -> baris pertama, -1 jika kosong */
+    int *berikut;         /* baris -> baris berikutnya di bucket sama */
+    unsigned int *hash;   /* hash isi tiap baris */
+};
+
 /* ============================================================
  * Data Global
  * ============================================================ */
-static char isi[MAKS_BARIS][MAKS_KOLOM][MAX_TEXT];
-static enum align align_sel[MAKS_BARIS][MAKS_KOLOM];
-static int lebar_kolom[MAKS_KOLOM];
-static int tinggi_baris[MAKS_BARIS];
+/* Sel sheet aktif: isi[y][x] menunjuk teks di pool intern. Baris
+ * dialokasikan saat pertama kali ditulis; baris yang belum pernah
+ * ditulis menunjuk ke baris_kosong, halaman read-only bersama berisi
+ * teks_kosong, sehingga membaca sel kosong tidak butuh pemeriksaan dan
+ * menulis tanpa siapkan_baris() langsung SIGSEGV */
+static const char ***isi;
+static const char **baris_kosong;
+static struct kolom_gaya *gaya_kolom;
+static int *lebar_kolom;
+static int *tinggi_baris;
+
+/* Workbook */
+static struct sheet *sheet[MAKS_SHEET];
+static int jumlah_sheet = 0;
+static int sheet_aktif = 0;
+
+/* Gaya bersama semua sheet; indeks 0 = gaya bawaan */
+static struct gaya tabel_gaya[MAKS_GAYA] = { { LEFT, -1, -1, 0 } };
+static int jumlah_gaya = 1;
+
+/* Pool intern bersama semua sheet; teks kosong tidak masuk pool */
+static const char teks_kosong[] = "";
+static struct teks_intern **tabel_intern;
+static unsigned int mask_intern;
+static unsigned long jumlah_intern = 0;
 
 /* Clipboard */
 static char clipboard[MAX_TEXT];
-static char clipboard_area[MAKS_BARIS][MAKS_KOLOM][MAX_TEXT];
+/* Teks area yang disalin, berurutan per baris; indeks_clip menunjuk
+ * awal tiap sel. Ukurannya mengikuti isi area, bukan ukuran sheet */
+static char *clipboard_area;
+static size_t *indeks_clip;
 static int clip_x1 = -1, clip_y1 = -1, clip_x2 = -1, clip_y2 = -1;
 static int clip_has_area = 0;
 
@@ -99,6 +340,8 @@ static int clip_has_area = 0;
 static struct op undo_stack[UNDO_MAX];
 static struct op redo_stack[UNDO_MAX];
 static int undo_top = 0, redo_top = 0;
+static int undo_grup = 0;
+static int transaksi_aktif = 0;
 
 /* Terminal */
 static struct termios simpan_term;
@@ -112,11 +355,169 @@ static int prev_sel_x = -1, prev_sel_y = -1;
 /* Status */
 static char status_msg[256] = "";
 
+/* Perintah command line terakhir menulis hasil formula ke sel aktif */
+static int hasil_di_sel_aktif = 0;
+
 /* Double buffering */
 static struct buffer back_buffer;
 static int use_double_buffer = 1;
 
+/* Synchronized output (DEC mode 2026) jika terminal mendukung */
+static int sinkron_output = 0;
+
+/* Frame keluar sebagai daftar segmen untuk writev: rentang back_buffer
+ * (data == NULL) atau data statis (template grid) yang dirujuk tanpa
+ * disalin dan tetap hidup sampai flush */
+struct segmen_frame {
+    const char *data;
+    size_t awal;
+    size_t panjang;
+};
+#define MAKS_SEGMEN_FRAME 256
+#define MIN_SEGMEN_RUJUKAN 64
+static struct segmen_frame segmen_frame[MAKS_SEGMEN_FRAME];
+static int jumlah_segmen = 0;
+static size_t awal_segmen = 0;
+static unsigned long nomor_frame = 0;
+
+/* Berapa kali buffer mana pun harus realloc; nol dalam keadaan tunak */
+static unsigned long buffer_tumbuh = 0;
+
+#ifdef TABEL_BENCH
+/* Terminal virtual untuk benchmark render: ukuran tetap, keluaran dihitung
+ * lalu dibuang */
+struct ukuran_render {
+    unsigned long byte;
+    unsigned long escape;
+    unsigned long tulis;
+};
+static struct ukuran_render ukuran;
+static int bench_lebar = 120, bench_tinggi = 40;
+#endif
+
+/* Selalu dihitung; hanya ditampilkan saat HUD aktif (tombol h) */
+static struct kinerja kinerja;
+static int hud_aktif = 0;
+
+/* State output: atribut yang diminta kode gambar, atribut yang berlaku di
+ * terminal, dan posisi kursor (-1 = tidak diketahui) */
+static struct atribut_sgr sgr_diminta = { -1, -1, 0 };
+static struct atribut_sgr sgr_terminal = { -1, -1, 0 };
+static int sgr_terminal_valid = 0;
+static int kursor_x = -1, kursor_y = -1;
+
+/* Palet warna keluaran: 24 (truecolor), 256 atau 16 */
+static int mode_warna = 24;
+
+/* Terminal mengisi ECH/EL dengan background yang berlaku (bce) */
+static int terminal_bce = 1;
+
+/* Input yang terbaca bersama jawaban query terminal */
+static unsigned char input_tunda[256];
+static int input_tunda_awal = 0, input_tunda_n = 0;
+
+/* Makro keyboard: register a-z berisi byte input mentah. Byte yang sedang
+ * diputar ulang dilayani sebelum stdin; selama antrean belum habis output
+ * dibuang dan layar digambar ulang sekali di akhir */
+#define JUMLAH_REGISTER_MAKRO 26
+#define MAKS_ANTREAN_MAKRO (16u * 1024u * 1024u)
+static struct buffer register_makro[JUMLAH_REGISTER_MAKRO];
+static int makro_rekam = -1;
+static struct buffer antrean_makro;
+static size_t antrean_makro_awal = 0;
+static int input_dari_makro = 0;
+
+/* Frame pacing: perubahan state hanya menandai frame tertunda; frame
+ * digambar saat input sudah habis dan interval refresh sudah lewat */
+static enum jenis_frame frame_tertunda = FRAME_TIDAK;
+static double waktu_frame_terakhir = 0.0;
+
+/* Sel aktif yang highlight-nya terakhir digambar */
+static int sel_tergambar_x = -1, sel_tergambar_y = -1;
+
+/* Outline seleksi yang sedang tampil (anchor dan sudut aktif) */
+static int seleksi_tergambar = 0;
+static int seleksi_tergambar_ax, seleksi_tergambar_ay;
+static int seleksi_tergambar_bx, seleksi_tergambar_by;
+
+/* Viewport yang sedang tampil di layar, acuan untuk gulir hardware */
+static int tampil_valid = 0;
+static int tampil_x_awal, tampil_y_awal;
+static int tampil_baris_awal, tampil_baris_akhir;
+static int tampil_kolom_awal, tampil_kolom_akhir;
+static int tampil_versi, tampil_lebar, tampil_tinggi;
+
+/* Template grid untuk dua layout kolom sekaligus (pane beku dan pane
+ * utama); versi_lebar naik setiap lebar_kolom berubah */
+static struct templat_grid templat_grid[2];
+static int versi_lebar = 0;
+
+/* Freeze panes: baris 0..beku_baris-1 dan kolom 0..beku_kolom-1 tetap
+ * tampil sementara sisa sheet digulir */
+static int beku_baris = 0, beku_kolom = 0;
+
+/* Cache indeks lookup per kolom, diinvalidasi saat isi kolom berubah */
+static struct indeks_kolom indeks_lookup[MAKS_KOLOM];
+
+/* Cache wrap per sel: dibuat saat sel pertama digambar, dibuang saat isi
+ * sel berubah; versi_isi naik untuk perubahan massal (load, sort) */
+static struct letak_sel *cache_letak[MAKS_BARIS][MAKS_KOLOM];
+static int versi_isi = 0;
+
+/* Auto-filter: bitmap baris terlihat + prefix count per kata untuk
+ * rank/select, sehingga lompat ke baris terlihat berikutnya tidak perlu
+ * memindai baris tersembunyi */
+static struct predikat_filter predikat_filter[MAKS_PREDIKAT_FILTER];
+static int jumlah_predikat = 0;
+static int filter_aktif = 0;
+static int filter_baris = 0;
+static unsigned long peta_terlihat[JUMLAH_KATA_FILTER];
+static int rank_terlihat[JUMLAH_KATA_FILTER + 1];
+
+/* Batas memori untuk sort eksternal (:SORTMEM dalam MB) */
+static size_t batas_memori_sort = (size_t)256 * 1024 * 1024;
+
+/* Server soket Unix (--socket / :SOCKET), dilayani dari loop utama */
+static int soket_server = -1;
+static char jalur_soket[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static struct klien_soket klien_soket[MAKS_KLIEN_SOKET];
+
+/* Baris yang diubah SET dalam siklus poll berjalan, dipotret sebelum
+ * ditimpa; satu siklus menjadi satu op undo wilayah */
+static struct potret_area *potret_soket = NULL;
+static unsigned long baris_potret_soket[JUMLAH_KATA_FILTER];
+
+/* Sumber -f yang diikuti: sisa baris yang belum lengkap, jumlah baris
+ * data di sheet dan kapasitas ring */
+static int tail_fd = -1;
+static int tail_pipa = 0, tail_csv = 1, tail_ada_lagi = 0;
+static off_t tail_offset = 0;
+static double tail_cek_berikut = 0.0;
+static struct buffer tail_sisa;
+static int tail_baris = 0, tail_batas = MAKS_BARIS;
+static long tail_dibuang = 0;
+
+/* File yang dipantau perubahannya: hash tiap baris mentah di disk dan
+ * hash isi sel tiap baris saat sinkron terakhir */
+static char file_pantau[MAX_NAMA_FILE];
+static int file_pantau_csv = 0;
+static struct stat stat_pantau;
+static double pantau_berikut = 0.0;
+static int baris_file = 0;
+static int sheet_pantau = 0;
+static unsigned int hash_mentah[MAKS_BARIS];
+static unsigned int hash_isi_dasar[MAKS_BARIS];
+
+static int lebar_terminal(void);
+static int tinggi_terminal(void);
 static void update_seleksi_status(const struct konfigurasi *cfg);
+static int sort_file_eksternal(const char *sumber, const char *tujuan,
+                               int kolom, int menurun);
+static int buka_server_soket(const char *jalur);
+static void tutup_server_soket(void);
+static const char *cari_intern(const char *teks);
+static int parse_sel(const struct konfigurasi *cfg, const char *token,
+                     int *x, int *y);
 
 /* ============================================================
  * Fungsi Utilitas Buffer
@@ -150,10 +551,12 @@ static int perluas_buffer(struct buffer *buf, size_t ukuran_baru)
     }
     buf->data = data_baru;
     buf->capacity = ukuran_baru;
+    buffer_tumbuh++;
     return 0;
 }
 
-static int tulis_buffer(struct buffer *buf, const char *data, size_t panjang)
+/* Pastikan ada ruang untuk panjang byte lagi */
+static int siapkan_ruang_buffer(struct buffer *buf, size_t panjang)
 {
     if (buf->size + panjang > buf->capacity) {
         size_t kapasitas_baru = buf->capacity * 2;
@@ -164,2230 +567,8018 @@ static int tulis_buffer(struct buffer *buf, const char *data, size_t panjang)
             return -1;
         }
     }
+    return 0;
+}
+
+static int tulis_buffer(struct buffer *buf, const char *data, size_t panjang)
+{
+#ifdef TABEL_BENCH
+    ukuran.tulis++;
+#endif
+    if (siapkan_ruang_buffer(buf, panjang) < 0) {
+        return -1;
+    }
     memcpy(buf->data + buf->size, data, panjang);
     buf->size += panjang;
     return 0;
 }
 
+/* Tambahkan panjang salinan byte c sekaligus */
+static int isi_buffer(struct buffer *buf, char c, size_t panjang)
+{
+#ifdef TABEL_BENCH
+    ukuran.tulis++;
+#endif
+    if (siapkan_ruang_buffer(buf, panjang) < 0) {
+        return -1;
+    }
+    memset(buf->data + buf->size, c, panjang);
+    buf->size += panjang;
+    return 0;
+}
+
 static void reset_buffer(struct buffer *buf)
 {
     buf->size = 0;
 }
 
+/* Jam monotonik dalam milidetik, untuk jejak, frame dan penjadwalan */
+static double waktu_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
 /* ============================================================
- * Fungsi Utilitas Terminal
+ * Fungsi Trace
  * ============================================================ */
-static void pos(int x, int y)
+/* TABEL_TRACE=jejak.json: span B/E berformat trace-event (Perfetto,
+ * chrome://tracing) untuk dispatch tombol, frame, flush, file I/O dan
+ * formula. Hanya thread utama yang mencatat, jadi array peristiwa tidak
+ * butuh kunci; isinya ditulis saat loop menunggu input atau saat penuh */
+#define MAKS_PERISTIWA_JEJAK 16384
+
+struct peristiwa_jejak {
+    const char *nama;
+    double ts;
+    int arg;
+    char fase;
+};
+
+static struct peristiwa_jejak jejak[MAKS_PERISTIWA_JEJAK];
+static int jumlah_jejak = 0, kedalaman_jejak = 0, jejak_pertama = 1;
+static FILE *berkas_jejak = NULL;
+
+static void tulis_jejak(void)
 {
-    char esc[32];
-    int n = snprintf(esc, sizeof(esc), "\033[%d;%dH", y, x);
-    if (n > 0) {
-        if (use_double_buffer) {
-            tulis_buffer(&back_buffer, esc, (size_t)n);
-        } else {
-            write(STDOUT_FILENO, esc, (size_t)n);
+    int i;
+    if (!berkas_jejak) {
+        return;
+    }
+    for (i = 0; i < jumlah_jejak; i++) {
+        const struct peristiwa_jejak *e = &jejak[i];
+        fprintf(berkas_jejak, "%s{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":1",
+                jejak_pertama ? "" : ",\n", e->fase, e->ts, (int)getpid());
+        if (e->nama) {
+            fprintf(berkas_jejak, ",\"name\":\"%s\"", e->nama);
+        }
+        if (e->arg >= 0) {
+            fprintf(berkas_jejak, ",\"args\":{\"tombol\":%d}", e->arg);
         }
+        fputc('}', berkas_jejak);
+        jejak_pertama = 0;
     }
+    jumlah_jejak = 0;
+    fflush(berkas_jejak);
 }
 
-static void tulis_teks(const char *teks, size_t panjang)
+static void catat_jejak(const char *nama, char fase, int arg)
 {
-    if (use_double_buffer) {
-        tulis_buffer(&back_buffer, teks, panjang);
-    } else {
-        write(STDOUT_FILENO, teks, panjang);
+    struct peristiwa_jejak *e;
+
+    if (jumlah_jejak == MAKS_PERISTIWA_JEJAK) {
+        tulis_jejak();
     }
+    e = &jejak[jumlah_jejak++];
+    e->nama = nama;
+    e->ts = waktu_ms() * 1e3;
+    e->arg = arg;
+    e->fase = fase;
 }
 
-static void flush(void)
+static void jejak_mulai(const char *nama)
 {
-    if (use_double_buffer) {
-        write(STDOUT_FILENO, back_buffer.data, back_buffer.size);
-        reset_buffer(&back_buffer);
-    } else {
-        fflush(stdout);
+    if (berkas_jejak) {
+        catat_jejak(nama, 'B', -1);
+        kedalaman_jejak++;
     }
 }
 
-static void masuk_alt(void)
+/* Span dispatch satu tombol; kode byte pertama ikut sebagai argumen */
+static void jejak_mulai_tombol(unsigned char ch)
 {
-    tulis_teks("\033[?1049h\033[?25l", 12);
-    if (!use_double_buffer) {
-        flush();
+    if (berkas_jejak) {
+        catat_jejak("tombol", 'B', ch);
+        kedalaman_jejak++;
     }
 }
 
-static void keluar_alt(void)
+static void jejak_selesai(void)
 {
-    tulis_teks("\033[?25h\033[?1049l", 12);
-    if (!use_double_buffer) {
-        flush();
+    if (berkas_jejak && kedalaman_jejak > 0) {
+        catat_jejak(NULL, 'E', -1);
+        kedalaman_jejak--;
     }
 }
 
-static void bersih(void)
+static void buka_jejak(void)
 {
-    tulis_teks(ESC_CLR ESC_HOME, 7);
-    if (!use_double_buffer) {
-        flush();
+    const char *nama = getenv("TABEL_TRACE");
+    if (!nama || !*nama) {
+        return;
+    }
+    berkas_jejak = fopen(nama, "w");
+    if (berkas_jejak) {
+        fputs("[\n", berkas_jejak);
     }
 }
 
-static void pulihkan_terminal(void)
+/* Span yang masih terbuka (mis. tombol q) ditutup sebelum ditulis */
+static void tutup_jejak(void)
 {
-    if (mode_raw) {
-        tcsetattr(STDIN_FILENO, TCSANOW, &simpan_term);
-        mode_raw = 0;
+    if (!berkas_jejak) {
+        return;
     }
+    while (kedalaman_jejak > 0) {
+        jejak_selesai();
+    }
+    tulis_jejak();
+    fputs("\n]\n", berkas_jejak);
+    fclose(berkas_jejak);
+    berkas_jejak = NULL;
 }
 
-static void tangani_sinyal(int sig)
-{
-    (void)sig;
-    pulihkan_terminal();
-    keluar_alt();
-    write(STDOUT_FILENO, ESC_CLR ESC_HOME, 7);
-    _exit(0);
-}
+/* ============================================================
+ * Fungsi Utilitas UTF-8
+ * ============================================================ */
+struct rentang_kodepoin {
+    unsigned int awal;
+    unsigned int akhir;
+};
 
-static int inisialisasi_terminal(void)
+/* Karakter kombinasi dan format (lebar 0) */
+static const struct rentang_kodepoin rentang_lebar_nol[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD },
+    { 0x05BF, 0x05BF }, { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 },
+    { 0x05C7, 0x05C7 }, { 0x0610, 0x061A }, { 0x064B, 0x065F },
+    { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+    { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0900, 0x0902 },
+    { 0x093A, 0x093A }, { 0x093C, 0x093C }, { 0x0941, 0x0948 },
+    { 0x094D, 0x094D }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 },
+    { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E },
+    { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F },
+    { 0x202A, 0x202E }, { 0x2060, 0x2064 }, { 0x20D0, 0x20FF },
+    { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF },
+    { 0xE0100, 0xE01EF }
+};
+
+/* East Asian Width W/F (lebar 2) */
+static const struct rentang_kodepoin rentang_lebar_ganda[] = {
+    { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A },
+    { 0x23E9, 0x23EC }, { 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 },
+    { 0x25FD, 0x25FE }, { 0x2614, 0x2615 }, { 0x2648, 0x2653 },
+    { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+    { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 },
+    { 0x26CE, 0x26CE }, { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA },
+    { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 }, { 0x26FA, 0x26FA },
+    { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+    { 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E },
+    { 0x2753, 0x2755 }, { 0x2757, 0x2757 }, { 0x2795, 0x2797 },
+    { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF }, { 0x2B1B, 0x2B1C },
+    { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x303E },
+    { 0x3041, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF },
+    { 0xA000, 0xA4CF }, { 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 },
+    { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6F },
+    { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE4 },
+    { 0x17000, 0x18AFF }, { 0x1B000, 0x1B2FF }, { 0x1F004, 0x1F004 },
+    { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A },
+    { 0x1F200, 0x1F251 }, { 0x1F300, 0x1F64F }, { 0x1F680, 0x1F6FF },
+    { 0x1F7E0, 0x1F7EB }, { 0x1F900, 0x1F9FF }, { 0x1FA70, 0x1FAFF },
+    { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+};
+
+static int dalam_rentang(unsigned int cp, const struct rentang_kodepoin *tabel,
+                         int jumlah)
 {
-    struct termios t;
-    if (tcgetattr(STDIN_FILENO, &simpan_term) == -1) {
-        return -1;
+    int lo = 0, hi = jumlah - 1;
+    if (cp < tabel[0].awal || cp > tabel[jumlah - 1].akhir) {
+        return 0;
     }
-    t = simpan_term;
-    t.c_lflag &= ~(ECHO | ICANON);
-    t.c_cc[VMIN] = 1;
-    t.c_cc[VTIME] = 0;
-    if (tcsetattr(STDIN_FILENO, TCSANOW, &t) == -1) {
-        return -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (cp > tabel[mid].akhir) {
+            lo = mid + 1;
+        } else if (cp < tabel[mid].awal) {
+            hi = mid - 1;
+        } else {
+            return 1;
+        }
     }
-    mode_raw = 1;
     return 0;
 }
 
-static int lebar_terminal(void)
+/* Lebar tampilan satu kode poin: 0, 1 atau 2 kolom terminal */
+static int lebar_kodepoin(unsigned int cp)
 {
-    struct winsize ws;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1) {
-        return 80;
+    if (cp < 0x300) {
+        return 1;
     }
-    return ws.ws_col;
+    if (dalam_rentang(cp, rentang_lebar_nol,
+                      (int)(sizeof(rentang_lebar_nol) / sizeof(rentang_lebar_nol[0])))) {
+        return 0;
+    }
+    if (dalam_rentang(cp, rentang_lebar_ganda,
+                      (int)(sizeof(rentang_lebar_ganda) / sizeof(rentang_lebar_ganda[0])))) {
+        return 2;
+    }
+    return 1;
 }
 
-static int tinggi_terminal(void)
+/* Panjang sequence UTF-8 dari byte pertamanya */
+static int panjang_utf8(unsigned char lead)
 {
-    struct winsize ws;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1) {
-        return 24;
+    if (lead < 0xC0) {
+        return 1;
     }
-    return ws.ws_row;
+    if (lead < 0xE0) {
+        return 2;
+    }
+    if (lead < 0xF0) {
+        return 3;
+    }
+    return 4;
 }
 
-/* ============================================================
- * Fungsi Utilitas Grid
- * ============================================================ */
-static void gambar_grid_view(const struct konfigurasi *cfg,
-                             int x_awal, int y_awal,
-                             int col_start, int col_end,
-                             int row_start, int row_end)
+/* Dekode satu kode poin dari s (sisa byte tersedia); byte yang tidak
+ * valid dihitung satu byte sebagai U+FFFD. Mengembalikan jumlah byte. */
+static int dekode_utf8(const char *s, int sisa, unsigned int *cp)
 {
-    int r, c, k, line, y_top = y_awal;
-    tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
+    const unsigned char *p = (const unsigned char *)s;
+    int n = panjang_utf8(p[0]), i;
 
-    /* Garis atas viewport */
-    pos(x_awal, y_awal);
-    for (c = col_start; c <= col_end; c++) {
-        if (c == col_start) {
-            tulis_teks(TL, 3);
-        }
-        for (k = 0; k < lebar_kolom[c]; k++) {
-            tulis_teks(H, 3);
-        }
-        if (c < col_end) {
-            tulis_teks(TC, 3);
-        } else {
-            tulis_teks(TR, 3);
-        }
+    if (p[0] < 0x80) {
+        *cp = p[0];
+        return 1;
     }
-
-    /* Body grid */
-    for (r = row_start; r <= row_end; r++) {
-        int h = tinggi_baris[r];
-
-        /* Isi baris dengan spasi dan garis vertikal */
-        for (line = 0; line < h; line++) {
-            pos(x_awal, y_top + 1 + line);
-            for (c = col_start; c <= col_end; c++) {
-                tulis_teks(V, 3);
-                for (k = 0; k < lebar_kolom[c]; k++) {
-                    tulis_teks(" ", 1);
-                }
-            }
-            tulis_teks(V, 3);
+    if (p[0] < 0xC0 || n > sisa) {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    *cp = p[0] & (0x7F >> n);
+    for (i = 1; i < n; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            *cp = 0xFFFD;
+            return 1;
         }
+        *cp = (*cp << 6) | (p[i] & 0x3F);
+    }
+    return n;
+}
 
-        /* Garis bawah setiap baris */
-        pos(x_awal, y_top + h + 1);
-        for (c = col_start; c <= col_end; c++) {
-            if (r < row_end) {
-                if (c == col_start) {
-                    tulis_teks(LC, 3);
-                }
-                for (k = 0; k < lebar_kolom[c]; k++) {
-                    tulis_teks(H, 3);
-                }
-                if (c < col_end) {
-                    tulis_teks(CR, 3);
-                } else {
-                    tulis_teks(RC, 3);
-                }
-            } else {
-                if (c == col_start) {
-                    tulis_teks(BL, 3);
-                }
-                for (k = 0; k < lebar_kolom[c]; k++) {
-                    tulis_teks(H, 3);
-                }
-                if (c < col_end) {
-                    tulis_teks(BC, 3);
-                } else {
-                    tulis_teks(BR, 3);
-                }
-            }
-        }
-        y_top += h + 1;
+/* Lebar tampilan n byte pertama teks */
+static int lebar_teks(const char *teks, int n)
+{
+    int i = 0, lebar = 0;
+    while (i < n) {
+        unsigned int cp;
+        i += dekode_utf8(teks + i, n - i, &cp);
+        lebar += lebar_kodepoin(cp);
     }
+    return lebar;
+}
 
-    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+/* Awal kode poin sebelum offset byte i (i > 0) */
+static int mundur_utf8(const char *s, int i)
+{
+    do {
+        i--;
+    } while (i > 0 && ((unsigned char)s[i] & 0xC0) == 0x80);
+    return i;
+}
+
+/* Awal kode poin setelah offset byte i (i < len) */
+static int maju_utf8(const char *s, int len, int i)
+{
+    do {
+        i++;
+    } while (i < len && ((unsigned char)s[i] & 0xC0) == 0x80);
+    return i;
 }
 
 /* ============================================================
- * Fungsi Utilitas Sel
+ * Fungsi Utilitas Terminal
  * ============================================================ */
-static void gambar_isi_sel_view(const struct konfigurasi *cfg,
-                                int x_awal, int y_awal,
-                                int col_start, int row_start,
-                                int c, int r)
+/* Tulis byte apa adanya ke back buffer atau langsung ke terminal */
+static void keluarkan(const char *teks, size_t panjang)
 {
-    const char *teks = isi[r][c];
-    int w, h, x0, y0, i, line;
-    int len = (int)strlen(teks), start = 0;
-
-    /* Hitung posisi sel */
-    x0 = x_awal + 1;
-    y0 = y_awal;
-    for (i = col_start; i < c; i++) {
-        x0 += lebar_kolom[i] + 1;
+#ifdef TABEL_BENCH
+    const char *e = teks;
+    while ((e = memchr(e, '\033', panjang - (size_t)(e - teks))) != NULL) {
+        ukuran.escape++;
+        e++;
     }
-    for (i = row_start; i < r; i++) {
-        y0 += tinggi_baris[i] + 1;
+    ukuran.byte += panjang;
+#endif
+    if (use_double_buffer) {
+        tulis_buffer(&back_buffer, teks, panjang);
+    } else {
+        write(STDOUT_FILENO, teks, panjang);
     }
-    w = lebar_kolom[c];
-    h = tinggi_baris[r];
+}
 
-    /* Gambar teks dengan autowrap */
-    for (line = 0; line < h; line++) {
-        int remaining = len - start;
-        int take = remaining > w ? w : remaining;
-        int offset = 0;
-        pos(x0, y0 + 1 + line);
-        for (i = 0; i < w; i++) {
-            tulis_teks(" ", 1);
-        }
-        if (take <= 0) {
-            continue;
+/* Seperti keluarkan, untuk panjang salinan byte c */
+static void keluarkan_ulang(char c, size_t panjang)
+{
+#ifdef TABEL_BENCH
+    ukuran.byte += panjang;
+#endif
+    if (use_double_buffer) {
+        isi_buffer(&back_buffer, c, panjang);
+    } else {
+        char blok[64];
+        memset(blok, c, sizeof(blok));
+        while (panjang > 0) {
+            size_t n = panjang < sizeof(blok) ? panjang : sizeof(blok);
+            write(STDOUT_FILENO, blok, n);
+            panjang -= n;
         }
-        if (align_sel[r][c] == CENTER) {
-            offset = (w - take) / 2;
-        } else if (align_sel[r][c] == RIGHT) {
-            offset = (w - take);
+    }
+}
+
+/* Frame diukur dari render/redraw pertama sampai flush */
+static void mulai_ukur_frame(void)
+{
+    if (kinerja.awal_frame == 0.0) {
+        kinerja.awal_frame = waktu_ms();
+    }
+}
+
+/* Kirim semua iovec; penulisan parsial dan yang terputus sinyal
+ * dilanjutkan dari byte yang belum terkirim */
+static int tulis_semua(int fd, struct iovec *iov, int n)
+{
+    while (n > 0) {
+        ssize_t k = writev(fd, iov, n);
+        kinerja.syscall++;
+        if (k < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            return -1;
         }
-        if (offset < 0) {
-            offset = 0;
+        while (n > 0 && (size_t)k >= iov->iov_len) {
+            k -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
         }
-        pos(x0 + offset, y0 + 1 + line);
-        tulis_teks(teks + start, (size_t)take);
-        start += take;
-        if (start >= len) {
-            break;
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + k;
+            iov->iov_len -= (size_t)k;
         }
     }
-    if (len - start > 0 && h > 0 && w > 0) {
-        pos(x0 + w - 1, y0 + h);
-        tulis_teks("…", 3);
-    }
+    return 0;
 }
 
-/* ============================================================
- * Fungsi Utilitas UI
- * ============================================================ */
-static void gambar_topbar(const struct konfigurasi *cfg)
+/* Seperti keluarkan, tetapi data yang cukup panjang hanya dirujuk oleh
+ * segmen frame; pemanggil menjamin data tidak berubah sebelum flush */
+static void keluarkan_rujukan(const char *data, size_t panjang)
 {
-    int cols = lebar_terminal();
-    char judul[] = "TABEL v0.7";
-    char label[512];
-    char kol = (char)('A' + cfg->aktif_x);
-    int bar = cfg->aktif_y + 1;
-
-    /* Background gelap untuk top bar */
-    pos(1, 1);
-    tulis_teks(BG_DARK, sizeof(BG_DARK) - 1);
-    {
-        int i;
-        for (i = 0; i < cols; i++) {
-            tulis_teks(" ", 1);
-        }
+#ifdef TABEL_BENCH
+    ukuran.byte += panjang;
+#endif
+    if (!use_double_buffer) {
+        struct iovec iov;
+        iov.iov_base = (void *)data;
+        iov.iov_len = panjang;
+        tulis_semua(STDOUT_FILENO, &iov, 1);
+        return;
     }
-
-    if (isi[cfg->aktif_y][cfg->aktif_x][0] == '\0') {
-        snprintf(label, sizeof(label), "kolom %c%d:", kol, bar);
-    } else {
-        snprintf(label, sizeof(label), "kolom %c%d: %s", kol, bar,
-                 isi[cfg->aktif_y][cfg->aktif_x]);
+    if (panjang < MIN_SEGMEN_RUJUKAN || jumlah_segmen + 2 > MAKS_SEGMEN_FRAME) {
+        tulis_buffer(&back_buffer, data, panjang);
+        return;
     }
-
-    pos(2, 1);
-    tulis_teks(FG_WHITE, sizeof(FG_WHITE) - 1);
-    tulis_teks(label, strlen(label));
-    pos(cols - (int)strlen(judul) - 1, 1);
-    tulis_teks(FG_GRAY, sizeof(FG_GRAY) - 1);
-    tulis_teks(judul, strlen(judul));
-    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
-}
-
-static void gambar_statusbar(const struct konfigurasi *cfg)
-{
-    int cols = lebar_terminal(), rows = tinggi_terminal(), y = rows;
-    char info[128];
-    snprintf(info, sizeof(info), "lebar: %d tinggi: %d  [?]: bantuan",
-             lebar_kolom[cfg->aktif_x], tinggi_baris[cfg->aktif_y]);
-    
-    /* Background gelap untuk status bar */
-    pos(1, y);
-    tulis_teks(BG_DARK, sizeof(BG_DARK) - 1);
-    {
-        int i;
-        for (i = 0; i < cols; i++) {
-            tulis_teks(" ", 1);
-        }
+    if (back_buffer.size > awal_segmen) {
+        segmen_frame[jumlah_segmen].data = NULL;
+        segmen_frame[jumlah_segmen].awal = awal_segmen;
+        segmen_frame[jumlah_segmen].panjang = back_buffer.size - awal_segmen;
+        jumlah_segmen++;
     }
-    
-    pos(2, y);
-    tulis_teks(FG_WHITE, sizeof(FG_WHITE) - 1);
-    tulis_teks(status_msg, strlen(status_msg));
-    pos(cols - (int)strlen(info) - 1, y);
-    tulis_teks(FG_GRAY, sizeof(FG_GRAY) - 1);
-    tulis_teks(info, strlen(info));
-    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+    segmen_frame[jumlah_segmen].data = data;
+    segmen_frame[jumlah_segmen].awal = 0;
+    segmen_frame[jumlah_segmen].panjang = panjang;
+    jumlah_segmen++;
+    awal_segmen = back_buffer.size;
 }
 
-static void gambar_label_kolom(const struct konfigurasi *cfg,
-                               int x_awal, int col_start, int col_end)
+static void pos(int x, int y)
 {
-    int x = x_awal + 1, c, term_w = lebar_terminal();
-    pos(1, 2);
-    {
-        int i;
-        for (i = 0; i < term_w; i++) {
-            tulis_teks(" ", 1);
+    char esc[32];
+    int n;
+    if (x == kursor_x && y == kursor_y) {
+        return;
+    }
+    if (y == kursor_y && kursor_x > 0 && kursor_x <= tampil_lebar) {
+        /* Satu baris: gerak relatif lebih pendek dari posisi absolut */
+        if (x > kursor_x) {
+            n = snprintf(esc, sizeof(esc), "\033[%dC", x - kursor_x);
+        } else {
+            n = snprintf(esc, sizeof(esc), "\033[%dD", kursor_x - x);
         }
+    } else {
+        n = snprintf(esc, sizeof(esc), "\033[%d;%dH", y, x);
     }
-    for (c = col_start; c <= col_end; c++) {
-        char ch = (char)('A' + c);
-        pos(x + lebar_kolom[c] / 2, 2);
-        tulis_teks(&ch, 1);
-        x += lebar_kolom[c] + 1;
+    if (n > 0) {
+        keluarkan(esc, (size_t)n);
+        kursor_x = x;
+        kursor_y = y;
     }
 }
 
-static void gambar_nomor_baris(const struct konfigurasi *cfg,
-                                int y_awal, int row_start, int row_end)
+/* Kode SGR warna rgb untuk palet aktif; latar = 1 untuk background */
+static int kode_warna(char *out, size_t ukuran, int rgb, int latar)
 {
-    int y = y_awal, r;
-    for (r = row_start; r <= row_end; r++) {
-        int i;
-        pos(1, y + 1);
-        for (i = 0; i < 4; i++) {
-            tulis_teks(" ", 1);
-        }
-        y += tinggi_baris[r] + 1;
+    static const int ansi[16] = {
+        0x000000, 0xCD0000, 0x00CD00, 0xCDCD00, 0x0000EE, 0xCD00CD, 0x00CDCD,
+        0xE5E5E5, 0x7F7F7F, 0xFF0000, 0x00FF00, 0xFFFF00, 0x5C5CFF, 0xFF00FF,
+        0x00FFFF, 0xFFFFFF
+    };
+    int r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+
+    if (mode_warna == 256) {
+        /* Kubus 6x6x6 atau skala abu-abu, ambil yang lebih dekat */
+        int cr = r < 48 ? 0 : r < 115 ? 1 : (r - 35) / 40;
+        int cg = g < 48 ? 0 : g < 115 ? 1 : (g - 35) / 40;
+        int cb = b < 48 ? 0 : b < 115 ? 1 : (b - 35) / 40;
+        int lv[6] = { 0, 95, 135, 175, 215, 255 };
+        int rata = (r + g + b) / 3;
+        int abu = rata < 8 ? 0 : rata > 238 ? 23 : (rata - 8) / 10;
+        int va = 8 + abu * 10;
+        long dk = (long)(r - lv[cr]) * (r - lv[cr]) + (long)(g - lv[cg]) * (g - lv[cg]) +
+                  (long)(b - lv[cb]) * (b - lv[cb]);
+        long da = (long)(r - va) * (r - va) + (long)(g - va) * (g - va) +
+                  (long)(b - va) * (b - va);
+        int idx = da < dk ? 232 + abu : 16 + 36 * cr + 6 * cg + cb;
+        return snprintf(out, ukuran, "%d;5;%d", latar ? 48 : 38, idx);
     }
-    y = y_awal;
-    for (r = row_start; r <= row_end; r++) {
-        char num[8];
-        snprintf(num, sizeof(num), "%2d", r + 1);
-        pos(2, y + 1);
-        tulis_teks(num, strlen(num));
-        y += tinggi_baris[r] + 1;
+    if (mode_warna == 16) {
+        int i, terbaik = 0;
+        long jarak_min = -1;
+        for (i = 0; i < 16; i++) {
+            int dr = r - ((ansi[i] >> 16) & 0xFF);
+            int dg = g - ((ansi[i] >> 8) & 0xFF);
+            int db = b - (ansi[i] & 0xFF);
+            long jarak = (long)dr * dr + (long)dg * dg + (long)db * db;
+            if (jarak_min < 0 || jarak < jarak_min) {
+                jarak_min = jarak;
+                terbaik = i;
+            }
+        }
+        return snprintf(out, ukuran, "%d",
+                        (terbaik < 8 ? 30 + terbaik : 82 + terbaik) + (latar ? 10 : 0));
     }
+    return snprintf(out, ukuran, "%d;2;%d;%d;%d", latar ? 48 : 38, r, g, b);
 }
 
-/* ============================================================
- * Fungsi Utilitas Viewport
- * ============================================================ */
-static void hitung_viewport(const struct konfigurasi *cfg,
-                            int *x_awal, int *y_awal,
-                            int *pad_left, int *vis_w, int *vis_h,
-                            int *col_start, int *col_end,
-                            int *row_start, int *row_end)
+/* Kirim SGR hanya jika atribut yang diminta berbeda dari yang berlaku */
+static void sinkronkan_sgr(void)
 {
-    int term_w = lebar_terminal();
-    int term_h = tinggi_terminal();
-    int grid_top = 3;
-    int status_bar_rows = 1;
-    int available_h = term_h - grid_top - status_bar_rows;
-    int padL = 5;
-    int available_w = term_w - padL;
-    int x = 0, c, start;
-    int y = 0, r;
-    
-    /* Validasi input */
-    if (!cfg || !x_awal || !y_awal || !pad_left || !vis_w || !vis_h ||
-        !col_start || !col_end || !row_start || !row_end) {
+    char esc[64];
+    int n = 2, reset;
+
+    if (sgr_terminal_valid && sgr_diminta.fg == sgr_terminal.fg &&
+        sgr_diminta.bg == sgr_terminal.bg && sgr_diminta.tebal == sgr_terminal.tebal) {
         return;
     }
-    
-    if (available_h < 1) {
-        available_h = 1;
-    }
-    
-    if (available_w < 8) {
-        available_w = 8;
+    memcpy(esc, "\033[", 2);
+    reset = !sgr_terminal_valid ||
+            (sgr_diminta.fg < 0 && sgr_diminta.bg < 0 && !sgr_diminta.tebal);
+    if (reset) {
+        esc[n++] = '0';
+        sgr_terminal.fg = sgr_terminal.bg = -1;
+        sgr_terminal.tebal = 0;
     }
-
-    *x_awal = padL;
-    *y_awal = grid_top;
-    *pad_left = padL;
-    *vis_w = available_w;
-    *vis_h = available_h;
-
-    /* kolom terlihat */
-    x = 0;
-    c = cfg->view_col;
-    start = c;
-    while (c < cfg->kolom) {
-        int w = lebar_kolom[c] + 1;
-        if (x + w > available_w) {
-            break;
+    if (sgr_diminta.tebal != sgr_terminal.tebal) {
+        if (n > 2) {
+            esc[n++] = ';';
         }
-        x += w;
-        c++;
+        n += snprintf(esc + n, sizeof(esc) - (size_t)n, sgr_diminta.tebal ? "1" : "22");
     }
-    if (c == start && c < cfg->kolom) {
-        c++;
-    }
-    *col_start = start;
-    *col_end = c - 1;
-    
-    /* baris terlihat */
-    y = 0;
-    r = cfg->view_row;
-    start = r;
-    while (r < cfg->baris) {
-        int h = tinggi_baris[r] + 1;
-        if (y + h > available_h) {
-            break;
+    if (sgr_diminta.fg != sgr_terminal.fg) {
+        if (n > 2) {
+            esc[n++] = ';';
+        }
+        if (sgr_diminta.fg < 0) {
+            n += snprintf(esc + n, sizeof(esc) - (size_t)n, "39");
+        } else {
+            n += kode_warna(esc + n, sizeof(esc) - (size_t)n, sgr_diminta.fg, 0);
         }
-        y += h;
-        r++;
     }
-    if (r == start && r < cfg->baris) {
-        r++;
+    if (sgr_diminta.bg != sgr_terminal.bg) {
+        if (n > 2) {
+            esc[n++] = ';';
+        }
+        if (sgr_diminta.bg < 0) {
+            n += snprintf(esc + n, sizeof(esc) - (size_t)n, "49");
+        } else {
+            n += kode_warna(esc + n, sizeof(esc) - (size_t)n, sgr_diminta.bg, 1);
+        }
     }
-    *row_start = start;
-    *row_end = r - 1;
+    esc[n++] = 'm';
+    keluarkan(esc, (size_t)n);
+    sgr_terminal = sgr_diminta;
+    sgr_terminal_valid = 1;
 }
 
-/* ============================================================
- * Fungsi Utilitas Seleksi
- * ============================================================ */
-static void gambar_area_hijau_view(const struct konfigurasi *cfg,
-                                   int x_awal, int y_awal,
-                                   int col_start, int col_end,
-                                   int row_start, int row_end,
-                                   int x1, int y1, int x2, int y2)
+/* Catat parameter SGR ("0", "1", "22", "38;2;r;g;b", "48;2;r;g;b", "39",
+ * "49") sebagai atribut yang diminta tanpa langsung mengirimnya */
+static void catat_sgr(const char *p, const char *akhir)
 {
-    int minx = x1 < x2 ? x1 : x2, maxx = x1 > x2 ? x1 : x2;
-    int miny = y1 < y2 ? y1 : y2, maxy = y1 > y2 ? y1 : y2;
-    int cs = minx < col_start ? col_start : minx;
-    int ce = maxx > col_end ? col_end : maxx;
-    int rs = miny < row_start ? row_start : miny;
-    int re = maxy > row_end ? row_end : maxy;
-    int r, c, k, line, y_top, r0;
-    
-    if (cs > ce || rs > re) {
-        return;
-    }
-
-    tulis_teks(FG_GREEN, sizeof(FG_GREEN) - 1);
-    y_top = y_awal;
-    for (r0 = row_start; r0 < rs; r0++) {
-        y_top += tinggi_baris[r0] + 1;
-    }
+    int param[16], n = 0, i;
 
-    /* top border */
-    {
-        int c0;
-        int x = x_awal;
-        for (c0 = col_start; c0 < cs; c0++) {
-            x += lebar_kolom[c0] + 1;
+    while (p <= akhir && n < 16) {
+        param[n] = 0;
+        while (p < akhir && *p >= '0' && *p <= '9') {
+            param[n] = param[n] * 10 + (*p - '0');
+            p++;
         }
-        pos(x, y_top);
-        for (c = cs; c <= ce; c++) {
-            if (c == cs) {
-                tulis_teks(TL, 3);
-            }
-            for (k = 0; k < lebar_kolom[c]; k++) {
-                tulis_teks(H, 3);
-            }
-            if (c < ce) {
-                tulis_teks(TC, 3);
+        n++;
+        p++;
+    }
+    for (i = 0; i < n; i++) {
+        if (param[i] == 0) {
+            sgr_diminta.fg = sgr_diminta.bg = -1;
+            sgr_diminta.tebal = 0;
+        } else if (param[i] == 1 || param[i] == 22) {
+            sgr_diminta.tebal = (param[i] == 1);
+        } else if (param[i] == 39) {
+            sgr_diminta.fg = -1;
+        } else if (param[i] == 49) {
+            sgr_diminta.bg = -1;
+        } else if ((param[i] == 38 || param[i] == 48) && i + 4 < n &&
+                   param[i + 1] == 2) {
+            int rgb = (param[i + 2] << 16) | (param[i + 3] << 8) | param[i + 4];
+            if (param[i] == 38) {
+                sgr_diminta.fg = rgb;
             } else {
-                tulis_teks(TR, 3);
+                sgr_diminta.bg = rgb;
             }
+            i += 4;
         }
     }
+}
 
-    /* body + interior sides */
-    {
-        int y = y_top;
-        for (r = rs; r <= re; r++) {
-            int h = tinggi_baris[r];
-            int x_start = x_awal, c0;
-            for (c0 = col_start; c0 < cs; c0++) {
-                x_start += lebar_kolom[c0] + 1;
+/* Majukan kursor sebanyak lebar tampilan teks; karakter kontrol membuat
+ * posisi kursor tidak diketahui */
+static void majukan_kursor(const char *p, size_t panjang)
+{
+    size_t i = 0;
+
+    while (i < panjang && kursor_x >= 0) {
+        unsigned int cp;
+        if ((unsigned char)p[i] < 0x20) {
+            kursor_x = kursor_y = -1;
+            return;
+        }
+        i += (size_t)dekode_utf8(p + i, (int)(panjang - i), &cp);
+        kursor_x += lebar_kodepoin(cp);
+    }
+}
+
+/* Semua keluaran UI lewat sini: SGR ditunda sampai ada teks yang butuh
+ * atribut, dan posisi kursor diikuti agar pos() bisa melewati perpindahan
+ * ke tempat kursor sudah berada */
+static void tulis_teks(const char *teks, size_t panjang)
+{
+    const char *p = teks, *akhir = teks + panjang;
+
+    while (p < akhir) {
+        const char *q = p;
+        if (*p != '\033') {
+            while (q < akhir && *q != '\033') {
+                q++;
             }
-            for (line = 0; line < h; line++) {
-                pos(x_start, y + 1 + line);
-                for (c = cs; c <= ce; c++) {
-                    tulis_teks(V, 3);
-                    for (k = 0; k < lebar_kolom[c]; k++) {
-                        tulis_teks(" ", 1);
-                    }
-                }
-                tulis_teks(V, 3);
+            sinkronkan_sgr();
+            keluarkan(p, (size_t)(q - p));
+            majukan_kursor(p, (size_t)(q - p));
+        } else if (q + 1 < akhir && q[1] == '[') {
+            const char *param = q + 2;
+            char final;
+            q = param;
+            while (q < akhir && !(*q >= 0x40 && *q <= 0x7E)) {
+                q++;
             }
-            pos(x_start, y + h + 1);
-            for (c = cs; c <= ce; c++) {
-                if (r < re) {
-                    if (c == cs) {
-                        tulis_teks(LC, 3);
-                    }
-                    for (k = 0; k < lebar_kolom[c]; k++) {
-                        tulis_teks(H, 3);
-                    }
-                    if (c < ce) {
-                        tulis_teks(CR, 3);
-                    } else {
-                        tulis_teks(RC, 3);
-                    }
+            if (q >= akhir) {
+                keluarkan(p, (size_t)(akhir - p));
+                kursor_x = kursor_y = -1;
+                break;
+            }
+            final = *q++;
+            if (final == 'm' && *param != '?') {
+                catat_sgr(param, q - 1);
+            } else if (*param == '?') {
+                /* Mode privat (kursor, alt screen, sinkron) */
+                keluarkan(p, (size_t)(q - p));
+            } else if (final == 'J' || final == 'K' || final == 'X' ||
+                       final == 'S' || final == 'T') {
+                /* Hapus/gulir mengisi dengan background yang berlaku */
+                sinkronkan_sgr();
+                keluarkan(p, (size_t)(q - p));
+            } else {
+                keluarkan(p, (size_t)(q - p));
+                if (final == 'r' || (final == 'H' && param == q - 1)) {
+                    kursor_x = kursor_y = 1;
                 } else {
-                    if (c == cs) {
-                        tulis_teks(BL, 3);
-                    }
-                    for (k = 0; k < lebar_kolom[c]; k++) {
-                        tulis_teks(H, 3);
-                    }
-                    if (c < ce) {
-                        tulis_teks(BC, 3);
-                    } else {
-                        tulis_teks(BR, 3);
-                    }
+                    kursor_x = kursor_y = -1;
                 }
             }
-            y += h + 1;
+        } else {
+            q++;
+            keluarkan(p, (size_t)(q - p));
+            kursor_x = kursor_y = -1;
         }
+        p = q;
     }
-    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+}
 
-    for (r = rs; r <= re; r++) {
-        for (c = cs; c <= ce; c++) {
-            if (isi[r][c][0] != '\0') {
-                gambar_isi_sel_view(cfg, x_awal, y_awal, col_start, row_start, c, r);
-            }
-        }
+/* n spasi dengan atribut yang diminta; kursor ikut maju */
+static void tulis_spasi(int n)
+{
+    if (n <= 0) {
+        return;
+    }
+    sinkronkan_sgr();
+    keluarkan_ulang(' ', (size_t)n);
+    if (kursor_x > 0) {
+        kursor_x += n;
     }
 }
 
-static void gambar_seleksi_cyan_view(const struct konfigurasi *cfg,
-                                     int x_awal, int y_awal,
-                                     int col_start, int col_end,
-                                     int row_start, int row_end,
-                                     int ax, int ay, int bx, int by)
+/* Bisakah ECH/EL dipakai untuk atribut yang diminta */
+static int hapus_layar_aman(void)
 {
-    int minx = ax < bx ? ax : bx, maxx = ax > bx ? ax : bx;
-    int miny = ay < by ? ay : by, maxy = ay > by ? ay : by;
-    int vx1 = minx < col_start ? col_start : minx;
-    int vx2 = maxx > col_end ? col_end : maxx;
-    int vy1 = miny < row_start ? row_start : miny;
-    int vy2 = maxy > row_end ? row_end : maxy;
-    int i, x0 = x_awal + 1, y0 = y_awal, total_w = 0, total_h = 0;
-    
-    if (vx1 > vx2 || vy1 > vy2) {
+    return terminal_bce || sgr_diminta.bg < 0;
+}
+
+/* Kosongkan n sel mulai kursor. Dengan ECH kursor tidak bergerak, dengan
+ * spasi kursor maju; pemanggil memakai pos() sesudahnya */
+static void hapus_sel_layar(int n)
+{
+    char esc[16];
+    int len;
+
+    /* ECH baru lebih pendek dari spasi mulai 5 sel */
+    if (n < 5 || !hapus_layar_aman()) {
+        tulis_spasi(n);
         return;
     }
+    sinkronkan_sgr();
+    len = snprintf(esc, sizeof(esc), "\033[%dX", n);
+    keluarkan(esc, (size_t)len);
+}
 
-    for (i = col_start; i < vx1; i++) {
-        x0 += lebar_kolom[i] + 1;
-    }
-    for (i = row_start; i < vy1; i++) {
-        y0 += tinggi_baris[i] + 1;
+/* Kosongkan seluruh baris layar y dengan atribut yang diminta; kursor di
+ * kolom 1 baris itu sesudahnya kecuali pada fallback spasi */
+static void kosongkan_baris(int y)
+{
+    pos(1, y);
+    if (!hapus_layar_aman()) {
+        tulis_spasi(lebar_terminal());
+        return;
     }
-    for (i = vx1; i <= vx2; i++) {
-        total_w += lebar_kolom[i] + 1;
+    sinkronkan_sgr();
+    keluarkan("\033[K", 3);
+}
+
+static void flush(void)
+{
+    jejak_mulai("flush");
+    if (use_double_buffer && antrean_makro_awal < antrean_makro.size) {
+        /* Makro diputar: buang frame, layar tidak lagi cocok dengan
+         * state tampilan sehingga frame berikutnya harus penuh */
+        reset_buffer(&back_buffer);
+        jumlah_segmen = 0;
+        awal_segmen = 0;
+        nomor_frame++;
+        kursor_x = kursor_y = -1;
+        sgr_terminal_valid = 0;
+        tampil_valid = 0;
+        frame_tertunda = FRAME_PENUH;
+    } else if (use_double_buffer) {
+        static struct iovec iov[MAKS_SEGMEN_FRAME + 3];
+        size_t total = 0;
+        int n = 1, i;
+
+        /* iov[0] dicadangkan untuk pembuka synchronized output */
+        for (i = 0; i < jumlah_segmen; i++) {
+            const struct segmen_frame *sg = &segmen_frame[i];
+            iov[n].iov_base = (void *)(sg->data ? sg->data : back_buffer.data + sg->awal);
+            iov[n].iov_len = sg->panjang;
+            total += sg->panjang;
+            n++;
+        }
+        if (back_buffer.size > awal_segmen) {
+            iov[n].iov_base = back_buffer.data + awal_segmen;
+            iov[n].iov_len = back_buffer.size - awal_segmen;
+            total += iov[n].iov_len;
+            n++;
+        }
+        if (total > 0) {
+            kinerja.byte_frame = total;
+            if (kinerja.awal_frame > 0.0) {
+                kinerja.frame_us = (waktu_ms() - kinerja.awal_frame) * 1000.0;
+                kinerja.sel_frame = kinerja.sel_berjalan;
+            }
+#ifndef TABEL_BENCH
+            if (sinkron_output) {
+                /* Bungkus frame agar terminal menampilkannya sekaligus */
+                iov[0].iov_base = "\033[?2026h";
+                iov[0].iov_len = 8;
+                iov[n].iov_base = "\033[?2026l";
+                iov[n].iov_len = 8;
+                tulis_semua(STDOUT_FILENO, iov, n + 1);
+            } else {
+                tulis_semua(STDOUT_FILENO, iov + 1, n - 1);
+            }
+#endif
+        }
+        reset_buffer(&back_buffer);
+        jumlah_segmen = 0;
+        awal_segmen = 0;
+        nomor_frame++;
+        kinerja.awal_frame = 0.0;
+        kinerja.sel_berjalan = 0;
+    } else {
+        fflush(stdout);
     }
-    for (i = vy1; i <= vy2; i++) {
-        total_h += tinggi_baris[i] + 1;
+    jejak_selesai();
+}
+
+/* Kapasitas back buffer untuk satu frame penuh di ukuran terminal saat
+ * ini, agar frame tidak perlu realloc */
+static void siapkan_back_buffer(void)
+{
+    size_t perlu = (size_t)lebar_terminal() * (size_t)tinggi_terminal() * 4 + 4096;
+    if (back_buffer.capacity < perlu) {
+        siapkan_ruang_buffer(&back_buffer, perlu - back_buffer.size);
     }
+}
 
-    tulis_teks(FG_CYAN, sizeof(FG_CYAN) - 1);
-    pos(x0 - 1, y0);
-    tulis_teks(TL, 3);
-    for (i = 0; i < total_w - 1; i++) {
-        tulis_teks(H, 3);
+/* Garis template grid: dirujuk langsung dari slot template */
+static void tulis_templat(const struct templat_grid *t, const struct buffer *garis)
+{
+    sinkronkan_sgr();
+    keluarkan_rujukan(garis->data, garis->size);
+    if (kursor_x > 0) {
+        kursor_x += t->lebar;
     }
-    tulis_teks(TR, 3);
-    pos(x0 - 1, y0 + total_h);
-    tulis_teks(BL, 3);
-    for (i = 0; i < total_w - 1; i++) {
-        tulis_teks(H, 3);
+}
+
+/* Pilih palet dari COLORTERM/TERM; SGR berikutnya dikirim ulang penuh */
+static void atur_mode_warna(int mode)
+{
+    if (mode == 0) {
+        const char *ct = getenv("COLORTERM");
+        const char *term = getenv("TERM");
+        if (ct && (strstr(ct, "truecolor") || strstr(ct, "24bit"))) {
+            mode = 24;
+        } else if (term && strstr(term, "256")) {
+            mode = 256;
+        } else {
+            mode = 16;
+        }
+        /* screen dan tmux mengisi hapus layar dengan background default */
+        terminal_bce = !(term && (strncmp(term, "screen", 6) == 0 ||
+                                  strncmp(term, "tmux", 4) == 0) &&
+                         !strstr(term, "bce"));
     }
-    tulis_teks(BR, 3);
-    for (i = 1; i < total_h; i++) {
-        pos(x0 - 1, y0 + i);
-        tulis_teks(V, 3);
-        pos(x0 + total_w - 1, y0 + i);
-        tulis_teks(V, 3);
+    mode_warna = mode;
+    sgr_terminal_valid = 0;
+}
+
+static void masuk_alt(void)
+{
+    tulis_teks("\033[?1049h\033[?25l", 14);
+    if (!use_double_buffer) {
+        flush();
     }
-    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
 }
 
-/* ============================================================
- * Fungsi Utilitas Sel Aktif
- * ============================================================ */
-static void gambar_sel_aktif_view(const struct konfigurasi *cfg,
-                                  int x_awal, int y_awal,
-                                  int col_start, int col_end,
-                                  int row_start, int row_end)
+static void keluar_alt(void)
 {
-    int ax = cfg->aktif_x, ay = cfg->aktif_y;
-    int w, h, x0, y0, k, line;
-    
-    if (ax < col_start || ax > col_end || ay < row_start || ay > row_end) {
-        return;
+    tulis_teks("\033[?25h\033[?1049l", 14);
+    if (!use_double_buffer) {
+        flush();
     }
+}
 
-    /* Sel normal */
-    x0 = x_awal + 1;
-    y0 = y_awal;
-    for (k = col_start; k < ax; k++) {
-        x0 += lebar_kolom[k] + 1;
+static void bersih(void)
+{
+    tulis_teks(ESC_CLR ESC_HOME, 7);
+    if (!use_double_buffer) {
+        flush();
     }
-    for (k = row_start; k < ay; k++) {
-        y0 += tinggi_baris[k] + 1;
+}
+
+static void pulihkan_terminal(void)
+{
+    if (mode_raw) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &simpan_term);
+        mode_raw = 0;
     }
-    w = lebar_kolom[ax];
-    h = tinggi_baris[ay];
+}
 
-    tulis_teks(FG_WHITE, sizeof(FG_WHITE) - 1);
-    pos(x0 - 1, y0);
-    tulis_teks(TL, 3);
-    for (k = 0; k < w; k++) {
-        tulis_teks(H, 3);
+static void tangani_sinyal(int sig)
+{
+    (void)sig;
+    pulihkan_terminal();
+    keluar_alt();
+    write(STDOUT_FILENO, ESC_CLR ESC_HOME, 7);
+    if (soket_server >= 0) {
+        unlink(jalur_soket);
     }
-    tulis_teks(TR, 3);
-    for (line = 0; line < h; line++) {
-        pos(x0 - 1, y0 + 1 + line);
-        tulis_teks(V, 3);
-        pos(x0 + w, y0 + 1 + line);
-        tulis_teks(V, 3);
+    _exit(0);
+}
+
+static int inisialisasi_terminal(void)
+{
+    struct termios t;
+    if (tcgetattr(STDIN_FILENO, &simpan_term) == -1) {
+        return -1;
     }
-    pos(x0 - 1, y0 + h + 1);
-    tulis_teks(BL, 3);
-    for (k = 0; k < w; k++) {
-        tulis_teks(H, 3);
+    t = simpan_term;
+    t.c_lflag &= ~(ECHO | ICANON);
+    t.c_cc[VMIN] = 1;
+    t.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &t) == -1) {
+        return -1;
     }
-    tulis_teks(BR, 3);
-    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+    mode_raw = 1;
+    return 0;
 }
 
-/* ============================================================
- * Fungsi Render
- * ============================================================ */
-static void gambar_semua_isi_view(const struct konfigurasi *cfg,
-                                  int x_awal, int y_awal,
-                                  int col_start, int col_end,
-                                  int row_start, int row_end)
+static int makro_diputar(void)
 {
-    int r, c;
-    for (r = row_start; r <= row_end; r++) {
-        for (c = col_start; c <= col_end; c++) {
-            if (isi[r][c][0] != '\0') {
-                gambar_isi_sel_view(cfg, x_awal, y_awal, col_start, row_start, c, r);
-            }
+    return antrean_makro_awal < antrean_makro.size;
+}
+
+/* Satu byte input keyboard; antrean makro lalu byte yang tertampung saat
+ * deteksi terminal dilayani lebih dulu. Hanya input asli yang direkam */
+static ssize_t baca_input(unsigned char *ch)
+{
+    ssize_t n;
+    input_dari_makro = makro_diputar();
+    if (input_dari_makro) {
+        *ch = (unsigned char)antrean_makro.data[antrean_makro_awal++];
+        if (antrean_makro_awal == antrean_makro.size) {
+            reset_buffer(&antrean_makro);
+            antrean_makro_awal = 0;
         }
+        return 1;
+    }
+    if (input_tunda_awal < input_tunda_n) {
+        *ch = input_tunda[input_tunda_awal++];
+        n = 1;
+    } else {
+#ifdef TABEL_BENCH
+        return 0;
+#else
+        n = read(STDIN_FILENO, ch, 1);
+        kinerja.syscall++;
+#endif
     }
+    if (n == 1 && makro_rekam >= 0) {
+        tulis_buffer(&register_makro[makro_rekam], (const char *)ch, 1);
+    }
+    return n;
 }
 
-static void render(const struct konfigurasi *cfg)
+/* Tunggu input paling lama timeout_ms; 0 = hanya periksa */
+static int input_tersedia(int timeout_ms)
 {
-    int x_awal, y_awal, pad_left, vis_w, vis_h;
-    int col_start, col_end, row_start, row_end;
-    
-    bersih();
-    gambar_topbar(cfg);
-    hitung_viewport(cfg, &x_awal, &y_awal, &pad_left, &vis_w, &vis_h,
-                    &col_start, &col_end, &row_start, &row_end);
-    gambar_label_kolom(cfg, x_awal, col_start, col_end);
-    gambar_grid_view(cfg, x_awal, y_awal, col_start, col_end, row_start, row_end);
-    gambar_nomor_baris(cfg, y_awal, row_start, row_end);
-    gambar_semua_isi_view(cfg, x_awal, y_awal, col_start, col_end, row_start, row_end);
-    if (clip_has_area) {
-        gambar_area_hijau_view(cfg, x_awal, y_awal, col_start, col_end,
-                               row_start, row_end, clip_x1, clip_y1, clip_x2, clip_y2);
-    }
-    if (selecting) {
-        gambar_seleksi_cyan_view(cfg, x_awal, y_awal, col_start, col_end,
-                                 row_start, row_end, sel_anchor_x, sel_anchor_y,
-                                 cfg->aktif_x, cfg->aktif_y);
+    struct pollfd pfd;
+    if (makro_diputar() || input_tunda_awal < input_tunda_n) {
+        return 1;
     }
-    gambar_sel_aktif_view(cfg, x_awal, y_awal, col_start, col_end, row_start, row_end);
-    gambar_statusbar(cfg);
-    pos(1, 1);
-    tulis_teks("\033[?25l", 6);
-    flush();
+#ifdef TABEL_BENCH
+    (void)pfd;
+    (void)timeout_ms;
+    return 0;
+#else
+    pfd.fd = STDIN_FILENO;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    kinerja.syscall++;
+    return poll(&pfd, 1, timeout_ms) > 0;
+#endif
 }
 
-/* Redraw parsial untuk navigasi */
-/* ============================================================
- * Fungsi Redraw Parsial yang Dioptimalkan (Versi Sempurna)
- * ============================================================ */
-static void redraw_navigasi_parsial(const struct konfigurasi *cfg)
+/* Tanya dukungan mode 2026 lewat DECRQM, diikuti DA1 yang dijawab semua
+ * terminal sehingga kita tahu kapan berhenti menunggu */
+static void deteksi_sinkron_output(void)
 {
-    int x_awal, y_awal, pad_left, vis_w, vis_h;
-    int col_start, col_end, row_start, row_end;
-    
-    /* Hitung viewport saat ini */
-    hitung_viewport(cfg, &x_awal, &y_awal, &pad_left, &vis_w, &vis_h,
-                    &col_start, &col_end, &row_start, &row_end);
-    
-    /* Hapus highlight sel sebelumnya */
-    if (cfg->prev_x >= col_start && cfg->prev_x <= col_end &&
-        cfg->prev_y >= row_start && cfg->prev_y <= row_end) {
-        int w, h, x0, y0, k, line;
-        x0 = x_awal + 1;
-        y0 = y_awal;
-        for (k = col_start; k < cfg->prev_x; k++) {
-            x0 += lebar_kolom[k] + 1;
-        }
-        for (k = row_start; k < cfg->prev_y; k++) {
-            y0 += tinggi_baris[k] + 1;
-        }
-        w = lebar_kolom[cfg->prev_x];
-        h = tinggi_baris[cfg->prev_y];
-        
-        /* Gambar ulang grid di sekitar sel sebelumnya dengan benar */
-        /* Atas */
-        pos(x0 - 1, y0);
-        tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
-        
-        /* Tentukan karakter kiri atas */
-        if (cfg->prev_y == row_start) {
-            if (cfg->prev_x == col_start) {
-                tulis_teks(TL, 3);  /* Sudut kiri atas viewport */
-            } else {
-                tulis_teks(TC, 3);  /* Tengah atas */
-            }
-        } else {
-            if (cfg->prev_x == col_start) {
-                tulis_teks(LC, 3);  /* Tengah kiri */
-            } else {
-                tulis_teks(CR, 3);  /* Persimpangan */
-            }
-        }
-        
-        /* Garis horizontal atas */
-        for (k = 0; k < w; k++) {
-            tulis_teks(H, 3);
-        }
-        
-        /* Tentukan karakter kanan atas */
-        if (cfg->prev_y == row_start) {
-            if (cfg->prev_x == col_end) {
-                tulis_teks(TR, 3);  /* Sudut kanan atas viewport */
-            } else {
-                tulis_teks(TC, 3);  /* Tengah atas */
-            }
-        } else {
-            if (cfg->prev_x == col_end) {
-                tulis_teks(RC, 3);  /* Tengah kanan */
-            } else {
-                tulis_teks(CR, 3);  /* Persimpangan */
-            }
-        }
-        
-        /* Samping kiri dan kanan */
-        for (line = 0; line < h; line++) {
-            pos(x0 - 1, y0 + 1 + line);
-            tulis_teks(V, 3);
-            pos(x0 + w, y0 + 1 + line);
-            tulis_teks(V, 3);
+    char jawab[256];
+    size_t n = 0, i;
+    double batas;
+
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+        return;
+    }
+    write(STDOUT_FILENO, "\033[?2026$p\033[c", 12);
+    batas = waktu_ms() + 200.0;
+    while (n < sizeof(jawab) - 1) {
+        int sisa = (int)(batas - waktu_ms());
+        ssize_t r;
+        if (sisa <= 0 || !input_tersedia(sisa)) {
+            break;
         }
-        
-        /* Bawah */
-        pos(x0 - 1, y0 + h + 1);
-        
-        /* Tentukan karakter kiri bawah */
-        if (cfg->prev_y == row_end) {
-            if (cfg->prev_x == col_start) {
-                tulis_teks(BL, 3);  /* Sudut kiri bawah viewport */
-            } else {
-                tulis_teks(BC, 3);  /* Tengah bawah */
-            }
-        } else {
-            if (cfg->prev_x == col_start) {
-                tulis_teks(LC, 3);  /* Tengah kiri */
-            } else {
-                tulis_teks(CR, 3);  /* Persimpangan */
-            }
+        r = read(STDIN_FILENO, jawab + n, sizeof(jawab) - 1 - n);
+        if (r <= 0) {
+            break;
         }
-        
-        /* Garis horizontal bawah */
-        for (k = 0; k < w; k++) {
-            tulis_teks(H, 3);
+        n += (size_t)r;
+        jawab[n] = '\0';
+        /* Jawaban DA1 berakhir dengan 'c' setelah "\033[?" */
+        if (strstr(jawab, "\033[?") && jawab[n - 1] == 'c') {
+            break;
         }
-        
-        /* Tentukan karakter kanan bawah */
-        if (cfg->prev_y == row_end) {
-            if (cfg->prev_x == col_end) {
-                tulis_teks(BR, 3);  /* Sudut kanan bawah viewport */
-            } else {
-                tulis_teks(BC, 3);  /* Tengah bawah */
+    }
+    jawab[n] = '\0';
+    if (strstr(jawab, "\033[?2026;1$y") || strstr(jawab, "\033[?2026;2$y")) {
+        sinkron_output = 1;
+    }
+
+    /* Simpan ketikan pengguna yang ikut terbaca, buang jawaban terminal */
+    for (i = 0; i < n; i++) {
+        if (jawab[i] == '\033' && i + 2 < n && jawab[i + 1] == '[' &&
+            jawab[i + 2] == '?') {
+            size_t j = i + 3;
+            while (j < n && !(jawab[j] >= 0x40 && jawab[j] <= 0x7E)) {
+                j++;
             }
-        } else {
-            if (cfg->prev_x == col_end) {
-                tulis_teks(RC, 3);  /* Tengah kanan */
-            } else {
-                tulis_teks(CR, 3);  /* Persimpangan */
+            if (j < n && (jawab[j] == 'c' || jawab[j] == 'y')) {
+                i = j;
+                continue;
             }
         }
-        
-        tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
-        
-        /* Gambar kembali isi sel */
-        if (isi[cfg->prev_y][cfg->prev_x][0] != '\0') {
-            gambar_isi_sel_view(cfg, x_awal, y_awal, col_start, row_start,
-                                cfg->prev_x, cfg->prev_y);
+        if (input_tunda_n < (int)sizeof(input_tunda)) {
+            input_tunda[input_tunda_n++] = (unsigned char)jawab[i];
         }
     }
-    
-    /* Gambar area hijau jika ada */
-    if (clip_has_area) {
-        gambar_area_hijau_view(cfg, x_awal, y_awal, col_start, col_end,
-                               row_start, row_end, clip_x1, clip_y1, clip_x2, clip_y2);
+}
+
+static int lebar_terminal(void)
+{
+    struct winsize ws;
+#ifdef TABEL_BENCH
+    return bench_lebar;
+#endif
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1) {
+        return 80;
     }
-    
-    /* Gambar highlight sel aktif */
-    gambar_sel_aktif_view(cfg, x_awal, y_awal, col_start, col_end, row_start, row_end);
-    
-    /* Update topbar dan statusbar */
-    gambar_topbar(cfg);
-    gambar_statusbar(cfg);
-    
-    pos(1, 1);
-    tulis_teks("\033[?25l", 6);
-    flush();
+    return ws.ws_col;
 }
 
-/* Redraw parsial untuk seleksi */
-static void redraw_seleksi_parsial(const struct konfigurasi *cfg)
+static int tinggi_terminal(void)
 {
-    int x_awal, y_awal, pad_left, vis_w, vis_h;
-    int col_start, col_end, row_start, row_end;
-    
-    /* Hitung viewport saat ini */
-    hitung_viewport(cfg, &x_awal, &y_awal, &pad_left, &vis_w, &vis_h,
-                    &col_start, &col_end, &row_start, &row_end);
-    
-    /* Hapus seleksi sebelumnya jika ada */
-    if (prev_sel_x >= 0 && prev_sel_y >= 0) {
-        int minx = sel_anchor_x < prev_sel_x ? sel_anchor_x : prev_sel_x;
-        int maxx = sel_anchor_x > prev_sel_x ? sel_anchor_x : prev_sel_x;
-        int miny = sel_anchor_y < prev_sel_y ? sel_anchor_y : prev_sel_y;
-        int maxy = sel_anchor_y > prev_sel_y ? sel_anchor_y : prev_sel_y;
-        
-        int cs = minx < col_start ? col_start : minx;
-        int ce = maxx > col_end ? col_end : maxx;
-        int rs = miny < row_start ? row_start : miny;
-        int re = maxy > row_end ? row_end : maxy;
-        
-        if (cs <= ce && rs <= re) {
-            int r, c;
-            for (r = rs; r <= re; r++) {
-                for (c = cs; c <= ce; c++) {
-                    /* Gambar kembali grid normal */
-                    int w, h, x0, y0, k, line;
-                    x0 = x_awal + 1;
-                    y0 = y_awal;
-                    for (k = col_start; k < c; k++) {
-                        x0 += lebar_kolom[k] + 1;
-                    }
-                    for (k = row_start; k < r; k++) {
-                        y0 += tinggi_baris[k] + 1;
-                    }
-                    w = lebar_kolom[c];
-                    h = tinggi_baris[r];
-                    
-                    /* Gambar border normal */
-                    tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
-                    pos(x0 - 1, y0);
-                    
-                    /* Tentukan karakter kiri atas */
-                    if (r == row_start) {
-                        if (c == col_start) {
-                            tulis_teks(TL, 3);  /* Sudut kiri atas viewport */
-                        } else {
-                            tulis_teks(TC, 3);  /* Tengah atas */
-                        }
-                    } else {
-                        if (c == col_start) {
-                            tulis_teks(LC, 3);  /* Tengah kiri */
-                        } else {
-                            tulis_teks(CR, 3);  /* Persimpangan */
-                        }
-                    }
-                    
-                    /* Garis horizontal atas */
-                    for (k = 0; k < w; k++) {
-                        tulis_teks(H, 3);
-                    }
-                    
-                    /* Tentukan karakter kanan atas */
-                    if (r == row_start) {
-                        if (c == col_end) {
-                            tulis_teks(TR, 3);  /* Sudut kanan atas viewport */
-                        } else {
-                            tulis_teks(TC, 3);  /* Tengah atas */
-                        }
-                    } else {
-                        if (c == col_end) {
-                            tulis_teks(RC, 3);  /* Tengah kanan */
-                        } else {
-                            tulis_teks(CR, 3);  /* Persimpangan */
-                        }
-                    }
-                    
-                    /* Samping kiri dan kanan */
-                    for (line = 0; line < h; line++) {
-                        pos(x0 - 1, y0 + 1 + line);
-                        tulis_teks(V, 3);
-                        pos(x0 + w, y0 + 1 + line);
-                        tulis_teks(V, 3);
-                    }
-                    
-                    /* Bawah */
-                    pos(x0 - 1, y0 + h + 1);
-                    
-                    /* Tentukan karakter kiri bawah */
-                    if (r == row_end) {
-                        if (c == col_start) {
-                            tulis_teks(BL, 3);  /* Sudut kiri bawah viewport */
-                        } else {
-                            tulis_teks(BC, 3);  /* Tengah bawah */
-                        }
-                    } else {
-                        if (c == col_start) {
-                            tulis_teks(LC, 3);  /* Tengah kiri */
-                        } else {
-                            tulis_teks(CR, 3);  /* Persimpangan */
-                        }
-                    }
-                    
-                    /* Garis horizontal bawah */
-                    for (k = 0; k < w; k++) {
-                        tulis_teks(H, 3);
-                    }
-                    
-                    /* Tentukan karakter kanan bawah */
-                    if (r == row_end) {
-                        if (c == col_end) {
-                            tulis_teks(BR, 3);  /* Sudut kanan bawah viewport */
-                        } else {
-                            tulis_teks(BC, 3);  /* Tengah bawah */
-                        }
-                    } else {
-                        if (c == col_end) {
-                            tulis_teks(RC, 3);  /* Tengah kanan */
-                        } else {
-                            tulis_teks(CR, 3);  /* Persimpangan */
-                        }
-                    }
-                    
-                    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
-                    
-                    /* Gambar kembali isi sel */
-                    if (isi[r][c][0] != '\0') {
-                        gambar_isi_sel_view(cfg, x_awal, y_awal, col_start, row_start, c, r);
-                    }
-                }
-            }
-        }
-    }
-    
-    /* Simpan posisi seleksi saat ini */
-    prev_sel_x = cfg->aktif_x;
-    prev_sel_y = cfg->aktif_y;
-    
-    /* Gambar area hijau jika ada */
-    if (clip_has_area) {
-        gambar_area_hijau_view(cfg, x_awal, y_awal, col_start, col_end,
-                               row_start, row_end, clip_x1, clip_y1, clip_x2, clip_y2);
-    }
-    
-    /* Gambar seleksi baru jika sedang seleksi */
-    if (selecting) {
-        gambar_seleksi_cyan_view(cfg, x_awal, y_awal, col_start, col_end,
-                                 row_start, row_end, sel_anchor_x, sel_anchor_y,
-                                 cfg->aktif_x, cfg->aktif_y);
+    struct winsize ws;
+#ifdef TABEL_BENCH
+    return bench_tinggi;
+#endif
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1) {
+        return 24;
     }
-    
-    /* Gambar highlight sel aktif */
-    gambar_sel_aktif_view(cfg, x_awal, y_awal, col_start, col_end, row_start, row_end);
-    
-    /* Update topbar dan statusbar */
-    gambar_topbar(cfg);
-    gambar_statusbar(cfg);
-    
-    pos(1, 1);
-    tulis_teks("\033[?25l", 6);
-    flush();
+    return ws.ws_row;
 }
 
 /* ============================================================
- * Fungsi Undo/Redo
+ * Fungsi Filter Baris
  * ============================================================ */
-static void push_undo(int x, int y, const char *before, const char *after)
+static int hitung_bit(unsigned long v)
 {
-    if (undo_top >= UNDO_MAX) {
-        undo_top = UNDO_MAX - 1;
-    }
-    undo_stack[undo_top].x = x;
-    undo_stack[undo_top].y = y;
-    strncpy(undo_stack[undo_top].before, before, MAX_TEXT - 1);
-    strncpy(undo_stack[undo_top].after, after, MAX_TEXT - 1);
-    undo_stack[undo_top].before[MAX_TEXT - 1] = '\0';
-    undo_stack[undo_top].after[MAX_TEXT - 1] = '\0';
-    undo_top++;
-    redo_top = 0;
+#if defined(__GNUC__)
+    return __builtin_popcountl(v);
+#else
+    int n = 0;
+    while (v) {
+        v &= v - 1;
+        n++;
+    }
+    return n;
+#endif
 }
 
-static void set_cell_text(struct konfigurasi *cfg, int x, int y,
-                          const char *text, int record_undo)
+/* Posisi bit set ke-k (berbasis nol) di dalam v */
+static int posisi_bit_ke(unsigned long v, int k)
 {
-    char before[MAX_TEXT];
-    strncpy(before, isi[y][x], MAX_TEXT - 1);
-    before[MAX_TEXT - 1] = '\0';
-    strncpy(isi[y][x], text, MAX_TEXT - 1);
-    isi[y][x][MAX_TEXT - 1] = '\0';
-    if (record_undo) {
-        push_undo(x, y, before, isi[y][x]);
+    while (k-- > 0) {
+        v &= v - 1;
     }
+#if defined(__GNUC__)
+    return __builtin_ctzl(v);
+#else
+    {
+        int n = 0;
+        while (!(v & 1UL)) {
+            v >>= 1;
+            n++;
+        }
+        return n;
+    }
+#endif
 }
 
-/* ============================================================
- * Fungsi Navigasi
- * ============================================================ */
-static void move_right(struct konfigurasi *cfg)
+static int baris_terlihat(int r)
 {
-    if (cfg->aktif_x < cfg->kolom - 1) {
-        cfg->prev_x = cfg->aktif_x;
-        cfg->prev_y = cfg->aktif_y;
-        cfg->aktif_x++;
-        
-        /* Cek apakah perlu menggeser viewport */
-        int xa, ya, pad, vw, vh, cs, ce, rs, re;
-        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
-        
-        /* Jika sedang seleksi, update status message dan redraw parsial */
-        if (selecting) {
-            update_seleksi_status(cfg);
-            redraw_seleksi_parsial(cfg);
-        } else {
-            /* Jika sel aktif masih dalam viewport yang sama, gunakan redraw parsial */
-            if (cfg->aktif_x >= cs && cfg->aktif_x <= ce) {
-                redraw_navigasi_parsial(cfg);
-            } else {
-                /* Jika tidak, perlu menggeser viewport dan render penuh */
-                cfg->view_col = cfg->aktif_x;
-                render(cfg);
-            }
-        }
+    if (!filter_aktif) {
+        return 1;
     }
+    return (int)((peta_terlihat[r / BIT_KATA] >> (r % BIT_KATA)) & 1UL);
 }
 
-static void move_left(struct konfigurasi *cfg)
+/* rank: jumlah baris terlihat di [0, r) */
+static int rank_baris(int r)
 {
-    if (cfg->aktif_x > 0) {
-        cfg->prev_x = cfg->aktif_x;
-        cfg->prev_y = cfg->aktif_y;
-        cfg->aktif_x--;
-        
-        /* Cek apakah perlu menggeser viewport */
-        int xa, ya, pad, vw, vh, cs, ce, rs, re;
-        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
-        
-        /* Jika sedang seleksi, update status message dan redraw parsial */
-        if (selecting) {
-            update_seleksi_status(cfg);
-            redraw_seleksi_parsial(cfg);
-        } else {
-            /* Jika sel aktif masih dalam viewport yang sama, gunakan redraw parsial */
-            if (cfg->aktif_x >= cs && cfg->aktif_x <= ce) {
-                redraw_navigasi_parsial(cfg);
-            } else {
-                /* Jika tidak, perlu menggeser viewport dan render penuh */
-                cfg->view_col = cfg->aktif_x;
-                render(cfg);
-            }
-        }
+    int w = r / BIT_KATA, b = r % BIT_KATA;
+    int n = rank_terlihat[w];
+    if (b) {
+        n += hitung_bit(peta_terlihat[w] & ((1UL << b) - 1UL));
     }
+    return n;
 }
 
-static void move_down(struct konfigurasi *cfg)
+/* select: baris terlihat ke-k (berbasis nol) */
+static int select_baris(int k)
 {
-    if (cfg->aktif_y < cfg->baris - 1) {
-        cfg->prev_x = cfg->aktif_x;
-        cfg->prev_y = cfg->aktif_y;
-        cfg->aktif_y++;
-        
-        /* Cek apakah perlu menggeser viewport */
-        int xa, ya, pad, vw, vh, cs, ce, rs, re;
-        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
-        
-        /* Jika sedang seleksi, update status message dan redraw parsial */
-        if (selecting) {
-            update_seleksi_status(cfg);
-            redraw_seleksi_parsial(cfg);
+    int lo = 0, hi = JUMLAH_KATA_FILTER - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (rank_terlihat[mid] <= k) {
+            lo = mid;
         } else {
-            /* Jika sel aktif masih dalam viewport yang sama, gunakan redraw parsial */
-            if (cfg->aktif_y >= rs && cfg->aktif_y <= re) {
-                redraw_navigasi_parsial(cfg);
-            } else {
-                /* Jika tidak, perlu menggeser viewport dan render penuh */
-                cfg->view_row = cfg->aktif_y;
-                render(cfg);
-            }
+            hi = mid - 1;
         }
     }
+    return lo * BIT_KATA + posisi_bit_ke(peta_terlihat[lo], k - rank_terlihat[lo]);
 }
 
-static void move_up(struct konfigurasi *cfg)
+/* Baris terlihat pertama >= r, atau MAKS_BARIS jika tidak ada */
+static int baris_terlihat_dari(int r)
 {
-    if (cfg->aktif_y > 0) {
-        cfg->prev_x = cfg->aktif_x;
-        cfg->prev_y = cfg->aktif_y;
-        cfg->aktif_y--;
-        
-        /* Cek apakah perlu menggeser viewport */
-        int xa, ya, pad, vw, vh, cs, ce, rs, re;
-        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
-        
-        /* Jika sedang seleksi, update status message dan redraw parsial */
-        if (selecting) {
-            update_seleksi_status(cfg);
-            redraw_seleksi_parsial(cfg);
-        } else {
-            /* Jika sel aktif masih dalam viewport yang sama, gunakan redraw parsial */
-            if (cfg->aktif_y >= rs && cfg->aktif_y <= re) {
-                redraw_navigasi_parsial(cfg);
-            } else {
-                /* Jika tidak, perlu menggeser viewport dan render penuh */
-                cfg->view_row = cfg->aktif_y;
-                render(cfg);
-            }
-        }
+    int k;
+    if (!filter_aktif) {
+        return r;
     }
+    k = rank_baris(r);
+    return k >= rank_terlihat[JUMLAH_KATA_FILTER] ? MAKS_BARIS : select_baris(k);
 }
 
-static void ensure_active_visible(struct konfigurasi *cfg)
+/* Baris terlihat terakhir <= r, atau -1 jika tidak ada */
+static int baris_terlihat_sampai(int r)
 {
-    int xa, ya, pad, vw, vh, cs, ce, rs, re;
-    hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
-    
-    /* Geser viewport satu kolom/baris saat ini jika perlu */
-    if (cfg->aktif_x < cs) {
-        cfg->view_col = cfg->aktif_x;
-    } else if (cfg->aktif_x > ce) {
-        cfg->view_col = cfg->aktif_x;
-    }
-    
-    if (cfg->aktif_y < rs) {
-        cfg->view_row = cfg->aktif_y;
-    } else if (cfg->aktif_y > re) {
-        cfg->view_row = cfg->aktif_y;
+    int k;
+    if (!filter_aktif) {
+        return r;
     }
+    k = rank_baris(r + 1);
+    return k == 0 ? -1 : select_baris(k - 1);
 }
 
-/* ============================================================
- * Fungsi Mode Edit
- * ============================================================ */
-static void mode_edit(struct konfigurasi *cfg)
+static int baris_berikut(int r)
 {
-    char buf[MAX_TEXT];
-    int len, cursor;
-    unsigned char ch;
-    char kol = (char)('A' + cfg->aktif_x);
-    int bar = cfg->aktif_y + 1;
-    char label[64];
-    int input_x;
+    return filter_aktif ? baris_terlihat_dari(r + 1) : r + 1;
+}
 
-    strncpy(buf, isi[cfg->aktif_y][cfg->aktif_x], MAX_TEXT - 1);
-    buf[MAX_TEXT - 1] = '\0';
-    len = (int)strlen(buf);
-    cursor = len;
-    snprintf(label, sizeof(label), "kolom %c%d: ", kol, bar);
-    input_x = 2 + (int)strlen(label);
+static int baris_sebelum(int r)
+{
+    return filter_aktif ? baris_terlihat_sampai(r - 1) : r - 1;
+}
 
-    /* Tampilkan label + isi lama */
-    pos(1, 1);
-    {
-        int i;
-        for (i = 0; i < lebar_terminal(); i++) {
-            tulis_teks(" ", 1);
+static int cocok_predikat(const struct predikat_filter *p, const char *teks)
+{
+    if (p->jenis == FILTER_SAMA) {
+        return teks == p->intern;
+    } else if (p->jenis == FILTER_MEMUAT) {
+        return strstr(teks, p->teks) != NULL;
+    } else {
+        char *akhir;
+        double v = strtod(teks, &akhir);
+        if (akhir == teks) {
+            return 0;
         }
+        return v >= p->min && v <= p->max;
     }
-    pos(2, 1);
-    tulis_teks(label, strlen(label));
-    tulis_teks(buf, (size_t)len);
-    {
-        char judul[] = "TABEL v0.7";
-        pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
-        tulis_teks(judul, strlen(judul));
-    }
-    pos(input_x + cursor, 1);
-    tulis_teks("\033[?25h", 6);
-    flush();
+}
 
-    while (read(STDIN_FILENO, &ch, 1) > 0) {
-        if (ch == '\n' || ch == '\r') {
-            set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, buf, 1);
-            snprintf(status_msg, sizeof(status_msg), "Mengubah isi kolom %c%d", kol, bar);
-            break;
-        } else if (ch == '\t') {
-            set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, buf, 1);
-            move_right(cfg);
-            ensure_active_visible(cfg);
-            render(cfg);
-            /* Lanjut ke sel berikutnya */
-            mode_edit(cfg);
-            return;
-        } else if (ch == 0x1B) {
-            unsigned char s1;
-            if (read(STDIN_FILENO, &s1, 1) <= 0) {
-                continue;
-            }
-            if (s1 == '[') {
-                unsigned char s2;
-                if (read(STDIN_FILENO, &s2, 1) <= 0) {
-                    continue;
-                }
-                if (s2 == 'D') {
-                    if (cursor > 0) {
-                        cursor--;
-                    }
-                } else if (s2 == 'C') {
-                    if (cursor < len) {
-                        cursor++;
-                    }
-                } else if (s2 == '3') {
-                    unsigned char t;
-                    if (read(STDIN_FILENO, &t, 1) <= 0) {
-                        continue;
-                    }
-                    if (t == '~') {
-                        if (cursor < len) {
-                            memmove(buf + cursor, buf + cursor + 1,
-                                    (size_t)(len - cursor));
-                            len--;
-                        }
-                    }
+/* Hitung ulang bitmap baris terlihat dari semua predikat dalam satu
+ * lintasan per kata bitmap, lalu bangun ulang tabel rank */
+static int evaluasi_filter(void)
+{
+    int w, r, k;
+
+    /* Kesamaan cukup dibandingkan per pointer; NULL tidak cocok apa pun */
+    for (k = 0; k < jumlah_predikat; k++) {
+        if (predikat_filter[k].jenis == FILTER_SAMA) {
+            predikat_filter[k].intern = cari_intern(predikat_filter[k].teks);
+        }
+    }
+    for (w = 0; w < JUMLAH_KATA_FILTER; w++) {
+        unsigned long bits = 0;
+        int awal = w * BIT_KATA;
+        int akhir = awal + BIT_KATA;
+        if (akhir > filter_baris) {
+            akhir = filter_baris;
+        }
+        for (r = awal; r < akhir; r++) {
+            for (k = 0; k < jumlah_predikat; k++) {
+                if (!cocok_predikat(&predikat_filter[k], isi[r][predikat_filter[k].kolom])) {
+                    break;
                 }
             }
-        } else if (ch == 0x7F) {
-            if (cursor > 0) {
-                memmove(buf + cursor - 1, buf + cursor,
-                        (size_t)(len - (cursor - 1)));
-                cursor--;
-                len--;
-            }
-        } else if (ch >= 0x20 && ch <= 0x7E) {
-            if (len < MAX_TEXT - 1) {
-                memmove(buf + cursor + 1, buf + cursor,
-                        (size_t)(len - cursor));
-                buf[cursor] = (char)ch;
-                cursor++;
-                len++;
-                buf[len] = '\0';
-            }
-        }
-
-        /* Update tampilan */
-        pos(1, 1);
-        {
-            int i;
-            for (i = 0; i < lebar_terminal(); i++) {
-                tulis_teks(" ", 1);
+            if (k == jumlah_predikat) {
+                bits |= 1UL << (r - awal);
             }
         }
-        pos(2, 1);
-        tulis_teks(label, strlen(label));
-        tulis_teks(buf, (size_t)len);
-        {
-            char judul[] = "TABEL v0.7";
-            pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
-            tulis_teks(judul, strlen(judul));
-        }
-        pos(input_x + cursor, 1);
-        flush();
+        peta_terlihat[w] = bits;
+        rank_terlihat[w + 1] = rank_terlihat[w] + hitung_bit(bits);
     }
+    filter_aktif = jumlah_predikat > 0;
+    return rank_terlihat[JUMLAH_KATA_FILTER];
+}
 
-    tulis_teks("\033[?25l", 6);
-    render(cfg);
+static void hapus_filter(void)
+{
+    jumlah_predikat = 0;
+    filter_aktif = 0;
+}
+
+/* Isi sel bergeser (sort/undo): evaluasi ulang predikat yang aktif */
+static void perbarui_filter(void)
+{
+    if (filter_aktif) {
+        evaluasi_filter();
+    }
 }
 
 /* ============================================================
- * Fungsi Command Line
+ * Fungsi Utilitas Grid
  * ============================================================ */
-static int evaluasi_formula(const char *formula, double *hasil)
+/* Susun satu garis grid untuk kolom col_start..col_end: kiri, lalu tiap
+ * kolom diisi `isi` selebar kolom dan ditutup `tengah`/`kanan` */
+static int susun_garis_grid(struct buffer *buf, int col_start, int col_end,
+                            const char *kiri, const char *tengah,
+                            const char *kanan, const char *isi_garis)
 {
-    /* Implementasi sederhana untuk evaluasi formula */
-    /* Contoh: :SUM A1-A8 atau :AVG A1-D4 */
-    char formula_copy[MAX_FORMULA_LENGTH];
-    char *token;
-    char fungsi[16];
-    int x1, y1, x2, y2;
-    double total = 0.0;
-    int count = 0;
-    int y;
+    size_t n = strlen(isi_garis);
+    int c, k;
 
-    if (formula[0] != ':') {
+    reset_buffer(buf);
+    if (tulis_buffer(buf, kiri, strlen(kiri)) < 0) {
         return -1;
     }
-
-    strncpy(formula_copy, formula, MAX_FORMULA_LENGTH - 1);
-    formula_copy[MAX_FORMULA_LENGTH - 1] = '\0';
-
-    token = strtok(formula_copy + 1, " ");
-    if (!token) {
-        return -1;
+    for (c = col_start; c <= col_end; c++) {
+        for (k = 0; k < lebar_kolom[c]; k++) {
+            if (tulis_buffer(buf, isi_garis, n) < 0) {
+                return -1;
+            }
+        }
+        if (tulis_buffer(buf, c < col_end ? tengah : kanan, 3) < 0) {
+            return -1;
+        }
     }
+    return 0;
+}
 
-    strncpy(fungsi, token, sizeof(fungsi) - 1);
-    fungsi[sizeof(fungsi) - 1] = '\0';
-
-    token = strtok(NULL, " ");
-    if (!token) {
-        return -1;
+/* Template garis atas/pemisah/isi/bawah disusun sekali per layout dan
+ * hanya dibangun ulang jika rentang kolom atau lebar_kolom berubah. Slot
+ * yang diganti adalah yang tidak dipakai frame berjalan, agar pane beku
+ * dan pane utama tidak saling mengusir dan rujukan segmen frame tetap
+ * sah sampai flush. */
+static const struct templat_grid *siapkan_templat_grid(int col_start, int col_end)
+{
+    struct templat_grid *t;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        t = &templat_grid[i];
+        if (t->valid && t->col_start == col_start && t->col_end == col_end &&
+            t->versi == versi_lebar) {
+            t->frame = nomor_frame;
+            return t;
+        }
     }
-
-    /* Parse koordinat pertama */
-    if (token[0] >= 'A' && token[0] <= 'Z') {
-        x1 = token[0] - 'A';
-        y1 = atoi(token + 1) - 1;
-    } else {
-        return -1;
+    t = &templat_grid[templat_grid[0].frame <= templat_grid[1].frame ? 0 : 1];
+    if (t->valid && t->frame == nomor_frame && jumlah_segmen > 0) {
+        /* Kedua slot dirujuk frame ini: kirim dulu sebelum ditimpa */
+        flush();
     }
-
-    token = strtok(NULL, " ");
-    if (!token) {
-        /* Hanya satu sel */
-        if (isi[y1][x1][0] != '\0') {
-            *hasil = atof(isi[y1][x1]);
-        } else {
-            *hasil = 0.0;
+    if (!t->atas.data) {
+        if (inisialisasi_buffer(&t->atas, 1024) != 0 ||
+            inisialisasi_buffer(&t->pemisah, 1024) != 0 ||
+            inisialisasi_buffer(&t->isi, 1024) != 0 ||
+            inisialisasi_buffer(&t->bawah, 1024) != 0) {
+            return NULL;
         }
-        return 0;
     }
-
-    /* Parse koordinat kedua */
-    if (token[0] >= 'A' && token[0] <= 'Z') {
-        x2 = token[0] - 'A';
-        y2 = atoi(token + 1) - 1;
-    } else {
-        return -1;
+    t->valid = 0;
+    if (susun_garis_grid(&t->atas, col_start, col_end, TL, TC, TR, H) != 0 ||
+        susun_garis_grid(&t->pemisah, col_start, col_end, LC, CR, RC, H) != 0 ||
+        susun_garis_grid(&t->isi, col_start, col_end, V, V, V, " ") != 0 ||
+        susun_garis_grid(&t->bawah, col_start, col_end, BL, BC, BR, H) != 0) {
+        return NULL;
     }
+    t->col_start = col_start;
+    t->col_end = col_end;
+    t->versi = versi_lebar;
+    t->lebar = 1;
+    for (i = col_start; i <= col_end; i++) {
+        t->lebar += lebar_kolom[i] + 1;
+    }
+    t->frame = nomor_frame;
+    t->valid = 1;
+    return t;
+}
 
-    /* Hitung berdasarkan fungsi */
-    for (y = y1; y <= y2; y++) {
-        int x;
-        for (x = x1; x <= x2; x++) {
-            if (isi[y][x][0] != '\0') {
-                total += atof(isi[y][x]);
-                count++;
-            }
-        }
+static void gambar_grid_view(const struct konfigurasi *cfg,
+                             int x_awal, int y_awal,
+                             int col_start, int col_end,
+                             int row_start, int row_end)
+{
+    const struct templat_grid *t = siapkan_templat_grid(col_start, col_end);
+    int r, line, y_top = y_awal;
+
+    if (!t) {
+        return;
     }
+    tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
 
-    if (strcmp(fungsi, "SUM") == 0) {
-        *hasil = total;
-    } else if (strcmp(fungsi, "AVG") == 0) {
-        *hasil = count > 0 ? total / count : 0.0;
-    } else if (strcmp(fungsi, "COUNT") == 0) {
-        *hasil = count;
-    } else if (strcmp(fungsi, "MAX") == 0) {
-        double max = 0.0;
-        int first = 1;
-        for (y = y1; y <= y2; y++) {
-            int x;
-            for (x = x1; x <= x2; x++) {
-                if (isi[y][x][0] != '\0') {
-                    double val = atof(isi[y][x]);
-                    if (first || val > max) {
-                        max = val;
-                        first = 0;
-                    }
-                }
-            }
-        }
-        *hasil = first ? 0.0 : max;
-    } else if (strcmp(fungsi, "MIN") == 0) {
-        double min = 0.0;
-        int first = 1;
-        for (y = y1; y <= y2; y++) {
-            int x;
-            for (x = x1; x <= x2; x++) {
-                if (isi[y][x][0] != '\0') {
-                    double val = atof(isi[y][x]);
-                    if (first || val < min) {
-                        min = val;
-                        first = 0;
-                    }
-                }
-            }
+    /* Garis atas viewport */
+    pos(x_awal, y_awal);
+    tulis_templat(t, &t->atas);
+
+    /* Body grid: tiap baris layar cukup satu salinan template */
+    for (r = row_start; r <= row_end; r = baris_berikut(r)) {
+        int h = tinggi_baris[r];
+        const struct buffer *garis = r < row_end ? &t->pemisah : &t->bawah;
+
+        for (line = 0; line < h; line++) {
+            pos(x_awal, y_top + 1 + line);
+            tulis_templat(t, &t->isi);
         }
-        *hasil = first ? 0.0 : min;
-    } else {
-        return -1;
+        pos(x_awal, y_top + h + 1);
+        tulis_templat(t, garis);
+        y_top += h + 1;
     }
 
-    return 0;
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
 }
 
-static void mode_command_line(struct konfigurasi *cfg)
+/* ============================================================
+ * Fungsi Tata Letak Sel
+ * ============================================================ */
+static void invalidasi_letak_sel(int x, int y)
 {
-    char buf[MAX_TEXT];
-    int len, cursor;
-    unsigned char ch;
-    char label[64];
-    int input_x;
+    free(cache_letak[y][x]);
+    cache_letak[y][x] = NULL;
+}
 
-    buf[0] = ':';
-    buf[1] = '\0';
-    len = 1;
-    cursor = 1;
-    snprintf(label, sizeof(label), "formula");
-    input_x = 2 + (int)strlen(label);
+/* Posisi wrap isi sel (r, c) per kode poin UTF-8 sesuai lebar tampilan;
+ * dihitung sekali lalu dipakai ulang sampai isi atau lebar kolom berubah */
+static const struct letak_sel *ambil_letak_sel(int r, int c)
+{
+    struct letak_sel *lt = cache_letak[r][c];
+    struct potongan_baris garis[MAX_TEXT];
+    const char *teks = isi[r][c];
+    int w = lebar_kolom[c], len, i = 0, n = 0;
 
-    /* Tampilkan label + isi lama */
-    pos(1, 1);
-    {
-        int i;
-        for (i = 0; i < lebar_terminal(); i++) {
-            tulis_teks(" ", 1);
+    if (lt && lt->lebar == w && lt->versi == versi_isi) {
+        return lt;
+    }
+    invalidasi_letak_sel(c, r);
+
+    len = (int)strlen(teks);
+    while (i < len) {
+        struct potongan_baris *g = &garis[n++];
+        g->awal = (short)i;
+        g->panjang = 0;
+        g->lebar = 0;
+        while (i < len) {
+            unsigned int cp;
+            int nb = dekode_utf8(teks + i, len - i, &cp);
+            int cw = lebar_kodepoin(cp);
+            if (g->panjang > 0 && g->lebar + cw > w) {
+                break;
+            }
+            g->panjang = (short)(g->panjang + nb);
+            g->lebar = (short)(g->lebar + cw);
+            i += nb;
         }
     }
-    pos(2, 1);
-    tulis_teks(label, strlen(label));
-    tulis_teks(buf, (size_t)len);
-    {
-        char judul[] = "TABEL v0.7";
-        pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
-        tulis_teks(judul, strlen(judul));
+
+    lt = malloc(sizeof(*lt) + (size_t)(n > 1 ? n - 1 : 0) * sizeof(lt->garis[0]));
+    if (!lt) {
+        return NULL;
     }
-    pos(input_x + cursor, 1);
-    tulis_teks("\033[?25h", 6);
-    flush();
+    lt->lebar = w;
+    lt->versi = versi_isi;
+    lt->jumlah = n;
+    memcpy(lt->garis, garis, (size_t)n * sizeof(garis[0]));
+    cache_letak[r][c] = lt;
+    return lt;
+}
 
-    while (read(STDIN_FILENO, &ch, 1) > 0) {
-        if (ch == '\n' || ch == '\r') {
-            double hasil;
-            if (evaluasi_formula(buf, &hasil) == 0) {
-                snprintf(buf, MAX_TEXT, "%.2f", hasil);
-                set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, buf, 1);
-                snprintf(status_msg, sizeof(status_msg), "Formula dievaluasi");
-            } else {
-                snprintf(status_msg, sizeof(status_msg), "Formula tidak valid");
-            }
-            break;
-        } else if (ch == 0x1B) {
-            unsigned char s1;
-            if (read(STDIN_FILENO, &s1, 1) <= 0) {
-                continue;
-            }
-            if (s1 == '[') {
-                unsigned char s2;
-                if (read(STDIN_FILENO, &s2, 1) <= 0) {
-                    continue;
-                }
-                if (s2 == 'D') {
-                    if (cursor > 1) {
-                        cursor--;
-                    }
-                } else if (s2 == 'C') {
-                    if (cursor < len) {
-                        cursor++;
-                    }
-                } else if (s2 == '3') {
-                    unsigned char t;
-                    if (read(STDIN_FILENO, &t, 1) <= 0) {
-                        continue;
-                    }
-                    if (t == '~') {
-                        if (cursor < len) {
-                            memmove(buf + cursor, buf + cursor + 1,
-                                    (size_t)(len - cursor));
-                            len--;
-                        }
-                    }
-                }
-            }
-        } else if (ch == 0x7F) {
-            if (cursor > 1) {
-                memmove(buf + cursor - 1, buf + cursor,
-                        (size_t)(len - (cursor - 1)));
-                cursor--;
-                len--;
-            }
-        } else if (ch >= 0x20 && ch <= 0x7E) {
-            if (len < MAX_TEXT - 1) {
-                memmove(buf + cursor + 1, buf + cursor,
-                        (size_t)(len - cursor));
-                buf[cursor] = (char)ch;
-                cursor++;
-                len++;
-                buf[len] = '\0';
-            }
-        }
+/* ============================================================
+ * Fungsi Gaya Sel
+ * ============================================================ */
+/* Gaya disimpan per run kolom, bukan per sel: memformat satu kolom penuh
+ * cukup satu run. Render menggambar baris berurutan, jadi pencarian run
+ * hampir selalu selesai di petunjuk atau run sesudahnya */
 
-        /* Update tampilan */
-        pos(1, 1);
-        {
-            int i;
-            for (i = 0; i < lebar_terminal(); i++) {
-                tulis_teks(" ", 1);
-            }
+/* Indeks run kolom k yang memuat baris y; k->jumlah > 0 */
+static int cari_run(struct kolom_gaya *k, int y)
+{
+    int i = k->petunjuk, lo, hi;
+
+    if (i < k->jumlah && k->run[i].awal <= y) {
+        if (i + 1 == k->jumlah || k->run[i + 1].awal > y) {
+            return i;
         }
-        pos(2, 1);
-        tulis_teks(label, strlen(label));
-        tulis_teks(buf, (size_t)len);
-        {
-            char judul[] = "TABEL v0.7";
-            pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
-            tulis_teks(judul, strlen(judul));
+        if (i + 2 == k->jumlah || k->run[i + 2].awal > y) {
+            k->petunjuk = i + 1;
+            return i + 1;
         }
-        pos(input_x + cursor, 1);
-        flush();
     }
+    /* Run terakhir dengan awal <= y; run[0].awal selalu 0 */
+    lo = 0;
+    hi = k->jumlah - 1;
+    while (lo < hi) {
+        int m = (lo + hi + 1) / 2;
+        if (k->run[m].awal <= y) {
+            lo = m;
+        } else {
+            hi = m - 1;
+        }
+    }
+    k->petunjuk = lo;
+    return lo;
+}
 
-    tulis_teks("\033[?25l", 6);
-    render(cfg);
+static int gaya_pada(struct kolom_gaya *k, int y)
+{
+    return k->jumlah > 0 ? k->run[cari_run(k, y)].gaya : 0;
 }
 
-/* ============================================================
- * Fungsi File I/O
- * ============================================================ */
-static int simpan_csv(const char *nama_file, struct konfigurasi *cfg)
+/* Indeks g di tabel_gaya, ditambahkan jika belum ada; -1 jika penuh */
+static int cari_gaya(const struct gaya *g)
 {
-    FILE *file = fopen(nama_file, "w");
-    int y, x;
-    
-    if (!file) {
-        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %s", nama_file);
-        return -1;
-    }
+    int i;
 
-    for (y = 0; y < cfg->baris; y++) {
-        for (x = 0; x < cfg->kolom; x++) {
-            if (x > 0) {
-                fprintf(file, ",");
-            }
-            fprintf(file, "\"%s\"", isi[y][x]);
+    for (i = 0; i < jumlah_gaya; i++) {
+        if (tabel_gaya[i].align == g->align && tabel_gaya[i].desimal == g->desimal &&
+            tabel_gaya[i].warna == g->warna && tabel_gaya[i].tebal == g->tebal) {
+            return i;
         }
-        fprintf(file, "\n");
     }
+    if (jumlah_gaya >= MAKS_GAYA) {
+        snprintf(status_msg, sizeof(status_msg), "Maksimal %d gaya berbeda", MAKS_GAYA);
+        return -1;
+    }
+    tabel_gaya[jumlah_gaya] = *g;
+    return jumlah_gaya++;
+}
 
-    fclose(file);
-    snprintf(status_msg, sizeof(status_msg), "File CSV disimpan: %s", nama_file);
-    return 0;
+/* Tambah run di akhir kecuali gayanya sama dengan run sebelumnya */
+static void dorong_run(struct run_gaya *run, int *n, int awal, int gaya)
+{
+    if (*n > 0 && run[*n - 1].gaya == gaya) {
+        return;
+    }
+    run[*n].awal = awal;
+    run[*n].gaya = gaya;
+    (*n)++;
 }
 
-static int simpan_txt(const char *nama_file, struct konfigurasi *cfg)
+/* Ganti run baris y1..y2 kolom k dengan `tengah` (n run urut, yang
+ * pertama berawal di y1). Run di luar rentang dipertahankan dan run
+ * bertetangga yang sama digabung. Run lama dipindah ke *lama; -1 jika
+ * memori habis dan k tidak berubah */
+static int sambung_run(struct kolom_gaya *k, int y1, int y2,
+                       const struct run_gaya *tengah, int n,
+                       struct kolom_gaya *lama)
 {
-    FILE *file = fopen(nama_file, "w");
-    int y, x;
-    
-    if (!file) {
-        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %s", nama_file);
+    struct run_gaya *baru = malloc((size_t)(k->jumlah + n + 2) * sizeof(*baru));
+    int m = 0, i, sesudah = 0;
+
+    if (!baru) {
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk gaya");
         return -1;
     }
-
-    for (y = 0; y < cfg->baris; y++) {
-        for (x = 0; x < cfg->kolom; x++) {
-            if (x > 0) {
-                fprintf(file, "\t");
+    if (y2 + 1 < MAKS_BARIS) {
+        sesudah = gaya_pada(k, y2 + 1);
+    }
+    if (k->jumlah == 0 && y1 > 0) {
+        dorong_run(baru, &m, 0, 0);
+    }
+    for (i = 0; i < k->jumlah && k->run[i].awal < y1; i++) {
+        dorong_run(baru, &m, k->run[i].awal, k->run[i].gaya);
+    }
+    for (i = 0; i < n; i++) {
+        dorong_run(baru, &m, tengah[i].awal, tengah[i].gaya);
+    }
+    if (y2 + 1 < MAKS_BARIS) {
+        dorong_run(baru, &m, y2 + 1, sesudah);
+        for (i = 0; i < k->jumlah; i++) {
+            if (k->run[i].awal > y2 + 1) {
+                dorong_run(baru, &m, k->run[i].awal, k->run[i].gaya);
             }
-            fprintf(file, "%s", isi[y][x]);
         }
-        fprintf(file, "\n");
     }
-
-    fclose(file);
-    snprintf(status_msg, sizeof(status_msg), "File TXT disimpan: %s", nama_file);
+    if (m == 1 && baru[0].gaya == 0) {
+        m = 0;
+    }
+    if (m == 0) {
+        free(baru);
+        baru = NULL;
+    }
+    *lama = *k;
+    k->run = baru;
+    k->jumlah = m;
+    k->petunjuk = 0;
     return 0;
 }
 
-static int baca_csv(const char *nama_file, struct konfigurasi *cfg)
+/* Gaya baris y1..y1+n-1 kolom x ikut permutasi sort: baris baru ke-i
+ * memakai gaya baris lama ke-perm[i]. Rentang seragam tidak disentuh */
+static int permutasi_gaya(int x, int y1, int n, const int *perm)
 {
-    FILE *file = fopen(nama_file, "r");
-    char baris[MAX_TEXT * MAKS_KOLOM];
-    int y = 0;
-    int max_x = 0;
-    char *token;
-    int x;
+    struct kolom_gaya *k = &gaya_kolom[x], lama;
+    struct run_gaya *tengah;
+    int *g, i, m = 0, st;
+
+    if (k->jumlah == 0 || cari_run(k, y1) == cari_run(k, y1 + n - 1)) {
+        return 0;
+    }
+    g = malloc((size_t)n * sizeof(int));
+    tengah = malloc((size_t)n * sizeof(*tengah));
+    if (!g || !tengah) {
+        free(g);
+        free(tengah);
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        g[i] = gaya_pada(k, y1 + i);
+    }
+    for (i = 0; i < n; i++) {
+        dorong_run(tengah, &m, y1 + i, g[perm[i]]);
+    }
+    st = sambung_run(k, y1, y1 + n - 1, tengah, m, &lama);
+    if (st == 0) {
+        free(lama.run);
+    }
+    free(g);
+    free(tengah);
+    return st;
+}
+
+/* Buang k baris teratas dari run semua kolom; baris di bawah mewarisi
+ * gaya run terakhir */
+static void geser_gaya(int k)
+{
+    int x, i, m;
+
+    for (x = 0; x < MAKS_KOLOM; x++) {
+        struct kolom_gaya *kg = &gaya_kolom[x];
+        if (kg->jumlah == 0) {
+            continue;
+        }
+        i = cari_run(kg, k);
+        kg->run[i].awal = k;
+        for (m = 0; i < kg->jumlah; i++, m++) {
+            kg->run[m].awal = kg->run[i].awal - k;
+            kg->run[m].gaya = kg->run[i].gaya;
+        }
+        kg->jumlah = m;
+        kg->petunjuk = 0;
+        if (m == 1 && kg->run[0].gaya == 0) {
+            free(kg->run);
+            kg->run = NULL;
+            kg->jumlah = 0;
+        }
+    }
+}
+
+/* Teks angka dengan `desimal` angka di belakang koma; 0 jika teks bukan
+ * angka */
+static int format_desimal(const char *teks, int desimal, char *out, size_t ukuran)
+{
+    char *akhir;
+    double v;
+    int n;
+
+    if (teks[0] == '\0') {
+        return 0;
+    }
+    v = strtod(teks, &akhir);
+    while (*akhir == ' ') {
+        akhir++;
+    }
+    if (akhir == teks || *akhir != '\0') {
+        return 0;
+    }
+    n = snprintf(out, ukuran, "%.*f", desimal, v);
+    return n > 0 && (size_t)n < ukuran ? n : 0;
+}
+
+/* Warna dan tebal gaya untuk teks berikutnya; pemanggil memulihkan
+ * sgr_diminta sesudahnya */
+static void pakai_gaya_teks(const struct gaya *g)
+{
+    if (g->warna >= 0) {
+        sgr_diminta.fg = g->warna;
+    }
+    if (g->tebal) {
+        sgr_diminta.tebal = 1;
+    }
+}
+
+/* ============================================================
+ * Fungsi Utilitas Sel
+ * ============================================================ */
+static void gambar_isi_sel_view(const struct konfigurasi *cfg,
+                                int x_awal, int y_awal,
+                                int col_start, int row_start,
+                                int c, int r)
+{
+    const char *teks = isi[r][c];
+    const struct letak_sel *lt = ambil_letak_sel(r, c);
+    const struct gaya *gy = &tabel_gaya[gaya_pada(&gaya_kolom[c], r)];
+    struct atribut_sgr sgr_lama = sgr_diminta;
+    char angka[64];
+    int w, h, x0, y0, i, line, n_angka = 0;
+
+    kinerja.sel_berjalan++;
+    /* Hitung posisi sel */
+    x0 = x_awal + 1;
+    y0 = y_awal;
+    for (i = col_start; i < c; i++) {
+        x0 += lebar_kolom[i] + 1;
+    }
+    for (i = row_start; i < r; i = baris_berikut(i)) {
+        y0 += tinggi_baris[i] + 1;
+    }
+    w = lebar_kolom[c];
+    h = tinggi_baris[r];
+
+    if (gy->desimal >= 0) {
+        n_angka = format_desimal(teks, gy->desimal, angka, sizeof(angka));
+    }
+    if (n_angka > 0) {
+        /* Angka berformat: satu baris, penuh "#" jika tidak muat */
+        int offset = 0;
+        for (line = 0; line < h; line++) {
+            pos(x0, y0 + 1 + line);
+            hapus_sel_layar(w);
+        }
+        if (n_angka > w) {
+            n_angka = w;
+            memset(angka, '#', (size_t)n_angka);
+        }
+        if (gy->align == CENTER) {
+            offset = (w - n_angka) / 2;
+        } else if (gy->align == RIGHT) {
+            offset = w - n_angka;
+        }
+        pos(x0 + offset, y0 + 1);
+        pakai_gaya_teks(gy);
+        tulis_teks(angka, (size_t)n_angka);
+        sgr_diminta = sgr_lama;
+        return;
+    }
+
+    /* Gambar teks dengan autowrap dari cache letak */
+    for (line = 0; line < h; line++) {
+        const struct potongan_baris *g;
+        int offset = 0, panjang;
+        pos(x0, y0 + 1 + line);
+        hapus_sel_layar(w);
+        if (!lt || line >= lt->jumlah) {
+            continue;
+        }
+        g = &lt->garis[line];
+        if (g->lebar > w) {
+            /* Karakter lebar ganda di kolom selebar 1 */
+            continue;
+        }
+        if (gy->align == CENTER) {
+            offset = (w - g->lebar) / 2;
+        } else if (gy->align == RIGHT) {
+            offset = (w - g->lebar);
+        }
+        if (offset < 0) {
+            offset = 0;
+        }
+        panjang = g->panjang;
+        if (line == h - 1 && lt->jumlah > h) {
+            /* Baris terakhir yang terpotong menyisakan satu kolom untuk
+             * tanda elipsis tanpa membelah karakter lebar ganda */
+            int lebar = 0, i_byte = 0;
+            while (i_byte < g->panjang) {
+                unsigned int cp;
+                int nb = dekode_utf8(teks + g->awal + i_byte, g->panjang - i_byte, &cp);
+                int cw = lebar_kodepoin(cp);
+                if (lebar + cw > w - 1) {
+                    break;
+                }
+                lebar += cw;
+                i_byte += nb;
+            }
+            panjang = i_byte;
+        }
+        pos(x0 + offset, y0 + 1 + line);
+        pakai_gaya_teks(gy);
+        tulis_teks(teks + g->awal, (size_t)panjang);
+        sgr_diminta = sgr_lama;
+        if (line + 1 >= lt->jumlah) {
+            break;
+        }
+    }
+    if (lt && lt->jumlah > h && h > 0 && w > 0) {
+        pos(x0 + w - 1, y0 + h);
+        tulis_teks("…", 3);
+    }
+}
+
+/* ============================================================
+ * Fungsi Utilitas UI
+ * ============================================================ */
+/* Deretan tab sheet yang berakhir sebelum kolom layar kanan; sheet aktif
+ * ditandai [nama]. Jika tidak muat, cukup "[k/n nama]" */
+static void gambar_tab_sheet(int kanan, int kiri)
+{
+    char strip[MAKS_SHEET * (MAKS_NAMA_SHEET + 3)];
+    size_t n = 0;
+    int s;
+
+    for (s = 0; s < jumlah_sheet; s++) {
+        n += (size_t)snprintf(strip + n, sizeof(strip) - n,
+                              s == sheet_aktif ? "[%s] " : " %s  ",
+                              sheet[s]->nama);
+    }
+    if ((int)n > kanan - kiri) {
+        n = (size_t)snprintf(strip, sizeof(strip), "[%d/%d %s] ", sheet_aktif + 1,
+                             jumlah_sheet, sheet[sheet_aktif]->nama);
+        if ((int)n > kanan - kiri) {
+            return;
+        }
+    }
+    pos(kanan - (int)n + 1, 1);
+    tulis_teks(strip, n);
+}
+
+static void gambar_topbar(const struct konfigurasi *cfg)
+{
+    int cols = lebar_terminal();
+    char judul[] = "TABEL v0.7";
+    char label[512];
+    char kol = (char)('A' + cfg->aktif_x);
+    int bar = cfg->aktif_y + 1;
+
+    /* Background gelap untuk top bar */
+    tulis_teks(BG_DARK, sizeof(BG_DARK) - 1);
+    kosongkan_baris(1);
+
+    if (isi[cfg->aktif_y][cfg->aktif_x][0] == '\0') {
+        snprintf(label, sizeof(label), "kolom %c%d:", kol, bar);
+    } else {
+        snprintf(label, sizeof(label), "kolom %c%d: %s", kol, bar,
+                 isi[cfg->aktif_y][cfg->aktif_x]);
+    }
+
+    pos(2, 1);
+    tulis_teks(FG_WHITE, sizeof(FG_WHITE) - 1);
+    tulis_teks(label, strlen(label));
+    pos(cols - (int)strlen(judul) - 1, 1);
+    tulis_teks(FG_GRAY, sizeof(FG_GRAY) - 1);
+    tulis_teks(judul, strlen(judul));
+    if (jumlah_sheet > 1) {
+        gambar_tab_sheet(cols - (int)strlen(judul) - 2, 2 + (int)strlen(label) + 2);
+    }
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+}
+
+/* RSS dari /proc/self/statm, dibaca paling sering tiap 500 ms; -1 jika
+ * tidak tersedia */
+static long rss_kb(void)
+{
+    double kini = waktu_ms();
+    if (kini >= kinerja.rss_berikut) {
+        FILE *f = fopen("/proc/self/statm", "r");
+        long total, resident;
+        kinerja.rss_kb = -1;
+        if (f) {
+            if (fscanf(f, "%ld %ld", &total, &resident) == 2) {
+                kinerja.rss_kb = resident * (sysconf(_SC_PAGESIZE) / 1024);
+            }
+            fclose(f);
+        }
+        kinerja.rss_berikut = kini + 500.0;
+    }
+    return kinerja.rss_kb;
+}
+
+/* Statistik frame sebelumnya: waktu, byte, sel berisi yang digambar,
+ * syscall per tombol, waktu formula terakhir, RSS dan jurnal undo */
+static void susun_hud(char *out, size_t ukuran_out)
+{
+    long rss = rss_kb();
+    char teks_rss[24];
+
+    if (rss >= 0) {
+        snprintf(teks_rss, sizeof(teks_rss), "%ldM", rss / 1024);
+    } else {
+        snprintf(teks_rss, sizeof(teks_rss), "-");
+    }
+    snprintf(out, ukuran_out,
+             "fr %.2fms %.1fK sel %lu sys/tb %lu fx %.0fus rss %s undo %d/%luK",
+             kinerja.frame_us / 1000.0, kinerja.byte_frame / 1024.0,
+             kinerja.sel_frame, kinerja.syscall_per_tombol, kinerja.formula_us,
+             teks_rss, undo_top + redo_top,
+             (unsigned long)((undo_top + redo_top) * sizeof(struct op) / 1024));
+}
+
+static void gambar_statusbar(const struct konfigurasi *cfg)
+{
+    int cols = lebar_terminal(), rows = tinggi_terminal(), y = rows;
+    char info[128];
+    if (hud_aktif) {
+        susun_hud(info, sizeof(info));
+    } else {
+        snprintf(info, sizeof(info), "lebar: %d tinggi: %d  [?]: bantuan",
+                 lebar_kolom[cfg->aktif_x], tinggi_baris[cfg->aktif_y]);
+    }
     
-    if (!file) {
-        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %s", nama_file);
+    /* Background gelap untuk status bar */
+    tulis_teks(BG_DARK, sizeof(BG_DARK) - 1);
+    kosongkan_baris(y);
+    
+    pos(2, y);
+    tulis_teks(FG_WHITE, sizeof(FG_WHITE) - 1);
+    tulis_teks(status_msg, strlen(status_msg));
+    pos(cols - (int)strlen(info) - 1, y);
+    tulis_teks(FG_GRAY, sizeof(FG_GRAY) - 1);
+    tulis_teks(info, strlen(info));
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+}
+
+static void gambar_label_kolom(const struct konfigurasi *cfg,
+                               const struct pane *pane, int jumlah_pane)
+{
+    int c, p;
+    kosongkan_baris(2);
+    /* Label untuk pane di lajur paling atas saja */
+    for (p = 0; p < jumlah_pane && pane[p].y_awal == pane[0].y_awal; p++) {
+        int x = pane[p].x_awal + 1;
+        for (c = pane[p].col_start; c <= pane[p].col_end; c++) {
+            char ch = (char)('A' + c);
+            pos(x + lebar_kolom[c] / 2, 2);
+            tulis_teks(&ch, 1);
+            x += lebar_kolom[c] + 1;
+        }
+    }
+}
+
+static void gambar_nomor_baris(const struct konfigurasi *cfg,
+                                int y_awal, int row_start, int row_end)
+{
+    int y = y_awal, r;
+    for (r = row_start; r <= row_end; r = baris_berikut(r)) {
+        pos(1, y + 1);
+        tulis_spasi(4);
+        y += tinggi_baris[r] + 1;
+    }
+    y = y_awal;
+    for (r = row_start; r <= row_end; r = baris_berikut(r)) {
+        char num[8];
+        snprintf(num, sizeof(num), "%2d", r + 1);
+        pos(2, y + 1);
+        tulis_teks(num, strlen(num));
+        y += tinggi_baris[r] + 1;
+    }
+}
+
+/* ============================================================
+ * Fungsi Utilitas Viewport
+ * ============================================================ */
+/* Jumlah kolom dan baris beku yang muat di layar beserta lebar/tinggi
+ * pane-nya termasuk garis tepi; yang tidak muat dianggap tidak beku */
+static void hitung_beku(const struct konfigurasi *cfg,
+                        int *m, int *n, int *fw, int *fh)
+{
+    int available_w = lebar_terminal() - 5;
+    int available_h = tinggi_terminal() - 4;
+    int c, r;
+
+    *m = beku_kolom < cfg->kolom ? beku_kolom : cfg->kolom;
+    *n = beku_baris < cfg->baris ? beku_baris : cfg->baris;
+    *fw = 0;
+    *fh = 0;
+    if (*m > 0) {
+        *fw = 1;
+        for (c = 0; c < *m; c++) {
+            *fw += lebar_kolom[c] + 1;
+        }
+        /* Sisakan ruang untuk paling tidak satu kolom biasa */
+        if (*fw + 9 > available_w) {
+            *m = 0;
+            *fw = 0;
+        }
+    }
+    if (*n > 0) {
+        *fh = 1;
+        for (r = baris_terlihat_dari(0); r < *n; r = baris_berikut(r)) {
+            *fh += tinggi_baris[r] + 1;
+        }
+        if (*fh == 1 || *fh + 2 > available_h) {
+            *n = 0;
+            *fh = 0;
+        }
+    }
+}
+
+static void hitung_viewport(const struct konfigurasi *cfg,
+                            int *x_awal, int *y_awal,
+                            int *pad_left, int *vis_w, int *vis_h,
+                            int *col_start, int *col_end,
+                            int *row_start, int *row_end)
+{
+    int term_w = lebar_terminal();
+    int term_h = tinggi_terminal();
+    int grid_top = 3;
+    int status_bar_rows = 1;
+    int available_h = term_h - grid_top - status_bar_rows;
+    int padL = 5;
+    int available_w = term_w - padL;
+    int x = 0, c, start;
+    int y = 0, r, akhir;
+    int m, n, fw, fh;
+    
+    /* Validasi input */
+    if (!cfg || !x_awal || !y_awal || !pad_left || !vis_w || !vis_h ||
+        !col_start || !col_end || !row_start || !row_end) {
+        return;
+    }
+    
+    if (available_h < 1) {
+        available_h = 1;
+    }
+    
+    if (available_w < 8) {
+        available_w = 8;
+    }
+
+    /* Pane utama dimulai setelah pane beku */
+    hitung_beku(cfg, &m, &n, &fw, &fh);
+    available_w -= fw;
+    available_h -= fh;
+
+    *x_awal = padL + fw;
+    *y_awal = grid_top + fh;
+    *pad_left = padL;
+    *vis_w = available_w;
+    *vis_h = available_h;
+
+    /* kolom terlihat */
+    x = 0;
+    c = cfg->view_col > m ? cfg->view_col : m;
+    start = c;
+    while (c < cfg->kolom) {
+        int w = lebar_kolom[c] + 1;
+        if (x + w > available_w) {
+            break;
+        }
+        x += w;
+        c++;
+    }
+    if (c == start && c < cfg->kolom) {
+        c++;
+    }
+    *col_start = start;
+    *col_end = c - 1;
+    
+    /* baris terlihat (baris tersembunyi filter dilompati) */
+    y = 0;
+    r = baris_terlihat_dari(cfg->view_row > n ? cfg->view_row : n);
+    start = r;
+    akhir = start - 1;
+    while (r < cfg->baris) {
+        int h = tinggi_baris[r] + 1;
+        if (y + h > available_h) {
+            break;
+        }
+        y += h;
+        akhir = r;
+        r = baris_berikut(r);
+    }
+    if (r == start && r < cfg->baris) {
+        akhir = r;
+    }
+    *row_start = start;
+    *row_end = akhir;
+}
+
+/* Susun pane yang tampil dalam urutan gambar: pojok beku, baris beku,
+ * kolom beku, lalu pane utama (selalu terakhir). Mengembalikan jumlah
+ * pane. */
+static int hitung_pane(const struct konfigurasi *cfg, struct pane *pane)
+{
+    int x_awal, y_awal, pad_left, vis_w, vis_h;
+    int col_start, col_end, row_start, row_end;
+    int m, n, fw, fh, jumlah = 0;
+
+    hitung_viewport(cfg, &x_awal, &y_awal, &pad_left, &vis_w, &vis_h,
+                    &col_start, &col_end, &row_start, &row_end);
+    hitung_beku(cfg, &m, &n, &fw, &fh);
+
+    if (m > 0 && n > 0) {
+        pane[jumlah].x_awal = pad_left;
+        pane[jumlah].y_awal = 3;
+        pane[jumlah].col_start = 0;
+        pane[jumlah].col_end = m - 1;
+        pane[jumlah].row_start = baris_terlihat_dari(0);
+        pane[jumlah].row_end = baris_terlihat_sampai(n - 1);
+        jumlah++;
+    }
+    if (n > 0) {
+        pane[jumlah].x_awal = pad_left + fw;
+        pane[jumlah].y_awal = 3;
+        pane[jumlah].col_start = col_start;
+        pane[jumlah].col_end = col_end;
+        pane[jumlah].row_start = baris_terlihat_dari(0);
+        pane[jumlah].row_end = baris_terlihat_sampai(n - 1);
+        jumlah++;
+    }
+    if (m > 0) {
+        pane[jumlah].x_awal = pad_left;
+        pane[jumlah].y_awal = 3 + fh;
+        pane[jumlah].col_start = 0;
+        pane[jumlah].col_end = m - 1;
+        pane[jumlah].row_start = row_start;
+        pane[jumlah].row_end = row_end;
+        jumlah++;
+    }
+    pane[jumlah].x_awal = x_awal;
+    pane[jumlah].y_awal = y_awal;
+    pane[jumlah].col_start = col_start;
+    pane[jumlah].col_end = col_end;
+    pane[jumlah].row_start = row_start;
+    pane[jumlah].row_end = row_end;
+    return jumlah + 1;
+}
+
+/* ============================================================
+ * Fungsi Utilitas Seleksi
+ * ============================================================ */
+static void gambar_area_hijau_view(const struct konfigurasi *cfg,
+                                   int x_awal, int y_awal,
+                                   int col_start, int col_end,
+                                   int row_start, int row_end,
+                                   int x1, int y1, int x2, int y2)
+{
+    int minx = x1 < x2 ? x1 : x2, maxx = x1 > x2 ? x1 : x2;
+    int miny = y1 < y2 ? y1 : y2, maxy = y1 > y2 ? y1 : y2;
+    int cs = minx < col_start ? col_start : minx;
+    int ce = maxx > col_end ? col_end : maxx;
+    int rs = baris_terlihat_dari(miny < row_start ? row_start : miny);
+    int re = baris_terlihat_sampai(maxy > row_end ? row_end : maxy);
+    int r, c, k, line, y_top, r0;
+    
+    if (cs > ce || rs > re) {
+        return;
+    }
+
+    tulis_teks(FG_GREEN, sizeof(FG_GREEN) - 1);
+    y_top = y_awal;
+    for (r0 = row_start; r0 < rs; r0 = baris_berikut(r0)) {
+        y_top += tinggi_baris[r0] + 1;
+    }
+
+    /* top border */
+    {
+        int c0;
+        int x = x_awal;
+        for (c0 = col_start; c0 < cs; c0++) {
+            x += lebar_kolom[c0] + 1;
+        }
+        pos(x, y_top);
+        for (c = cs; c <= ce; c++) {
+            if (c == cs) {
+                tulis_teks(TL, 3);
+            }
+            for (k = 0; k < lebar_kolom[c]; k++) {
+                tulis_teks(H, 3);
+            }
+            if (c < ce) {
+                tulis_teks(TC, 3);
+            } else {
+                tulis_teks(TR, 3);
+            }
+        }
+    }
+
+    /* body + interior sides */
+    {
+        int y = y_top;
+        for (r = rs; r <= re; r = baris_berikut(r)) {
+            int h = tinggi_baris[r];
+            int x_start = x_awal, c0;
+            for (c0 = col_start; c0 < cs; c0++) {
+                x_start += lebar_kolom[c0] + 1;
+            }
+            for (line = 0; line < h; line++) {
+                pos(x_start, y + 1 + line);
+                for (c = cs; c <= ce; c++) {
+                    tulis_teks(V, 3);
+                    tulis_spasi(lebar_kolom[c]);
+                }
+                tulis_teks(V, 3);
+            }
+            pos(x_start, y + h + 1);
+            for (c = cs; c <= ce; c++) {
+                if (r < re) {
+                    if (c == cs) {
+                        tulis_teks(LC, 3);
+                    }
+                    for (k = 0; k < lebar_kolom[c]; k++) {
+                        tulis_teks(H, 3);
+                    }
+                    if (c < ce) {
+                        tulis_teks(CR, 3);
+                    } else {
+                        tulis_teks(RC, 3);
+                    }
+                } else {
+                    if (c == cs) {
+                        tulis_teks(BL, 3);
+                    }
+                    for (k = 0; k < lebar_kolom[c]; k++) {
+                        tulis_teks(H, 3);
+                    }
+                    if (c < ce) {
+                        tulis_teks(BC, 3);
+                    } else {
+                        tulis_teks(BR, 3);
+                    }
+                }
+            }
+            y += h + 1;
+        }
+    }
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+
+    for (r = rs; r <= re; r = baris_berikut(r)) {
+        for (c = cs; c <= ce; c++) {
+            if (isi[r][c][0] != '\0') {
+                gambar_isi_sel_view(cfg, x_awal, y_awal, col_start, row_start, c, r);
+            }
+        }
+    }
+}
+
+static void gambar_seleksi_cyan_view(const struct konfigurasi *cfg,
+                                     int x_awal, int y_awal,
+                                     int col_start, int col_end,
+                                     int row_start, int row_end,
+                                     int ax, int ay, int bx, int by)
+{
+    int minx = ax < bx ? ax : bx, maxx = ax > bx ? ax : bx;
+    int miny = ay < by ? ay : by, maxy = ay > by ? ay : by;
+    int vx1 = minx < col_start ? col_start : minx;
+    int vx2 = maxx > col_end ? col_end : maxx;
+    int vy1 = baris_terlihat_dari(miny < row_start ? row_start : miny);
+    int vy2 = baris_terlihat_sampai(maxy > row_end ? row_end : maxy);
+    int i, x0 = x_awal + 1, y0 = y_awal, total_w = 0, total_h = 0;
+    
+    if (vx1 > vx2 || vy1 > vy2) {
+        return;
+    }
+
+    for (i = col_start; i < vx1; i++) {
+        x0 += lebar_kolom[i] + 1;
+    }
+    for (i = row_start; i < vy1; i = baris_berikut(i)) {
+        y0 += tinggi_baris[i] + 1;
+    }
+    for (i = vx1; i <= vx2; i++) {
+        total_w += lebar_kolom[i] + 1;
+    }
+    for (i = vy1; i <= vy2; i = baris_berikut(i)) {
+        total_h += tinggi_baris[i] + 1;
+    }
+
+    tulis_teks(FG_CYAN, sizeof(FG_CYAN) - 1);
+    pos(x0 - 1, y0);
+    tulis_teks(TL, 3);
+    for (i = 0; i < total_w - 1; i++) {
+        tulis_teks(H, 3);
+    }
+    tulis_teks(TR, 3);
+    pos(x0 - 1, y0 + total_h);
+    tulis_teks(BL, 3);
+    for (i = 0; i < total_w - 1; i++) {
+        tulis_teks(H, 3);
+    }
+    tulis_teks(BR, 3);
+    for (i = 1; i < total_h; i++) {
+        pos(x0 - 1, y0 + i);
+        tulis_teks(V, 3);
+        pos(x0 + total_w - 1, y0 + i);
+        tulis_teks(V, 3);
+    }
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+}
+
+/* ============================================================
+ * Fungsi Utilitas Sel Aktif
+ * ============================================================ */
+static void gambar_sel_aktif_view(const struct konfigurasi *cfg,
+                                  int x_awal, int y_awal,
+                                  int col_start, int col_end,
+                                  int row_start, int row_end)
+{
+    int ax = cfg->aktif_x, ay = cfg->aktif_y;
+    int w, h, x0, y0, k, line;
+    
+    if (ax < col_start || ax > col_end || ay < row_start || ay > row_end) {
+        return;
+    }
+
+    /* Sel normal */
+    x0 = x_awal + 1;
+    y0 = y_awal;
+    for (k = col_start; k < ax; k++) {
+        x0 += lebar_kolom[k] + 1;
+    }
+    for (k = row_start; k < ay; k = baris_berikut(k)) {
+        y0 += tinggi_baris[k] + 1;
+    }
+    w = lebar_kolom[ax];
+    h = tinggi_baris[ay];
+
+    tulis_teks(FG_WHITE, sizeof(FG_WHITE) - 1);
+    pos(x0 - 1, y0);
+    tulis_teks(TL, 3);
+    for (k = 0; k < w; k++) {
+        tulis_teks(H, 3);
+    }
+    tulis_teks(TR, 3);
+    for (line = 0; line < h; line++) {
+        pos(x0 - 1, y0 + 1 + line);
+        tulis_teks(V, 3);
+        pos(x0 + w, y0 + 1 + line);
+        tulis_teks(V, 3);
+    }
+    pos(x0 - 1, y0 + h + 1);
+    tulis_teks(BL, 3);
+    for (k = 0; k < w; k++) {
+        tulis_teks(H, 3);
+    }
+    tulis_teks(BR, 3);
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+    sel_tergambar_x = ax;
+    sel_tergambar_y = ay;
+}
+
+/* ============================================================
+ * Fungsi Render
+ * ============================================================ */
+static void gambar_semua_isi_view(const struct konfigurasi *cfg,
+                                  int x_awal, int y_awal,
+                                  int col_start, int col_end,
+                                  int row_start, int row_end)
+{
+    int r, c;
+    for (r = row_start; r <= row_end; r = baris_berikut(r)) {
+        for (c = col_start; c <= col_end; c++) {
+            if (isi[r][c][0] != '\0') {
+                gambar_isi_sel_view(cfg, x_awal, y_awal, col_start, row_start, c, r);
+            }
+        }
+    }
+}
+
+static void catat_tampilan(const struct pane *utama)
+{
+    tampil_valid = 1;
+    tampil_x_awal = utama->x_awal;
+    tampil_y_awal = utama->y_awal;
+    tampil_baris_awal = utama->row_start;
+    tampil_baris_akhir = utama->row_end;
+    tampil_kolom_awal = utama->col_start;
+    tampil_kolom_akhir = utama->col_end;
+    tampil_versi = versi_lebar;
+    tampil_lebar = lebar_terminal();
+    tampil_tinggi = tinggi_terminal();
+}
+
+static void catat_seleksi_tergambar(const struct konfigurasi *cfg)
+{
+    seleksi_tergambar = 1;
+    seleksi_tergambar_ax = sel_anchor_x;
+    seleksi_tergambar_ay = sel_anchor_y;
+    seleksi_tergambar_bx = cfg->aktif_x;
+    seleksi_tergambar_by = cfg->aktif_y;
+}
+
+/* Area clipboard, seleksi dan highlight sel aktif di semua pane */
+static void gambar_sorotan(const struct konfigurasi *cfg,
+                           const struct pane *pane, int jumlah_pane)
+{
+    int p;
+
+    if (clip_has_area) {
+        for (p = 0; p < jumlah_pane; p++) {
+            const struct pane *q = &pane[p];
+            gambar_area_hijau_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                                   q->row_start, q->row_end,
+                                   clip_x1, clip_y1, clip_x2, clip_y2);
+        }
+    }
+    if (selecting) {
+        for (p = 0; p < jumlah_pane; p++) {
+            const struct pane *q = &pane[p];
+            gambar_seleksi_cyan_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                                     q->row_start, q->row_end, sel_anchor_x, sel_anchor_y,
+                                     cfg->aktif_x, cfg->aktif_y);
+        }
+        catat_seleksi_tergambar(cfg);
+    }
+    for (p = 0; p < jumlah_pane; p++) {
+        const struct pane *q = &pane[p];
+        gambar_sel_aktif_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                              q->row_start, q->row_end);
+    }
+}
+
+static void render(const struct konfigurasi *cfg)
+{
+    struct pane pane[4];
+    int jumlah_pane, p;
+    
+    if (makro_diputar()) {
+        frame_tertunda = FRAME_PENUH;
+        tampil_valid = 0;
+        return;
+    }
+    jejak_mulai("render");
+    mulai_ukur_frame();
+    frame_tertunda = FRAME_TIDAK;
+    sel_tergambar_x = sel_tergambar_y = -1;
+    seleksi_tergambar = 0;
+    siapkan_back_buffer();
+    bersih();
+    gambar_topbar(cfg);
+    jumlah_pane = hitung_pane(cfg, pane);
+    catat_tampilan(&pane[jumlah_pane - 1]);
+    gambar_label_kolom(cfg, pane, jumlah_pane);
+    for (p = 0; p < jumlah_pane; p++) {
+        const struct pane *q = &pane[p];
+        gambar_grid_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                         q->row_start, q->row_end);
+        if (q->x_awal == pane[0].x_awal) {
+            gambar_nomor_baris(cfg, q->y_awal, q->row_start, q->row_end);
+        }
+        gambar_semua_isi_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                              q->row_start, q->row_end);
+    }
+    gambar_sorotan(cfg, pane, jumlah_pane);
+    gambar_statusbar(cfg);
+    pos(1, 1);
+    tulis_teks("\033[?25l", 6);
+    flush();
+    jejak_selesai();
+}
+
+/* Redraw parsial untuk navigasi */
+/* ============================================================
+ * Fungsi Redraw Parsial yang Dioptimalkan (Versi Sempurna)
+ * ============================================================ */
+/* Kembalikan garis grid normal dan isi sel (x, y) jika sel itu ada di
+ * pane q */
+static void hapus_sorotan_sel(const struct konfigurasi *cfg,
+                              const struct pane *q, int x, int y)
+{
+    int w, h, x0, y0, k, line;
+
+    if (x < q->col_start || x > q->col_end ||
+        y < q->row_start || y > q->row_end || !baris_terlihat(y)) {
+        return;
+    }
+    x0 = q->x_awal + 1;
+    y0 = q->y_awal;
+    for (k = q->col_start; k < x; k++) {
+        x0 += lebar_kolom[k] + 1;
+    }
+    for (k = q->row_start; k < y; k = baris_berikut(k)) {
+        y0 += tinggi_baris[k] + 1;
+    }
+    w = lebar_kolom[x];
+    h = tinggi_baris[y];
+    
+    /* Gambar ulang grid di sekitar sel dengan benar */
+    /* Atas */
+    pos(x0 - 1, y0);
+    tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
+    
+    /* Tentukan karakter kiri atas */
+    if (y == q->row_start) {
+        if (x == q->col_start) {
+            tulis_teks(TL, 3);  /* Sudut kiri atas viewport */
+        } else {
+            tulis_teks(TC, 3);  /* Tengah atas */
+        }
+    } else {
+        if (x == q->col_start) {
+            tulis_teks(LC, 3);  /* Tengah kiri */
+        } else {
+            tulis_teks(CR, 3);  /* Persimpangan */
+        }
+    }
+    
+    /* Garis horizontal atas */
+    for (k = 0; k < w; k++) {
+        tulis_teks(H, 3);
+    }
+    
+    /* Tentukan karakter kanan atas */
+    if (y == q->row_start) {
+        if (x == q->col_end) {
+            tulis_teks(TR, 3);  /* Sudut kanan atas viewport */
+        } else {
+            tulis_teks(TC, 3);  /* Tengah atas */
+        }
+    } else {
+        if (x == q->col_end) {
+            tulis_teks(RC, 3);  /* Tengah kanan */
+        } else {
+            tulis_teks(CR, 3);  /* Persimpangan */
+        }
+    }
+    
+    /* Samping kiri dan kanan */
+    for (line = 0; line < h; line++) {
+        pos(x0 - 1, y0 + 1 + line);
+        tulis_teks(V, 3);
+        pos(x0 + w, y0 + 1 + line);
+        tulis_teks(V, 3);
+    }
+    
+    /* Bawah */
+    pos(x0 - 1, y0 + h + 1);
+    
+    /* Tentukan karakter kiri bawah */
+    if (y == q->row_end) {
+        if (x == q->col_start) {
+            tulis_teks(BL, 3);  /* Sudut kiri bawah viewport */
+        } else {
+            tulis_teks(BC, 3);  /* Tengah bawah */
+        }
+    } else {
+        if (x == q->col_start) {
+            tulis_teks(LC, 3);  /* Tengah kiri */
+        } else {
+            tulis_teks(CR, 3);  /* Persimpangan */
+        }
+    }
+    
+    /* Garis horizontal bawah */
+    for (k = 0; k < w; k++) {
+        tulis_teks(H, 3);
+    }
+    
+    /* Tentukan karakter kanan bawah */
+    if (y == q->row_end) {
+        if (x == q->col_end) {
+            tulis_teks(BR, 3);  /* Sudut kanan bawah viewport */
+        } else {
+            tulis_teks(BC, 3);  /* Tengah bawah */
+        }
+    } else {
+        if (x == q->col_end) {
+            tulis_teks(RC, 3);  /* Tengah kanan */
+        } else {
+            tulis_teks(CR, 3);  /* Persimpangan */
+        }
+    }
+    
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+    
+    /* Gambar kembali isi sel */
+    if (isi[y][x][0] != '\0') {
+        gambar_isi_sel_view(cfg, q->x_awal, q->y_awal, q->col_start, q->row_start, x, y);
+    }
+}
+
+static void redraw_navigasi_parsial(const struct konfigurasi *cfg)
+{
+    struct pane pane[4];
+    int jumlah_pane, p;
+    int prev_x = sel_tergambar_x, prev_y = sel_tergambar_y;
+    
+    mulai_ukur_frame();
+    /* Hitung pane saat ini */
+    jumlah_pane = hitung_pane(cfg, pane);
+    
+    /* Hapus highlight sel yang terakhir digambar */
+    for (p = 0; p < jumlah_pane; p++) {
+        hapus_sorotan_sel(cfg, &pane[p], prev_x, prev_y);
+    }
+    
+    /* Gambar area hijau dan highlight sel aktif */
+    gambar_sorotan(cfg, pane, jumlah_pane);
+    
+    /* Update topbar dan statusbar */
+    gambar_topbar(cfg);
+    gambar_statusbar(cfg);
+    
+    pos(1, 1);
+    tulis_teks("\033[?25l", 6);
+    flush();
+}
+
+/* Potong persegi seleksi (ax, ay)-(bx, by) ke pane q, sama seperti
+ * gambar_seleksi_cyan_view */
+static void potong_seleksi(const struct pane *q, int ax, int ay, int bx, int by,
+                           struct persegi_sel *p)
+{
+    int minx = ax < bx ? ax : bx, maxx = ax > bx ? ax : bx;
+    int miny = ay < by ? ay : by, maxy = ay > by ? ay : by;
+
+    p->x1 = minx < q->col_start ? q->col_start : minx;
+    p->x2 = maxx > q->col_end ? q->col_end : maxx;
+    p->y1 = baris_terlihat_dari(miny < q->row_start ? q->row_start : miny);
+    p->y2 = baris_terlihat_sampai(maxy > q->row_end ? q->row_end : maxy);
+}
+
+static int sisi_seleksi(const struct persegi_sel *p, int x, int y)
+{
+    int sisi = 0;
+
+    if (x < p->x1 || x > p->x2 || y < p->y1 || y > p->y2 || !baris_terlihat(y)) {
+        return 0;
+    }
+    if (y == p->y1) {
+        sisi |= SISI_ATAS;
+    }
+    if (y == p->y2) {
+        sisi |= SISI_BAWAH;
+    }
+    if (x == p->x1) {
+        sisi |= SISI_KIRI;
+    }
+    if (x == p->x2) {
+        sisi |= SISI_KANAN;
+    }
+    return sisi;
+}
+
+/* Kolom berikutnya pada tepi persegi: baris atas/bawah dilalui penuh,
+ * baris tengah hanya kolom x1 dan x2 */
+static int kolom_tepi_berikut(const struct persegi_sel *p, int x, int y)
+{
+    if (y == p->y1 || y == p->y2 || x == p->x2) {
+        return x + 1;
+    }
+    return p->x2;
+}
+
+/* Apakah sel (x, y) dikembalikan ke grid normal oleh diff seleksi */
+static int sel_dihapus(const struct persegi_sel *lama, const struct persegi_sel *baru,
+                       int x, int y)
+{
+    int s = sisi_seleksi(lama, x, y);
+    if (x == sel_tergambar_x && y == sel_tergambar_y) {
+        return 1;
+    }
+    return s != 0 && s != sisi_seleksi(baru, x, y);
+}
+
+/* Gambar sisi outline seleksi milik sel (x, y) di pane q, termasuk
+ * persimpangan di ujung-ujungnya */
+static void gambar_sisi_seleksi(const struct pane *q, const struct persegi_sel *p,
+                                int x, int y, int sisi)
+{
+    int w = lebar_kolom[x], h = tinggi_baris[y];
+    int x0 = q->x_awal + 1, y0 = q->y_awal, k, line;
+
+    for (k = q->col_start; k < x; k++) {
+        x0 += lebar_kolom[k] + 1;
+    }
+    for (k = q->row_start; k < y; k = baris_berikut(k)) {
+        y0 += tinggi_baris[k] + 1;
+    }
+    if (sisi & SISI_ATAS) {
+        pos(x0 - 1, y0);
+        tulis_teks(x == p->x1 ? TL : H, 3);
+        for (k = 0; k < w; k++) {
+            tulis_teks(H, 3);
+        }
+        tulis_teks(x == p->x2 ? TR : H, 3);
+    }
+    if (sisi & SISI_BAWAH) {
+        pos(x0 - 1, y0 + h + 1);
+        tulis_teks(x == p->x1 ? BL : H, 3);
+        for (k = 0; k < w; k++) {
+            tulis_teks(H, 3);
+        }
+        tulis_teks(x == p->x2 ? BR : H, 3);
+    }
+    /* Sisi tegak menutup persimpangan atas/bawah yang bukan sudut */
+    for (line = y == p->y1 ? 1 : 0; line <= h + (y == p->y2 ? 0 : 1); line++) {
+        if (sisi & SISI_KIRI) {
+            pos(x0 - 1, y0 + line);
+            tulis_teks(V, 3);
+        }
+        if (sisi & SISI_KANAN) {
+            pos(x0 + w, y0 + line);
+            tulis_teks(V, 3);
+        }
+    }
+}
+
+/* Redraw parsial untuk seleksi: hanya sel yang sisi outline-nya berubah
+ * (selisih persegi lama dan baru) yang dikembalikan ke grid normal, lalu
+ * outline digambar ulang di sel berubah dan tetangganya */
+static void redraw_seleksi_parsial(const struct konfigurasi *cfg)
+{
+    struct pane pane[4];
+    int jumlah_pane, p, penuh;
+    
+    mulai_ukur_frame();
+    /* Hitung pane saat ini */
+    jumlah_pane = hitung_pane(cfg, pane);
+
+    /* Area hijau bisa menimpa outline; gambar ulang seluruhnya */
+    penuh = !seleksi_tergambar || clip_has_area ||
+            seleksi_tergambar_ax != sel_anchor_x || seleksi_tergambar_ay != sel_anchor_y;
+    
+    for (p = 0; p < jumlah_pane; p++) {
+        const struct pane *q = &pane[p];
+        struct persegi_sel lama, baru;
+        int x, y;
+
+        if (seleksi_tergambar) {
+            potong_seleksi(q, seleksi_tergambar_ax, seleksi_tergambar_ay,
+                           seleksi_tergambar_bx, seleksi_tergambar_by, &lama);
+        } else {
+            lama.x1 = lama.y1 = 0;
+            lama.x2 = lama.y2 = -1;
+        }
+        potong_seleksi(q, sel_anchor_x, sel_anchor_y, cfg->aktif_x, cfg->aktif_y, &baru);
+        if (penuh) {
+            /* Persegi baru kosong: semua tepi lama dihapus */
+            baru.x1 = baru.y1 = 0;
+            baru.x2 = baru.y2 = -1;
+        }
+
+        /* Outline lama hanya ada di tepi persegi lama */
+        for (y = lama.y1; y <= lama.y2; y = baris_berikut(y)) {
+            for (x = lama.x1; x <= lama.x2; x = kolom_tepi_berikut(&lama, x, y)) {
+                if (sel_dihapus(&lama, &baru, x, y) &&
+                    !(x == sel_tergambar_x && y == sel_tergambar_y)) {
+                    hapus_sorotan_sel(cfg, q, x, y);
+                }
+            }
+        }
+        hapus_sorotan_sel(cfg, q, sel_tergambar_x, sel_tergambar_y);
+
+        if (penuh) {
+            continue;
+        }
+        /* Sisi baru di sel yang berubah atau bertetangga dengan sel yang
+         * dihapus (persimpangan sudutnya ikut tertimpa) */
+        for (y = baru.y1; y <= baru.y2; y = baris_berikut(y)) {
+            for (x = baru.x1; x <= baru.x2; x = kolom_tepi_berikut(&baru, x, y)) {
+                int sisi = sisi_seleksi(&baru, x, y), perlu, dy, dx;
+                perlu = sisi != sisi_seleksi(&lama, x, y);
+                for (dy = -1; dy <= 1 && !perlu; dy++) {
+                    int ny = dy < 0 ? baris_sebelum(y) : dy > 0 ? baris_berikut(y) : y;
+                    for (dx = -1; dx <= 1 && !perlu; dx++) {
+                        perlu = sel_dihapus(&lama, &baru, x + dx, ny);
+                    }
+                }
+                if (perlu) {
+                    tulis_teks(FG_CYAN, sizeof(FG_CYAN) - 1);
+                    gambar_sisi_seleksi(q, &baru, x, y, sisi);
+                }
+            }
+        }
+        tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+    }
+    
+    /* Simpan posisi seleksi saat ini */
+    prev_sel_x = cfg->aktif_x;
+    prev_sel_y = cfg->aktif_y;
+    
+    if (penuh) {
+        /* Gambar area hijau, seleksi baru dan highlight sel aktif */
+        gambar_sorotan(cfg, pane, jumlah_pane);
+    } else {
+        catat_seleksi_tergambar(cfg);
+        for (p = 0; p < jumlah_pane; p++) {
+            const struct pane *q = &pane[p];
+            gambar_sel_aktif_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                                  q->row_start, q->row_end);
+        }
+    }
+    
+    /* Update topbar dan statusbar */
+    gambar_topbar(cfg);
+    gambar_statusbar(cfg);
+    
+    pos(1, 1);
+    tulis_teks("\033[?25l", 6);
+    flush();
+}
+
+/* Gambar satu baris grid di pane q (body, garis bawah dan isi sel) yang
+ * garis atasnya berada di baris layar y; nomor != 0 juga menulis nomor
+ * baris di gutter */
+static void gambar_baris_view(const struct konfigurasi *cfg,
+                              const struct pane *q, const struct templat_grid *t,
+                              int r, int y, const struct buffer *garis, int nomor)
+{
+    int h = tinggi_baris[r], line, c;
+
+    tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
+    for (line = 0; line < h; line++) {
+        pos(q->x_awal, y + 1 + line);
+        tulis_templat(t, &t->isi);
+    }
+    pos(q->x_awal, y + h + 1);
+    tulis_templat(t, garis);
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+
+    if (nomor) {
+        char num[8];
+        snprintf(num, sizeof(num), "%2d", r + 1);
+        pos(1, y + 1);
+        tulis_teks("    ", 4);
+        pos(2, y + 1);
+        tulis_teks(num, strlen(num));
+    }
+
+    for (c = q->col_start; c <= q->col_end; c++) {
+        if (isi[r][c][0] != '\0') {
+            gambar_isi_sel_view(cfg, q->x_awal, q->y_awal, q->col_start, q->row_start, c, r);
+        }
+    }
+}
+
+/* Redraw setelah viewport bergeser. Geser vertikal: body grid digeser
+ * dengan scroll region terminal (DECSTBM + SU/SD) sehingga hanya baris
+ * yang baru terlihat yang digambar. Geser horizontal: hanya area kanan
+ * pane kolom beku yang digambar ulang. Baris dan kolom beku tidak pernah
+ * dikirim ulang; selain dua kasus itu jatuh ke render penuh. */
+static void redraw_gulir_parsial(const struct konfigurasi *cfg)
+{
+    struct pane pane[4];
+    const struct pane *u;
+    int jumlah_pane, lajur, p;
+    int term_h = tinggi_terminal();
+    int atas, bawah, geser = 0, turun, r, y;
+    char esc[48];
+    int n;
+
+    mulai_ukur_frame();
+    jumlah_pane = hitung_pane(cfg, pane);
+    u = &pane[jumlah_pane - 1];
+
+    /* Pane yang sebaris dengan pane utama (kolom beku + utama) */
+    for (lajur = 0; pane[lajur].y_awal != u->y_awal; lajur++) {
+    }
+
+    if (!tampil_valid || selecting ||
+        tampil_x_awal != u->x_awal || tampil_y_awal != u->y_awal ||
+        tampil_versi != versi_lebar || tampil_tinggi != term_h ||
+        tampil_lebar != lebar_terminal()) {
+        render(cfg);
+        return;
+    }
+
+    if (u->row_start == tampil_baris_awal && u->row_end == tampil_baris_akhir) {
+        if (u->col_start == tampil_kolom_awal && u->col_end == tampil_kolom_akhir) {
+            redraw_navigasi_parsial(cfg);
+            return;
+        }
+        /* Geser kolom: bersihkan kanan kolom beku, gambar ulang pane kanan */
+        for (y = 2; y < term_h; y++) {
+            pos(u->x_awal, y);
+            tulis_teks("\033[K", 3);
+        }
+        gambar_label_kolom(cfg, pane, jumlah_pane);
+        for (p = 0; p < jumlah_pane; p++) {
+            const struct pane *q = &pane[p];
+            if (q->x_awal != u->x_awal) {
+                continue;
+            }
+            gambar_grid_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                             q->row_start, q->row_end);
+            gambar_semua_isi_view(cfg, q->x_awal, q->y_awal, q->col_start, q->col_end,
+                                  q->row_start, q->row_end);
+        }
+        tampil_kolom_awal = u->col_start;
+        tampil_kolom_akhir = u->col_end;
+        redraw_navigasi_parsial(cfg);
+        return;
+    }
+
+    /* Body grid: dari baris setelah garis atas sampai sebelum status bar */
+    atas = u->y_awal + 1;
+    bawah = term_h - 1;
+    turun = u->row_start > tampil_baris_awal;
+    if (turun) {
+        for (r = tampil_baris_awal; r < u->row_start; r = baris_berikut(r)) {
+            geser += tinggi_baris[r] + 1;
+        }
+    } else {
+        for (r = u->row_start; r < tampil_baris_awal; r = baris_berikut(r)) {
+            geser += tinggi_baris[r] + 1;
+        }
+    }
+
+    if (u->col_start != tampil_kolom_awal || u->col_end != tampil_kolom_akhir ||
+        (turun && u->row_end < tampil_baris_akhir) ||
+        (turun && u->row_start > tampil_baris_akhir) ||
+        (!turun && u->row_end < tampil_baris_awal) ||
+        geser <= 0 || geser > bawah - atas) {
+        render(cfg);
+        return;
+    }
+    for (p = lajur; p < jumlah_pane; p++) {
+        if (!siapkan_templat_grid(pane[p].col_start, pane[p].col_end)) {
+            render(cfg);
+            return;
+        }
+    }
+
+    n = snprintf(esc, sizeof(esc), ESC_NORM "\033[%d;%dr\033[%d%c\033[r",
+                 atas, bawah, geser, turun ? 'S' : 'T');
+    tulis_teks(esc, (size_t)n);
+
+    /* Garis atas pane bisa membawa sisa highlight baris lama */
+    tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
+    for (p = lajur; p < jumlah_pane; p++) {
+        const struct templat_grid *t = siapkan_templat_grid(pane[p].col_start,
+                                                            pane[p].col_end);
+        pos(pane[p].x_awal, u->y_awal);
+        tulis_templat(t, &t->atas);
+    }
+    tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+
+    if (turun) {
+        /* Garis bawah lama kini jadi pemisah, lalu baris baru di bawahnya */
+        y = u->y_awal;
+        for (r = u->row_start; r <= tampil_baris_akhir; r = baris_berikut(r)) {
+            y += tinggi_baris[r] + 1;
+        }
+        tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
+        for (p = lajur; p < jumlah_pane; p++) {
+            const struct templat_grid *t = siapkan_templat_grid(pane[p].col_start,
+                                                                pane[p].col_end);
+            const struct buffer *garis = tampil_baris_akhir < u->row_end ?
+                                         &t->pemisah : &t->bawah;
+            pos(pane[p].x_awal, y);
+            tulis_templat(t, garis);
+        }
+        tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+        for (r = baris_berikut(tampil_baris_akhir); r <= u->row_end;
+             r = baris_berikut(r)) {
+            for (p = lajur; p < jumlah_pane; p++) {
+                const struct templat_grid *t = siapkan_templat_grid(pane[p].col_start,
+                                                                    pane[p].col_end);
+                gambar_baris_view(cfg, &pane[p], t, r, y,
+                                  r < u->row_end ? &t->pemisah : &t->bawah, p == lajur);
+            }
+            y += tinggi_baris[r] + 1;
+        }
+    } else {
+        /* Baris baru mengisi celah di atas; baris yang terdorong melewati
+         * viewport dihapus dari bawah garis penutup */
+        y = u->y_awal;
+        for (r = u->row_start; r < tampil_baris_awal; r = baris_berikut(r)) {
+            for (p = lajur; p < jumlah_pane; p++) {
+                const struct templat_grid *t = siapkan_templat_grid(pane[p].col_start,
+                                                                    pane[p].col_end);
+                gambar_baris_view(cfg, &pane[p], t, r, y, &t->pemisah, p == lajur);
+            }
+            y += tinggi_baris[r] + 1;
+        }
+        for (; r <= u->row_end; r = baris_berikut(r)) {
+            y += tinggi_baris[r] + 1;
+        }
+        tulis_teks(FG_DARK, sizeof(FG_DARK) - 1);
+        for (p = lajur; p < jumlah_pane; p++) {
+            const struct templat_grid *t = siapkan_templat_grid(pane[p].col_start,
+                                                                pane[p].col_end);
+            pos(pane[p].x_awal, y);
+            tulis_templat(t, &t->bawah);
+        }
+        tulis_teks(ESC_NORM, sizeof(ESC_NORM) - 1);
+        pos(1, y + 1);
+        tulis_teks("\033[J", 3);
+    }
+
+    tampil_baris_awal = u->row_start;
+    tampil_baris_akhir = u->row_end;
+
+    /* Highlight, area hijau, topbar dan statusbar seperti navigasi biasa */
+    redraw_navigasi_parsial(cfg);
+}
+
+/* ============================================================
+ * Fungsi Intern Teks
+ * ============================================================ */
+#define HASH_KOSONG 2166136261u
+#define ENTRI_INTERN(p) \
+    ((struct teks_intern *)((char *)(p) - offsetof(struct teks_intern, teks)))
+
+/* FNV-1a 32-bit atas len byte pertama */
+static unsigned int hash_potongan(const char *teks, size_t len)
+{
+    unsigned int h = HASH_KOSONG;
+    while (len-- > 0) {
+        h ^= (unsigned char)*teks++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned int hash_teks(const char *teks)
+{
+    return hash_potongan(teks, strlen(teks));
+}
+
+/* Hash isi sel dari pool, tanpa menghitung ulang */
+static unsigned int hash_sel(const char *sel)
+{
+    return sel[0] ? ENTRI_INTERN(sel)->hash : HASH_KOSONG;
+}
+
+static int perbesar_tabel_intern(void)
+{
+    unsigned int slot = tabel_intern ? (mask_intern + 1) * 2 : 1024;
+    struct teks_intern **baru = calloc(slot, sizeof(*baru));
+    struct teks_intern *e, *lanjut;
+    unsigned int i;
+
+    if (!baru) {
+        return -1;
+    }
+    for (i = 0; tabel_intern && i <= mask_intern; i++) {
+        for (e = tabel_intern[i]; e; e = lanjut) {
+            lanjut = e->berikut;
+            e->berikut = baru[e->hash & (slot - 1)];
+            baru[e->hash & (slot - 1)] = e;
+        }
+    }
+    free(tabel_intern);
+    tabel_intern = baru;
+    mask_intern = slot - 1;
+    return 0;
+}
+
+/* Teks di pool yang sama dengan teks, tanpa menambah referensi; NULL
+ * jika tidak ada sel yang memuatnya */
+static const char *cari_intern(const char *teks)
+{
+    struct teks_intern *e;
+    unsigned int h;
+
+    if (teks[0] == '\0') {
+        return teks_kosong;
+    }
+    if (!tabel_intern) {
+        return NULL;
+    }
+    h = hash_teks(teks);
+    for (e = tabel_intern[h & mask_intern]; e; e = e->berikut) {
+        if (e->hash == h && strcmp(e->teks, teks) == 0) {
+            return e->teks;
+        }
+    }
+    return NULL;
+}
+
+/* Ambil satu referensi ke teks (dipotong MAX_TEXT - 1 byte) di pool;
+ * NULL jika memori habis */
+static const char *intern(const char *teks)
+{
+    struct teks_intern *e;
+    size_t len = strlen(teks);
+    unsigned int h;
+
+    if (len == 0) {
+        return teks_kosong;
+    }
+    if (len > MAX_TEXT - 1) {
+        len = MAX_TEXT - 1;
+    }
+    h = hash_potongan(teks, len);
+    if (tabel_intern) {
+        for (e = tabel_intern[h & mask_intern]; e; e = e->berikut) {
+            if (e->hash == h && strncmp(e->teks, teks, len) == 0 && e->teks[len] == '\0') {
+                e->ref++;
+                return e->teks;
+            }
+        }
+    }
+    if ((!tabel_intern || jumlah_intern > mask_intern) &&
+        perbesar_tabel_intern() != 0 && !tabel_intern) {
+        return NULL;
+    }
+    e = malloc(sizeof(*e) + len);
+    if (!e) {
+        return NULL;
+    }
+    memcpy(e->teks, teks, len);
+    e->teks[len] = '\0';
+    e->hash = h;
+    e->ref = 1;
+    e->berikut = tabel_intern[h & mask_intern];
+    tabel_intern[h & mask_intern] = e;
+    jumlah_intern++;
+    return e->teks;
+}
+
+/* Lepas satu referensi; teks dibuang dari pool saat tidak dipakai lagi */
+static void lepas_intern(const char *teks)
+{
+    struct teks_intern *e, **pp;
+
+    if (teks[0] == '\0') {
+        return;
+    }
+    e = ENTRI_INTERN(teks);
+    if (--e->ref > 0) {
+        return;
+    }
+    for (pp = &tabel_intern[e->hash & mask_intern]; *pp != e; pp = &(*pp)->berikut) {
+    }
+    *pp = e->berikut;
+    free(e);
+    jumlah_intern--;
+}
+
+/* ============================================================
+ * Fungsi Indeks Lookup
+ * ============================================================ */
+
+static void invalidasi_indeks_kolom(int x)
+{
+    if (x >= 0 && x < MAKS_KOLOM) {
+        indeks_lookup[x].valid = 0;
+    }
+}
+
+static void invalidasi_semua_indeks(void)
+{
+    int x;
+    for (x = 0; x < MAKS_KOLOM; x++) {
+        indeks_lookup[x].valid = 0;
+    }
+}
+
+/* Bangun (atau pakai ulang) indeks hash kolom x untuk baris 0..jumlah-1 */
+static struct indeks_kolom *ambil_indeks_kolom(int x, int jumlah)
+{
+    struct indeks_kolom *idx = &indeks_lookup[x];
+    unsigned int slot = 16;
+    int y;
+
+    if (idx->valid && idx->jumlah_baris == jumlah) {
+        return idx;
+    }
+
+    while (slot < (unsigned int)jumlah * 2) {
+        slot <<= 1;
+    }
+    if (idx->mask + 1 != slot || idx->jumlah_baris < jumlah || !idx->kepala) {
+        free(idx->kepala);
+        free(idx->berikut);
+        free(idx->hash);
+        idx->kepala = malloc(slot * sizeof(int));
+        idx->berikut = malloc((size_t)jumlah * sizeof(int));
+        idx->hash = malloc((size_t)jumlah * sizeof(unsigned int));
+        if (!idx->kepala || !idx->berikut || !idx->hash) {
+            free(idx->kepala);
+            free(idx->berikut);
+            free(idx->hash);
+            idx->kepala = NULL;
+            idx->berikut = NULL;
+            idx->hash = NULL;
+            idx->valid = 0;
+            return NULL;
+        }
+        idx->mask = slot - 1;
+    }
+    for (y = 0; y <= (int)idx->mask; y++) {
+        idx->kepala[y] = -1;
+    }
+
+    /* Isi dari bawah agar rantai tiap bucket terurut naik */
+    for (y = jumlah - 1; y >= 0; y--) {
+        unsigned int h, b;
+        if (isi[y][x][0] == '\0') {
+            idx->berikut[y] = -1;
+            continue;
+        }
+        h = hash_sel(isi[y][x]);
+        b = h & idx->mask;
+        idx->hash[y] = h;
+        idx->berikut[y] = idx->kepala[b];
+        idx->kepala[b] = y;
+    }
+    idx->jumlah_baris = jumlah;
+    idx->valid = 1;
+    return idx;
+}
+
+/* Cari baris pertama di [y1, y2] kolom x yang isinya sama dengan kunci */
+static int cari_di_indeks(const struct konfigurasi *cfg, int x, int y1, int y2,
+                          const char *kunci)
+{
+    struct indeks_kolom *idx;
+    unsigned int h;
+    int y;
+
+    /* Kunci yang tidak ada di pool pasti tidak ada di sel mana pun */
+    if (kunci[0] == '\0' || !(kunci = cari_intern(kunci))) {
+        return -1;
+    }
+    idx = ambil_indeks_kolom(x, cfg->baris);
+    if (!idx) {
+        /* Gagal alokasi: jatuh ke pencarian linear */
+        for (y = y1; y <= y2; y++) {
+            if (isi[y][x] == kunci) {
+                return y;
+            }
+        }
+        return -1;
+    }
+
+    h = hash_sel(kunci);
+    for (y = idx->kepala[h & idx->mask]; y >= 0; y = idx->berikut[y]) {
+        if (y > y2) {
+            break;
+        }
+        if (y >= y1 && isi[y][x] == kunci) {
+            return y;
+        }
+    }
+    return -1;
+}
+
+/* ============================================================
+ * Fungsi Frame
+ * ============================================================ */
+static void minta_frame(enum jenis_frame jenis)
+{
+    if (jenis > frame_tertunda) {
+        frame_tertunda = jenis;
+    }
+}
+
+/* Gambar frame tertunda sekarang juga */
+static void gambar_frame(const struct konfigurasi *cfg)
+{
+    if (frame_tertunda == FRAME_PENUH) {
+        render(cfg);
+    } else if (frame_tertunda == FRAME_SELEKSI) {
+        jejak_mulai("redraw_seleksi_parsial");
+        redraw_seleksi_parsial(cfg);
+        jejak_selesai();
+    } else if (frame_tertunda == FRAME_GULIR) {
+        jejak_mulai("redraw_gulir_parsial");
+        redraw_gulir_parsial(cfg);
+        jejak_selesai();
+    } else if (frame_tertunda == FRAME_NAVIGASI) {
+        jejak_mulai("redraw_navigasi_parsial");
+        redraw_navigasi_parsial(cfg);
+        jejak_selesai();
+    }
+    frame_tertunda = FRAME_TIDAK;
+}
+
+/* Gambar frame tertunda kecuali masih ada input yang menunggu; paling
+ * banyak satu frame per INTERVAL_FRAME_MS */
+static void sajikan_frame(const struct konfigurasi *cfg)
+{
+    while (frame_tertunda != FRAME_TIDAK) {
+        int sisa;
+        if (input_tersedia(0)) {
+            return;
+        }
+        sisa = (int)(waktu_frame_terakhir + INTERVAL_FRAME_MS - waktu_ms());
+        if (sisa > 0) {
+            if (input_tersedia(sisa)) {
+                return;
+            }
+            continue;
+        }
+        gambar_frame(cfg);
+        waktu_frame_terakhir = waktu_ms();
+    }
+}
+
+/* ============================================================
+ * Fungsi Makro
+ * ============================================================ */
+static int indeks_register_makro(int c)
+{
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a';
+    }
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    return -1;
+}
+
+/* m{reg}: mulai merekam ke register; m saat merekam: berhenti */
+static void aksi_rekam_makro(void)
+{
+    unsigned char reg;
+    int r;
+
+    if (makro_rekam >= 0) {
+        struct buffer *b = &register_makro[makro_rekam];
+        /* 'm' penutup ikut terekam bila datang dari keyboard */
+        if (!input_dari_makro && b->size > 0) {
+            b->size--;
+        }
+        snprintf(status_msg, sizeof(status_msg), "Makro %c: %lu byte",
+                 'a' + makro_rekam, (unsigned long)b->size);
+        makro_rekam = -1;
+        return;
+    }
+    if (baca_input(&reg) <= 0) {
+        return;
+    }
+    r = indeks_register_makro(reg);
+    if (r < 0) {
+        snprintf(status_msg, sizeof(status_msg), "Register makro harus a-z");
+        return;
+    }
+    reset_buffer(&register_makro[r]);
+    makro_rekam = r;
+    snprintf(status_msg, sizeof(status_msg), "Merekam makro %c (m untuk berhenti)", 'a' + r);
+}
+
+/* Sisipkan isi register kali kali di depan antrean; makro di dalam
+ * makro ikut terurai saat byte @ dibaca */
+static int putar_makro(int r, int kali)
+{
+    const struct buffer *b = &register_makro[r];
+    size_t sisa = antrean_makro.size - antrean_makro_awal;
+    struct buffer baru;
+    int i;
+
+    if (r == makro_rekam) {
+        snprintf(status_msg, sizeof(status_msg), "Makro %c sedang direkam", 'a' + r);
+        return -1;
+    }
+    if (b->size == 0) {
+        snprintf(status_msg, sizeof(status_msg), "Makro %c kosong", 'a' + r);
+        return -1;
+    }
+    if (kali < 1 || sisa > MAKS_ANTREAN_MAKRO ||
+        b->size > (MAKS_ANTREAN_MAKRO - sisa) / (size_t)kali) {
+        snprintf(status_msg, sizeof(status_msg), "Makro terlalu panjang");
+        return -1;
+    }
+    if (inisialisasi_buffer(&baru, b->size * (size_t)kali + sisa + 1) != 0) {
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk makro");
+        return -1;
+    }
+    for (i = 0; i < kali; i++) {
+        tulis_buffer(&baru, b->data, b->size);
+    }
+    if (sisa > 0) {
+        tulis_buffer(&baru, antrean_makro.data + antrean_makro_awal, sisa);
+    }
+    bersihkan_buffer(&antrean_makro);
+    antrean_makro = baru;
+    antrean_makro_awal = 0;
+    return 0;
+}
+
+/* @{reg}: putar ulang register */
+static void aksi_putar_makro(void)
+{
+    unsigned char reg;
+    int r;
+
+    if (baca_input(&reg) <= 0) {
+        return;
+    }
+    r = indeks_register_makro(reg);
+    if (r < 0) {
+        snprintf(status_msg, sizeof(status_msg), "Register makro harus a-z");
+        return;
+    }
+    putar_makro(r, 1);
+}
+
+/* Register disimpan sebagai byte mentah, sama persis dengan input */
+static int simpan_makro(int r, const char *nama)
+{
+    const struct buffer *b = &register_makro[r];
+    FILE *f = fopen(nama, "wb");
+    if (!f) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuka %.*s", MAKS_NAMA_STATUS, nama);
+        return -1;
+    }
+    if (b->size > 0 && fwrite(b->data, 1, b->size, f) != b->size) {
+        fclose(f);
+        snprintf(status_msg, sizeof(status_msg), "Gagal menulis %.*s", MAKS_NAMA_STATUS, nama);
+        return -1;
+    }
+    fclose(f);
+    snprintf(status_msg, sizeof(status_msg), "Makro %c disimpan ke %.*s (%lu byte)",
+             'a' + r, MAKS_NAMA_STATUS, nama, (unsigned long)b->size);
+    return 0;
+}
+
+static int buka_makro(int r, const char *nama)
+{
+    struct buffer *b = &register_makro[r];
+    char tmp[4096];
+    size_t n;
+    FILE *f;
+
+    if (r == makro_rekam) {
+        snprintf(status_msg, sizeof(status_msg), "Makro %c sedang direkam", 'a' + r);
+        return -1;
+    }
+    f = fopen(nama, "rb");
+    if (!f) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuka %.*s", MAKS_NAMA_STATUS, nama);
+        return -1;
+    }
+    reset_buffer(b);
+    while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0) {
+        if (b->size + n > MAKS_ANTREAN_MAKRO || tulis_buffer(b, tmp, n) != 0) {
+            fclose(f);
+            reset_buffer(b);
+            snprintf(status_msg, sizeof(status_msg), "Makro %.*s terlalu besar",
+                     MAKS_NAMA_STATUS, nama);
+            return -1;
+        }
+    }
+    fclose(f);
+    snprintf(status_msg, sizeof(status_msg), "Makro %c dibuka dari %.*s (%lu byte)",
+             'a' + r, MAKS_NAMA_STATUS, nama, (unsigned long)b->size);
+    return 0;
+}
+
+/* ============================================================
+ * Fungsi Penyimpanan Sel
+ * ============================================================ */
+#define UKURAN_BARIS ((size_t)MAKS_KOLOM * sizeof(const char *))
+#define BARIS_PER_BLOK 256
+
+/* Baris diambil dari blok mmap berisi BARIS_PER_BLOK baris; baris yang
+ * dilepas masuk daftar bebas dan dipakai ulang tanpa kembali ke OS */
+static char *baris_bebas;
+static char *blok_baris;
+static int sisa_blok;
+
+/* Petakan memori nol privat. MAP_ANONYMOUS bukan bagian POSIX.1-2008;
+ * tanpa MAP_ANONYMOUS atau MAP_ANON dipetakan dari /dev/zero */
+static char *petakan_anonim(size_t ukuran)
+{
+    void *p;
+#if defined(MAP_ANONYMOUS)
+    p = mmap(NULL, ukuran, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#elif defined(MAP_ANON)
+    p = mmap(NULL, ukuran, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+#else
+    int fd = open("/dev/zero", O_RDWR);
+    if (fd < 0) {
+        return MAP_FAILED;
+    }
+    p = mmap(NULL, ukuran, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+#endif
+    return p;
+}
+
+/* Petakan baris_kosong sekali: semua sel teks_kosong, lalu read-only */
+static int inisialisasi_penyimpanan(void)
+{
+    char *p;
+    int x;
+
+    if (baris_kosong) {
+        return 0;
+    }
+    p = petakan_anonim(UKURAN_BARIS);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+    for (x = 0; x < MAKS_KOLOM; x++) {
+        ((const char **)p)[x] = teks_kosong;
+    }
+    mprotect(p, UKURAN_BARIS, PROT_READ);
+    baris_kosong = (const char **)p;
+    return 0;
+}
+
+/* Kembalikan baris y ke baris_kosong; referensi teksnya dilepas */
+static void lepas_baris(int y)
+{
+    int x;
+
+    if (isi[y] != baris_kosong) {
+        for (x = 0; x < MAKS_KOLOM; x++) {
+            lepas_intern(isi[y][x]);
+        }
+        *(char **)isi[y] = baris_bebas;
+        baris_bebas = (char *)isi[y];
+        isi[y] = baris_kosong;
+    }
+}
+
+static void lepas_semua_baris(void)
+{
+    int y;
+
+    for (y = 0; y < MAKS_BARIS; y++) {
+        lepas_baris(y);
+    }
+}
+
+/* Beri baris y penyimpanan sendiri sebelum ditulis */
+static int siapkan_baris(int y)
+{
+    char *p;
+    int x;
+
+    if (isi[y] != baris_kosong) {
+        return 0;
+    }
+    if (baris_bebas) {
+        p = baris_bebas;
+        baris_bebas = *(char **)p;
+    } else {
+        if (sisa_blok == 0) {
+            p = petakan_anonim(UKURAN_BARIS * BARIS_PER_BLOK);
+            if (p == MAP_FAILED) {
+                snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk baris %d", y + 1);
+                return -1;
+            }
+            blok_baris = p;
+            sisa_blok = BARIS_PER_BLOK;
+        }
+        p = blok_baris;
+        blok_baris += UKURAN_BARIS;
+        sisa_blok--;
+    }
+    for (x = 0; x < MAKS_KOLOM; x++) {
+        ((const char **)p)[x] = teks_kosong;
+    }
+    isi[y] = (const char **)p;
+    return 0;
+}
+
+/* Ganti teks sel (x, y) dengan salinan dari pool; referensi teks lama
+ * dilepas. Tidak mencatat undo maupun menginvalidasi cache */
+static int tulis_sel(int x, int y, const char *teks)
+{
+    const char *baru;
+
+    if (siapkan_baris(y) != 0) {
+        return -1;
+    }
+    baru = intern(teks);
+    if (!baru) {
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk sel %c%d",
+                 'A' + x, y + 1);
+        return -1;
+    }
+    lepas_intern(isi[y][x]);
+    isi[y][x] = baru;
+    return 0;
+}
+
+/* ============================================================
+ * Fungsi Sheet
+ * ============================================================ */
+/* Arahkan pointer sel global ke sheet s tanpa menyimpan sheet lama */
+static void pasang_sheet(int s)
+{
+    sheet_aktif = s;
+    isi = sheet[s]->baris;
+    gaya_kolom = sheet[s]->gaya;
+    lebar_kolom = sheet[s]->lebar_kolom;
+    tinggi_baris = sheet[s]->tinggi_baris;
+}
+
+/* Tambah sheet kosong kolom x baris di akhir workbook; mengembalikan
+ * indeksnya, -1 jika penuh atau memori habis */
+static int buat_sheet(const char *nama, int kolom, int baris)
+{
+    struct sheet *sh;
+    int i;
+
+    if (jumlah_sheet >= MAKS_SHEET) {
+        snprintf(status_msg, sizeof(status_msg), "Maksimal %d sheet", MAKS_SHEET);
+        return -1;
+    }
+    if (inisialisasi_penyimpanan() != 0 || !(sh = malloc(sizeof(*sh)))) {
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk sheet baru");
+        return -1;
+    }
+    snprintf(sh->nama, sizeof(sh->nama), "%s", nama);
+    memset(&sh->cfg, 0, sizeof(sh->cfg));
+    sh->cfg.kolom = kolom;
+    sh->cfg.baris = baris;
+    sh->beku_baris = sh->beku_kolom = 0;
+    sh->jumlah_predikat = 0;
+    for (i = 0; i < MAKS_BARIS; i++) {
+        sh->baris[i] = baris_kosong;
+        sh->tinggi_baris[i] = 1;
+    }
+    memset(sh->gaya, 0, sizeof(sh->gaya));
+    for (i = 0; i < MAKS_KOLOM; i++) {
+        sh->lebar_kolom[i] = 8;
+    }
+    sheet[jumlah_sheet] = sh;
+    return jumlah_sheet++;
+}
+
+/* Buang sheet s beserta isinya; sheet sesudahnya bergeser turun. Pemanggil
+ * memasang sheet aktif yang baru */
+static void buang_sheet(int s)
+{
+    int x;
+
+    pasang_sheet(s);
+    lepas_semua_baris();
+    for (x = 0; x < MAKS_KOLOM; x++) {
+        free(gaya_kolom[x].run);
+    }
+    free(sheet[s]);
+    memmove(sheet + s, sheet + s + 1, (size_t)(jumlah_sheet - s - 1) * sizeof(sheet[0]));
+    jumlah_sheet--;
+}
+
+/* Pasang sheet s lalu pulihkan posisi, freeze dan filternya */
+static void aktifkan_sheet(struct konfigurasi *cfg, int s)
+{
+    struct sheet *sh = sheet[s];
+
+    pasang_sheet(s);
+    *cfg = sh->cfg;
+    beku_baris = sh->beku_baris;
+    beku_kolom = sh->beku_kolom;
+    memcpy(predikat_filter, sh->predikat, (size_t)sh->jumlah_predikat * sizeof(predikat_filter[0]));
+    jumlah_predikat = sh->jumlah_predikat;
+    filter_baris = cfg->baris;
+    if (jumlah_predikat > 0) {
+        evaluasi_filter();
+    } else {
+        filter_aktif = 0;
+    }
+
+    selecting = 0;
+    sel_anchor_x = sel_anchor_y = -1;
+    invalidasi_semua_indeks();
+    versi_isi++;
+    versi_lebar++;
+    tampil_valid = 0;
+    minta_frame(FRAME_PENUH);
+}
+
+/* Simpan posisi, freeze dan filter sheet aktif lalu aktifkan sheet s */
+static void pindah_sheet(struct konfigurasi *cfg, int s)
+{
+    struct sheet *sh = sheet[sheet_aktif];
+
+    if (s == sheet_aktif || s < 0 || s >= jumlah_sheet) {
+        return;
+    }
+    sh->cfg = *cfg;
+    sh->beku_baris = beku_baris;
+    sh->beku_kolom = beku_kolom;
+    memcpy(sh->predikat, predikat_filter, (size_t)jumlah_predikat * sizeof(predikat_filter[0]));
+    sh->jumlah_predikat = jumlah_predikat;
+    aktifkan_sheet(cfg, s);
+}
+
+/* ============================================================
+ * Fungsi Undo/Redo
+ * ============================================================ */
+static void buang_potret(struct potret_area *p)
+{
+    int i, n;
+
+    if (!p) {
+        return;
+    }
+    n = p->jumlah * (p->x2 - p->x1 + 1);
+    for (i = 0; i < n; i++) {
+        lepas_intern(p->sel[i]);
+    }
+    free(p->sel);
+    free(p->baris);
+    free(p);
+}
+
+static void buang_op(struct op *op)
+{
+    free(op->perm);
+    op->perm = NULL;
+    buang_potret(op->area);
+    op->area = NULL;
+    if (op->gaya_ada) {
+        free(op->gaya.run);
+        op->gaya_ada = 0;
+    }
+}
+
+static void buang_redo(void)
+{
+    while (redo_top > 0) {
+        redo_top--;
+        buang_op(&redo_stack[redo_top]);
+    }
+}
+
+/* Stack penuh: buang grup tertua dari dasar stack, selalu utuh, sampai
+ * paling sedikit UNDO_MAX / 8 slot bebas. Perubahan besar (pivot, muat
+ * ulang, siklus soket) dicatat sebagai satu op wilayah, jadi transaksi
+ * tetap kecil dan grup teratas yang sedang diisi tidak tersentuh */
+static void buang_grup_tertua(struct op *stack, int *top)
+{
+    int n = 0;
+
+    while (n < UNDO_MAX / 8 && n < *top) {
+        int grup = stack[n].grup;
+        while (n < *top && stack[n].grup == grup) {
+            buang_op(&stack[n++]);
+        }
+    }
+    memmove(stack, stack + n, (size_t)(*top - n) * sizeof(*stack));
+    *top -= n;
+    memset(stack + *top, 0, (size_t)n * sizeof(*stack));
+}
+
+/* Sisipkan op ke undo stack tanpa menyentuh redo stack */
+static struct op *catat_undo(void)
+{
+    struct op *op;
+    if (undo_top >= UNDO_MAX) {
+        buang_grup_tertua(undo_stack, &undo_top);
+    }
+    if (!transaksi_aktif) {
+        undo_grup++;
+    }
+    op = &undo_stack[undo_top++];
+    op->grup = undo_grup;
+    op->perm = NULL;
+    op->gaya_ada = 0;
+    op->area = NULL;
+    op->sheet = sheet_aktif;
+    return op;
+}
+
+static void push_undo(int x, int y, const char *before, const char *after)
+{
+    struct op *op = catat_undo();
+    op->x = x;
+    op->y = y;
+    strncpy(op->before, before, MAX_TEXT - 1);
+    strncpy(op->after, after, MAX_TEXT - 1);
+    op->before[MAX_TEXT - 1] = '\0';
+    op->after[MAX_TEXT - 1] = '\0';
+    buang_redo();
+}
+
+/* Catat permutasi baris sebagai satu op; kepemilikan perm pindah ke stack */
+static void push_undo_permutasi(int x1, int y1, int x2, int y2, int *perm)
+{
+    struct op *op = catat_undo();
+    op->x = x1;
+    op->y = y1;
+    op->x2 = x2;
+    op->y2 = y2;
+    op->before[0] = '\0';
+    op->after[0] = '\0';
+    op->perm = perm;
+    buang_redo();
+}
+
+/* Catat run gaya kolom x sebelum diubah; kepemilikan run pindah ke stack */
+static void push_undo_gaya(int x, int y, const struct kolom_gaya *lama)
+{
+    struct op *op = catat_undo();
+    op->x = x;
+    op->y = y;
+    op->before[0] = '\0';
+    op->after[0] = '\0';
+    op->gaya_ada = 1;
+    op->gaya = *lama;
+    buang_redo();
+}
+
+/* Potret kosong untuk kolom x1..x2; NULL jika memori habis */
+static struct potret_area *buat_potret(int x1, int x2)
+{
+    struct potret_area *p = calloc(1, sizeof(*p));
+
+    if (!p) {
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk undo");
+        return NULL;
+    }
+    p->x1 = x1;
+    p->x2 = x2;
+    return p;
+}
+
+/* Tambahkan isi baris y sekarang ke potret; teks sel ikut direferensikan */
+static int potret_baris(struct potret_area *p, int y)
+{
+    int lebar = p->x2 - p->x1 + 1, x;
+    const char **sel;
+
+    if (p->jumlah == p->kapasitas) {
+        int kapasitas = p->kapasitas ? p->kapasitas * 2 : 16;
+        int *baris = realloc(p->baris, (size_t)kapasitas * sizeof(int));
+        if (!baris) {
+            snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk undo");
+            return -1;
+        }
+        p->baris = baris;
+        sel = realloc(p->sel, (size_t)kapasitas * (size_t)lebar * sizeof(const char *));
+        if (!sel) {
+            snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk undo");
+            return -1;
+        }
+        p->sel = sel;
+        p->kapasitas = kapasitas;
+    }
+    sel = p->sel + (size_t)p->jumlah * (size_t)lebar;
+    for (x = 0; x < lebar; x++) {
+        sel[x] = isi[y][p->x1 + x];
+        if (sel[x][0] != '\0') {
+            ENTRI_INTERN(sel[x])->ref++;
+        }
+    }
+    p->baris[p->jumlah++] = y;
+    return 0;
+}
+
+/* Catat potret wilayah sebelum diubah sebagai satu op, berapa pun
+ * banyak selnya; kepemilikan potret pindah ke stack */
+static void push_undo_area(struct potret_area *p)
+{
+    struct op *op = catat_undo();
+    op->x = p->x1;
+    op->y = p->jumlah ? p->baris[0] : 0;
+    op->x2 = p->x2;
+    op->y2 = p->jumlah ? p->baris[p->jumlah - 1] : 0;
+    op->before[0] = '\0';
+    op->after[0] = '\0';
+    op->area = p;
+    buang_redo();
+}
+
+/* Tukar isi wilayah dengan potret op; seperti tukar_gaya_op, undo dan
+ * redo sama-sama hanya membalik pertukaran. Referensi tidak berubah
+ * karena yang ditukar pointer ke pool */
+static int tukar_area_op(struct op *op)
+{
+    struct potret_area *p = op->area;
+    int lebar = p->x2 - p->x1 + 1, i, x;
+
+    for (i = 0; i < p->jumlah; i++) {
+        if (siapkan_baris(p->baris[i]) != 0) {
+            return -1;
+        }
+    }
+    for (i = 0; i < p->jumlah; i++) {
+        const char **sel = p->sel + (size_t)i * (size_t)lebar;
+        int y = p->baris[i];
+        for (x = 0; x < lebar; x++) {
+            const char *kini = isi[y][p->x1 + x];
+            isi[y][p->x1 + x] = sel[x];
+            sel[x] = kini;
+            invalidasi_letak_sel(p->x1 + x, y);
+        }
+    }
+    versi_isi++;
+    for (x = p->x1; x <= p->x2; x++) {
+        invalidasi_indeks_kolom(x);
+    }
+    perbarui_filter();
+    return 0;
+}
+
+/* Tukar run gaya kolom op->x dengan yang tersimpan di op; dipakai undo
+ * maupun redo karena keduanya hanya membalik pertukaran */
+static void tukar_gaya_op(struct op *op)
+{
+    struct kolom_gaya kini = gaya_kolom[op->x];
+
+    gaya_kolom[op->x] = op->gaya;
+    gaya_kolom[op->x].petunjuk = 0;
+    op->gaya = kini;
+}
+
+/* Semua op di antara mulai_transaksi dan akhiri_transaksi menjadi satu
+ * langkah undo */
+static void mulai_transaksi(void)
+{
+    undo_grup++;
+    transaksi_aktif = 1;
+}
+
+static void akhiri_transaksi(void)
+{
+    transaksi_aktif = 0;
+}
+
+static void set_cell_text(struct konfigurasi *cfg, int x, int y,
+                          const char *text, int record_undo)
+{
+    char before[MAX_TEXT];
+    strncpy(before, isi[y][x], MAX_TEXT - 1);
+    before[MAX_TEXT - 1] = '\0';
+    if (tulis_sel(x, y, text) != 0) {
+        return;
+    }
+    invalidasi_indeks_kolom(x);
+    invalidasi_letak_sel(x, y);
+    if (record_undo) {
+        push_undo(x, y, before, isi[y][x]);
+    }
+}
+
+/* ============================================================
+ * Fungsi Navigasi
+ * ============================================================ */
+static void move_right(struct konfigurasi *cfg)
+{
+    if (cfg->aktif_x < cfg->kolom - 1) {
+        cfg->prev_x = cfg->aktif_x;
+        cfg->prev_y = cfg->aktif_y;
+        cfg->aktif_x++;
+        
+        /* Cek apakah perlu menggeser viewport */
+        int xa, ya, pad, vw, vh, cs, ce, rs, re;
+        int m, n, fw, fh;
+        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
+        hitung_beku(cfg, &m, &n, &fw, &fh);
+        
+        /* Jika sedang seleksi, update status message dan minta redraw parsial */
+        if (selecting) {
+            update_seleksi_status(cfg);
+            minta_frame(FRAME_SELEKSI);
+        } else {
+            /* Jika sel aktif masih dalam viewport yang sama (atau kolom beku),
+             * gunakan redraw parsial */
+            if (cfg->aktif_x < m || (cfg->aktif_x >= cs && cfg->aktif_x <= ce)) {
+                minta_frame(FRAME_NAVIGASI);
+            } else {
+                /* Jika tidak, geser viewport; kolom beku tidak digambar ulang */
+                cfg->view_col = cfg->aktif_x;
+                minta_frame(FRAME_GULIR);
+            }
+        }
+    }
+}
+
+static void move_left(struct konfigurasi *cfg)
+{
+    if (cfg->aktif_x > 0) {
+        cfg->prev_x = cfg->aktif_x;
+        cfg->prev_y = cfg->aktif_y;
+        cfg->aktif_x--;
+        
+        /* Cek apakah perlu menggeser viewport */
+        int xa, ya, pad, vw, vh, cs, ce, rs, re;
+        int m, n, fw, fh;
+        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
+        hitung_beku(cfg, &m, &n, &fw, &fh);
+        
+        /* Jika sedang seleksi, update status message dan minta redraw parsial */
+        if (selecting) {
+            update_seleksi_status(cfg);
+            minta_frame(FRAME_SELEKSI);
+        } else {
+            /* Jika sel aktif masih dalam viewport yang sama (atau kolom beku),
+             * gunakan redraw parsial */
+            if (cfg->aktif_x < m || (cfg->aktif_x >= cs && cfg->aktif_x <= ce)) {
+                minta_frame(FRAME_NAVIGASI);
+            } else {
+                /* Jika tidak, geser viewport; kolom beku tidak digambar ulang */
+                cfg->view_col = cfg->aktif_x;
+                minta_frame(FRAME_GULIR);
+            }
+        }
+    }
+}
+
+static void move_down(struct konfigurasi *cfg)
+{
+    int berikut = baris_berikut(cfg->aktif_y);
+    if (berikut < cfg->baris) {
+        cfg->prev_x = cfg->aktif_x;
+        cfg->prev_y = cfg->aktif_y;
+        cfg->aktif_y = berikut;
+        
+        /* Cek apakah perlu menggeser viewport */
+        int xa, ya, pad, vw, vh, cs, ce, rs, re;
+        int m, n, fw, fh;
+        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
+        hitung_beku(cfg, &m, &n, &fw, &fh);
+        
+        /* Jika sedang seleksi, update status message dan minta redraw parsial */
+        if (selecting) {
+            update_seleksi_status(cfg);
+            minta_frame(FRAME_SELEKSI);
+        } else {
+            /* Jika sel aktif masih dalam viewport yang sama (atau baris beku),
+             * gunakan redraw parsial */
+            if (cfg->aktif_y < n || (cfg->aktif_y >= rs && cfg->aktif_y <= re)) {
+                minta_frame(FRAME_NAVIGASI);
+            } else {
+                /* Keluar dari baris beku ke body yang sedang tergulir */
+                if (cfg->aktif_y < rs) {
+                    cfg->view_row = cfg->aktif_y;
+                }
+                /* Geser viewport seperlunya agar sel aktif masuk dari bawah */
+                while (cfg->aktif_y > re && rs < cfg->aktif_y) {
+                    cfg->view_row = baris_berikut(rs);
+                    hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
+                }
+                minta_frame(FRAME_GULIR);
+            }
+        }
+    }
+}
+
+static void move_up(struct konfigurasi *cfg)
+{
+    int sebelum = baris_sebelum(cfg->aktif_y);
+    if (sebelum >= 0) {
+        cfg->prev_x = cfg->aktif_x;
+        cfg->prev_y = cfg->aktif_y;
+        cfg->aktif_y = sebelum;
+        
+        /* Cek apakah perlu menggeser viewport */
+        int xa, ya, pad, vw, vh, cs, ce, rs, re;
+        int m, n, fw, fh;
+        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
+        hitung_beku(cfg, &m, &n, &fw, &fh);
+        
+        /* Jika sedang seleksi, update status message dan minta redraw parsial */
+        if (selecting) {
+            update_seleksi_status(cfg);
+            minta_frame(FRAME_SELEKSI);
+        } else {
+            /* Jika sel aktif masih dalam viewport yang sama (atau baris beku),
+             * gunakan redraw parsial */
+            if (cfg->aktif_y < n || (cfg->aktif_y >= rs && cfg->aktif_y <= re)) {
+                minta_frame(FRAME_NAVIGASI);
+            } else {
+                /* Geser viewport sehingga sel aktif jadi baris teratas */
+                cfg->view_row = cfg->aktif_y;
+                minta_frame(FRAME_GULIR);
+            }
+        }
+    }
+}
+
+static void ensure_active_visible(struct konfigurasi *cfg)
+{
+    int xa, ya, pad, vw, vh, cs, ce, rs, re;
+    int m, n, fw, fh;
+
+    /* Sel aktif di baris tersembunyi: pindah ke baris terlihat terdekat */
+    if (!baris_terlihat(cfg->aktif_y)) {
+        int r = baris_terlihat_dari(cfg->aktif_y);
+        if (r >= cfg->baris) {
+            r = baris_terlihat_sampai(cfg->aktif_y);
+        }
+        if (r >= 0) {
+            cfg->aktif_y = r;
+        }
+    }
+
+    hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
+    hitung_beku(cfg, &m, &n, &fw, &fh);
+    
+    /* Geser viewport satu kolom/baris saat ini jika perlu; sel di pane
+     * beku selalu terlihat */
+    if (cfg->aktif_x < m) {
+        /* tetap */
+    } else if (cfg->aktif_x < cs) {
+        cfg->view_col = cfg->aktif_x;
+    } else if (cfg->aktif_x > ce) {
+        cfg->view_col = cfg->aktif_x;
+    }
+    
+    if (cfg->aktif_y < n) {
+        /* tetap */
+    } else if (cfg->aktif_y < rs) {
+        cfg->view_row = cfg->aktif_y;
+    } else if (cfg->aktif_y > re) {
+        cfg->view_row = cfg->aktif_y;
+    }
+}
+
+/* Satu langkah panah (A/B/C/D seperti ESC [ X) beserta jenis frame yang
+ * dibutuhkannya */
+static void navigasi_panah(struct konfigurasi *cfg, unsigned char arah)
+{
+    int old_view_col = cfg->view_col;
+    int old_view_row = cfg->view_row;
+    int viewport_changed;
+
+    if (arah == 'A') {
+        move_up(cfg);
+    } else if (arah == 'B') {
+        move_down(cfg);
+    } else if (arah == 'C') {
+        move_right(cfg);
+    } else if (arah == 'D') {
+        move_left(cfg);
+    }
+
+    /* Periksa apakah viewport perlu diubah */
+    ensure_active_visible(cfg);
+    viewport_changed = (old_view_col != cfg->view_col || 
+                      old_view_row != cfg->view_row);
+
+    if (viewport_changed && selecting) {
+        minta_frame(FRAME_PENUH);
+    } else if (viewport_changed) {
+        minta_frame(FRAME_GULIR);
+    } else {
+        minta_frame(FRAME_NAVIGASI);
+    }
+}
+
+/* ============================================================
+ * Fungsi Mode Edit
+ * ============================================================ */
+/* Sisipkan karakter yang diawali byte ch ke buf di posisi cursor; sisa
+ * byte UTF-8 dibaca dari input. Sequence yang terputus dibuang. */
+static void sisip_karakter(char *buf, int *len, int *cursor, unsigned char ch)
+{
+    char seq[4];
+    int n = panjang_utf8(ch), k;
+
+    seq[0] = (char)ch;
+    for (k = 1; k < n; k++) {
+        unsigned char lanjut;
+        if (baca_input(&lanjut) <= 0 || (lanjut & 0xC0) != 0x80) {
+            return;
+        }
+        seq[k] = (char)lanjut;
+    }
+    if (*len + n > MAX_TEXT - 1) {
+        return;
+    }
+    memmove(buf + *cursor + n, buf + *cursor, (size_t)(*len - *cursor));
+    memcpy(buf + *cursor, seq, (size_t)n);
+    *cursor += n;
+    *len += n;
+    buf[*len] = '\0';
+}
+
+/* Hapus satu karakter yang dimulai di offset i */
+static void hapus_karakter(char *buf, int *len, int i)
+{
+    int n = maju_utf8(buf, *len, i) - i;
+    memmove(buf + i, buf + i + n, (size_t)(*len - i - n + 1));
+    *len -= n;
+}
+
+static void mode_edit(struct konfigurasi *cfg)
+{
+    char buf[MAX_TEXT];
+    int len, cursor;
+    unsigned char ch;
+    char kol = (char)('A' + cfg->aktif_x);
+    int bar = cfg->aktif_y + 1;
+    char label[64];
+    int input_x;
+
+    strncpy(buf, isi[cfg->aktif_y][cfg->aktif_x], MAX_TEXT - 1);
+    buf[MAX_TEXT - 1] = '\0';
+    len = (int)strlen(buf);
+    cursor = len;
+    snprintf(label, sizeof(label), "kolom %c%d: ", kol, bar);
+    input_x = 2 + (int)strlen(label);
+
+    /* Tampilkan label + isi lama */
+    kosongkan_baris(1);
+    pos(2, 1);
+    tulis_teks(label, strlen(label));
+    tulis_teks(buf, (size_t)len);
+    {
+        char judul[] = "TABEL v0.7";
+        pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
+        tulis_teks(judul, strlen(judul));
+    }
+    pos(input_x + lebar_teks(buf, cursor), 1);
+    tulis_teks("\033[?25h", 6);
+    flush();
+
+    while (baca_input(&ch) > 0) {
+        if (ch == '\n' || ch == '\r') {
+            set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, buf, 1);
+            snprintf(status_msg, sizeof(status_msg), "Mengubah isi kolom %c%d", kol, bar);
+            break;
+        } else if (ch == '\t') {
+            set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, buf, 1);
+            move_right(cfg);
+            ensure_active_visible(cfg);
+            render(cfg);
+            /* Lanjut ke sel berikutnya */
+            mode_edit(cfg);
+            return;
+        } else if (ch == 0x1B) {
+            unsigned char s1;
+            if (baca_input(&s1) <= 0) {
+                continue;
+            }
+            if (s1 == '[') {
+                unsigned char s2;
+                if (baca_input(&s2) <= 0) {
+                    continue;
+                }
+                if (s2 == 'D') {
+                    if (cursor > 0) {
+                        cursor = mundur_utf8(buf, cursor);
+                    }
+                } else if (s2 == 'C') {
+                    if (cursor < len) {
+                        cursor = maju_utf8(buf, len, cursor);
+                    }
+                } else if (s2 == '3') {
+                    unsigned char t;
+                    if (baca_input(&t) <= 0) {
+                        continue;
+                    }
+                    if (t == '~') {
+                        if (cursor < len) {
+                            hapus_karakter(buf, &len, cursor);
+                        }
+                    }
+                }
+            }
+        } else if (ch == 0x7F) {
+            if (cursor > 0) {
+                cursor = mundur_utf8(buf, cursor);
+                hapus_karakter(buf, &len, cursor);
+            }
+        } else if ((ch >= 0x20 && ch <= 0x7E) || ch >= 0xC0) {
+            sisip_karakter(buf, &len, &cursor, ch);
+        }
+
+        /* Update tampilan */
+        kosongkan_baris(1);
+        pos(2, 1);
+        tulis_teks(label, strlen(label));
+        tulis_teks(buf, (size_t)len);
+        {
+            char judul[] = "TABEL v0.7";
+            pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
+            tulis_teks(judul, strlen(judul));
+        }
+        pos(input_x + lebar_teks(buf, cursor), 1);
+        flush();
+    }
+
+    tulis_teks("\033[?25l", 6);
+    render(cfg);
+}
+
+/* ============================================================
+ * Fungsi Sort
+ * ============================================================ */
+struct kunci_sort {
+    int kolom;
+    int menurun;
+};
+
+/* Nilai kunci yang di-parse sekali sebelum sort dimulai */
+struct nilai_sort {
+    double angka;
+    const char *teks;
+    int jenis;          /* 0 = angka, 1 = teks, 2 = kosong */
+};
+
+struct konteks_sort {
+    const struct kunci_sort *kunci;
+    int jumlah_kunci;
+    const struct nilai_sort *nilai;  /* jumlah_kunci blok berisi n nilai */
+    int n;
+};
+
+struct tugas_sort {
+    const struct konteks_sort *ks;
+    int *idx;
+    int *tmp;
+    int n;
+};
+
+static void parse_nilai_sort(const char *teks, struct nilai_sort *nv)
+{
+    char *akhir;
+    nv->teks = teks;
+    if (teks[0] == '\0') {
+        nv->jenis = 2;
+        return;
+    }
+    nv->angka = strtod(teks, &akhir);
+    while (*akhir == ' ') {
+        akhir++;
+    }
+    nv->jenis = (akhir != teks && *akhir == '\0') ? 0 : 1;
+}
+
+/* Bandingkan dua nilai kunci; sel kosong selalu di akhir apa pun arahnya */
+static int bandingkan_nilai(const struct nilai_sort *na,
+                            const struct nilai_sort *nb, int menurun)
+{
+    int hasil;
+    if (na->jenis == 2 || nb->jenis == 2) {
+        if (na->jenis == nb->jenis) {
+            return 0;
+        }
+        return na->jenis == 2 ? 1 : -1;
+    }
+    if (na->jenis != nb->jenis) {
+        hasil = na->jenis - nb->jenis;  /* angka sebelum teks */
+    } else if (na->jenis == 0) {
+        hasil = na->angka < nb->angka ? -1 : (na->angka > nb->angka ? 1 : 0);
+    } else {
+        hasil = strcmp(na->teks, nb->teks);
+    }
+    return menurun ? -hasil : hasil;
+}
+
+static int bandingkan_baris(const struct konteks_sort *ks, int a, int b)
+{
+    int k;
+    for (k = 0; k < ks->jumlah_kunci; k++) {
+        int hasil = bandingkan_nilai(&ks->nilai[k * ks->n + a],
+                                     &ks->nilai[k * ks->n + b],
+                                     ks->kunci[k].menurun);
+        if (hasil != 0) {
+            return hasil;
+        }
+    }
+    return 0;
+}
+
+/* Gabungkan a[0..na) dan b[0..nb) ke dst; stabil */
+static void gabung_run(const struct konteks_sort *ks, const int *a, int na,
+                       const int *b, int nb, int *dst)
+{
+    int i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (bandingkan_baris(ks, b[j], a[i]) < 0) {
+            dst[k++] = b[j++];
+        } else {
+            dst[k++] = a[i++];
+        }
+    }
+    while (i < na) {
+        dst[k++] = a[i++];
+    }
+    while (j < nb) {
+        dst[k++] = b[j++];
+    }
+}
+
+static void urut_gabung(const struct konteks_sort *ks, int *idx, int *tmp, int n)
+{
+    int tengah;
+    if (n < 2) {
+        return;
+    }
+    if (n <= 16) {
+        /* Insertion sort untuk potongan kecil */
+        int i, j;
+        for (i = 1; i < n; i++) {
+            int v = idx[i];
+            for (j = i; j > 0 && bandingkan_baris(ks, v, idx[j - 1]) < 0; j--) {
+                idx[j] = idx[j - 1];
+            }
+            idx[j] = v;
+        }
+        return;
+    }
+    tengah = n / 2;
+    urut_gabung(ks, idx, tmp, tengah);
+    urut_gabung(ks, idx + tengah, tmp + tengah, n - tengah);
+    if (bandingkan_baris(ks, idx[tengah], idx[tengah - 1]) >= 0) {
+        return;  /* sudah terurut */
+    }
+    gabung_run(ks, idx, tengah, idx + tengah, n - tengah, tmp);
+    memcpy(idx, tmp, (size_t)n * sizeof(int));
+}
+
+static void *thread_sort(void *arg)
+{
+    struct tugas_sort *t = arg;
+    urut_gabung(t->ks, t->idx, t->tmp, t->n);
+    return NULL;
+}
+
+/* Merge sort; di atas AMBANG_SORT_PARALEL tiap potongan diurutkan oleh
+ * thread sendiri lalu digabung berpasangan */
+static void urut_indeks(const struct konteks_sort *ks, int *idx, int *tmp, int n)
+{
+    pthread_t th[MAKS_THREAD_SORT];
+    struct tugas_sort tugas[MAKS_THREAD_SORT];
+    int awal[MAKS_THREAD_SORT + 1];
+    int jumlah = 1, i, lebar;
+    long cpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n >= AMBANG_SORT_PARALEL && cpu > 1) {
+        jumlah = cpu > MAKS_THREAD_SORT ? MAKS_THREAD_SORT : (int)cpu;
+    }
+    if (jumlah == 1) {
+        urut_gabung(ks, idx, tmp, n);
+        return;
+    }
+
+    for (i = 0; i <= jumlah; i++) {
+        awal[i] = (int)((long)n * i / jumlah);
+    }
+    for (i = 0; i < jumlah; i++) {
+        tugas[i].ks = ks;
+        tugas[i].idx = idx + awal[i];
+        tugas[i].tmp = tmp + awal[i];
+        tugas[i].n = awal[i + 1] - awal[i];
+        if (pthread_create(&th[i], NULL, thread_sort, &tugas[i]) != 0) {
+            thread_sort(&tugas[i]);
+            tugas[i].ks = NULL;
+        }
+    }
+    for (i = 0; i < jumlah; i++) {
+        if (tugas[i].ks) {
+            pthread_join(th[i], NULL);
+        }
+    }
+
+    /* Gabungkan potongan berpasangan sampai tersisa satu run */
+    for (lebar = 1; lebar < jumlah; lebar *= 2) {
+        for (i = 0; i + lebar < jumlah; i += 2 * lebar) {
+            int a = awal[i], b = awal[i + lebar];
+            int c = awal[i + 2 * lebar < jumlah ? i + 2 * lebar : jumlah];
+            gabung_run(ks, idx + a, b - a, idx + b, c - b, tmp + a);
+            memcpy(idx + a, tmp + a, (size_t)(c - a) * sizeof(int));
+        }
+    }
+}
+
+/* Terapkan permutasi ke baris y1..y2 kolom x1..x2: baris baru ke-i
+ * adalah baris lama ke-perm[i]. Tiap sel dipindah tepat sekali dengan
+ * mengikuti siklus permutasi; yang dipindah pointer ke pool sehingga
+ * referensi tidak berubah. invers != 0 membalik permutasi. */
+static int terapkan_permutasi(int x1, int y1, int x2, int y2,
+                              const int *perm, int invers)
+{
+    int n = y2 - y1 + 1, lebar = x2 - x1 + 1;
+    int *p = NULL;
+    const char **simpan = malloc((size_t)lebar * sizeof(const char *));
+    unsigned char *selesai = calloc((size_t)n, 1);
+    int i, x;
+
+    if (invers) {
+        p = malloc((size_t)n * sizeof(int));
+        if (p) {
+            for (i = 0; i < n; i++) {
+                p[perm[i]] = i;
+            }
+            perm = p;
+        }
+    }
+    if (!simpan || !selesai || (invers && !p)) {
+        free(simpan);
+        free(selesai);
+        free(p);
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        if (perm[i] != i && siapkan_baris(y1 + i) != 0) {
+            free(simpan);
+            free(selesai);
+            free(p);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        int j;
+        if (selesai[i] || perm[i] == i) {
+            continue;
+        }
+        for (x = 0; x < lebar; x++) {
+            simpan[x] = isi[y1 + i][x1 + x];
+        }
+        j = i;
+        while (perm[j] != i) {
+            for (x = x1; x <= x2; x++) {
+                isi[y1 + j][x] = isi[y1 + perm[j]][x];
+            }
+            selesai[j] = 1;
+            j = perm[j];
+        }
+        for (x = 0; x < lebar; x++) {
+            isi[y1 + j][x1 + x] = simpan[x];
+        }
+        selesai[j] = 1;
+    }
+
+    /* Gaya ikut baris; gagal di sini hanya membuat gaya tertinggal */
+    for (x = x1; x <= x2; x++) {
+        permutasi_gaya(x, y1, n, perm);
+    }
+
+    versi_isi++;
+    for (x = x1; x <= x2; x++) {
+        invalidasi_indeks_kolom(x);
+    }
+    perbarui_filter();
+    free(simpan);
+    free(selesai);
+    free(p);
+    return 0;
+}
+
+/* Sort seleksi aktif (atau seluruh sheet) berdasarkan satu atau lebih
+ * kolom kunci, sebagai satu langkah undo */
+static int aksi_sort(struct konfigurasi *cfg, const struct kunci_sort *kunci,
+                     int jumlah_kunci)
+{
+    struct konteks_sort ks;
+    struct nilai_sort *nilai;
+    int *idx, *tmp;
+    int x1 = 0, y1 = 0, x2 = cfg->kolom - 1, y2 = cfg->baris - 1;
+    int n, i, k, berubah = 0;
+
+    if (selecting) {
+        x1 = sel_anchor_x < cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+        x2 = sel_anchor_x > cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+        y1 = sel_anchor_y < cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+        y2 = sel_anchor_y > cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+    }
+    for (k = 0; k < jumlah_kunci; k++) {
+        if (kunci[k].kolom < x1 || kunci[k].kolom > x2) {
+            snprintf(status_msg, sizeof(status_msg),
+                     "Kolom kunci %c di luar seleksi", 'A' + kunci[k].kolom);
+            return -1;
+        }
+    }
+
+    n = y2 - y1 + 1;
+    nilai = malloc((size_t)n * (size_t)jumlah_kunci * sizeof(*nilai));
+    idx = malloc((size_t)n * sizeof(int));
+    tmp = malloc((size_t)n * sizeof(int));
+    if (!nilai || !idx || !tmp) {
+        free(nilai);
+        free(idx);
+        free(tmp);
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk sort");
+        return -1;
+    }
+
+    for (k = 0; k < jumlah_kunci; k++) {
+        for (i = 0; i < n; i++) {
+            parse_nilai_sort(isi[y1 + i][kunci[k].kolom], &nilai[k * n + i]);
+        }
+    }
+    for (i = 0; i < n; i++) {
+        idx[i] = i;
+    }
+    ks.kunci = kunci;
+    ks.jumlah_kunci = jumlah_kunci;
+    ks.nilai = nilai;
+    ks.n = n;
+    urut_indeks(&ks, idx, tmp, n);
+    free(nilai);
+    free(tmp);
+
+    for (i = 0; i < n; i++) {
+        if (idx[i] != i) {
+            berubah = 1;
+            break;
+        }
+    }
+    if (!berubah) {
+        free(idx);
+        snprintf(status_msg, sizeof(status_msg), "Data sudah terurut");
+        return 0;
+    }
+    if (terapkan_permutasi(x1, y1, x2, y2, idx, 0) != 0) {
+        free(idx);
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk sort");
+        return -1;
+    }
+    push_undo_permutasi(x1, y1, x2, y2, idx);
+    snprintf(status_msg, sizeof(status_msg), "Sort %d baris (%c%d - %c%d)",
+             n, 'A' + x1, y1 + 1, 'A' + x2, y2 + 1);
+    return 0;
+}
+
+/* Parse daftar kunci "B desc, A asc" */
+static int parse_kunci_sort(const char *teks, struct kunci_sort *kunci, int maks)
+{
+    char salinan[MAX_FORMULA_LENGTH];
+    char *token;
+    int n = 0;
+
+    strncpy(salinan, teks, sizeof(salinan) - 1);
+    salinan[sizeof(salinan) - 1] = '\0';
+    for (token = strtok(salinan, " ,"); token; token = strtok(NULL, " ,")) {
+        if (strcmp(token, "asc") == 0 || strcmp(token, "ASC") == 0 ||
+            strcmp(token, "desc") == 0 || strcmp(token, "DESC") == 0) {
+            if (n == 0) {
+                return -1;
+            }
+            kunci[n - 1].menurun = (token[0] == 'd' || token[0] == 'D');
+        } else if (token[0] >= 'A' && token[0] <= 'Z' && token[1] == '\0') {
+            if (n >= maks) {
+                return -1;
+            }
+            kunci[n].kolom = token[0] - 'A';
+            kunci[n].menurun = 0;
+            n++;
+        } else {
+            return -1;
+        }
+    }
+    return n;
+}
+
+/* ============================================================
+ * Fungsi Pivot
+ * ============================================================ */
+struct agregat {
+    double jumlah;
+    double min;
+    double max;
+    int isi;            /* sel tidak kosong */
+    int angka;          /* sel berisi angka */
+};
+
+struct spesifikasi_pivot {
+    int kunci[MAKS_KUNCI_PIVOT];
+    int jumlah_kunci;
+    int kolom_nilai[MAKS_NILAI_PIVOT];
+    enum fungsi_agregat fungsi[MAKS_NILAI_PIVOT];
+    int jumlah_nilai;
+};
+
+/* Tabel hash grup dengan open addressing; tiap grup diwakili baris
+ * pertama tempat kuncinya muncul */
+struct tabel_grup {
+    const struct spesifikasi_pivot *spek;
+    int *slot;
+    unsigned int mask;
+    int n;
+    int kapasitas;
+    unsigned int *hash;
+    int *baris;
+    struct agregat *agg;
+};
+
+struct tugas_pivot {
+    struct tabel_grup tabel;
+    int awal;
+    int akhir;
+    int gagal;
+};
+
+static unsigned int hash_kunci_pivot(const struct spesifikasi_pivot *spek, int r)
+{
+    unsigned int h = 0;
+    int k;
+    for (k = 0; k < spek->jumlah_kunci; k++) {
+        h = h * 31u + hash_sel(isi[r][spek->kunci[k]]);
+    }
+    return h;
+}
+
+static int kunci_pivot_sama(const struct spesifikasi_pivot *spek, int a, int b)
+{
+    int k;
+    for (k = 0; k < spek->jumlah_kunci; k++) {
+        if (isi[a][spek->kunci[k]] != isi[b][spek->kunci[k]]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void bebaskan_tabel_grup(struct tabel_grup *t)
+{
+    free(t->slot);
+    free(t->hash);
+    free(t->baris);
+    free(t->agg);
+    t->slot = NULL;
+    t->hash = NULL;
+    t->baris = NULL;
+    t->agg = NULL;
+}
+
+static int tumbuh_tabel_grup(struct tabel_grup *t)
+{
+    int kap = t->kapasitas ? t->kapasitas * 2 : 256;
+    unsigned int slot_baru = (unsigned int)kap * 2, i;
+    int *slot = malloc(slot_baru * sizeof(int));
+    unsigned int *hash = realloc(t->hash, (size_t)kap * sizeof(unsigned int));
+    int *baris;
+    struct agregat *agg;
+    int g;
+
+    if (hash) {
+        t->hash = hash;
+    }
+    baris = realloc(t->baris, (size_t)kap * sizeof(int));
+    if (baris) {
+        t->baris = baris;
+    }
+    agg = realloc(t->agg, (size_t)kap * (size_t)t->spek->jumlah_nilai * sizeof(*agg));
+    if (agg) {
+        t->agg = agg;
+    }
+    if (!slot || !hash || !baris || !agg) {
+        free(slot);
+        return -1;
+    }
+
+    for (i = 0; i < slot_baru; i++) {
+        slot[i] = -1;
+    }
+    for (g = 0; g < t->n; g++) {
+        unsigned int s = t->hash[g] & (slot_baru - 1);
+        while (slot[s] >= 0) {
+            s = (s + 1) & (slot_baru - 1);
+        }
+        slot[s] = g;
+    }
+    free(t->slot);
+    t->slot = slot;
+    t->mask = slot_baru - 1;
+    t->kapasitas = kap;
+    return 0;
+}
+
+/* Cari grup untuk kunci baris r (hash h); buat grup baru jika belum ada */
+static int cari_grup(struct tabel_grup *t, int r, unsigned int h)
+{
+    unsigned int s;
+    int g, v;
+
+    if (t->n >= t->kapasitas && tumbuh_tabel_grup(t) != 0) {
+        return -1;
+    }
+    s = h & t->mask;
+    while ((g = t->slot[s]) >= 0) {
+        if (t->hash[g] == h && kunci_pivot_sama(t->spek, t->baris[g], r)) {
+            return g;
+        }
+        s = (s + 1) & t->mask;
+    }
+    g = t->n++;
+    t->slot[s] = g;
+    t->hash[g] = h;
+    t->baris[g] = r;
+    for (v = 0; v < t->spek->jumlah_nilai; v++) {
+        struct agregat *a = &t->agg[g * t->spek->jumlah_nilai + v];
+        a->jumlah = 0.0;
+        a->min = 0.0;
+        a->max = 0.0;
+        a->isi = 0;
+        a->angka = 0;
+    }
+    return g;
+}
+
+static void gabung_agregat(struct agregat *a, const struct agregat *b)
+{
+    if (b->angka > 0) {
+        if (a->angka == 0 || b->min < a->min) {
+            a->min = b->min;
+        }
+        if (a->angka == 0 || b->max > a->max) {
+            a->max = b->max;
+        }
+    }
+    a->jumlah += b->jumlah;
+    a->isi += b->isi;
+    a->angka += b->angka;
+}
+
+static void *thread_pivot(void *arg)
+{
+    struct tugas_pivot *tp = arg;
+    struct tabel_grup *t = &tp->tabel;
+    const struct spesifikasi_pivot *spek = t->spek;
+    int r, k, v;
+
+    for (r = tp->awal; r < tp->akhir; r = baris_berikut(r)) {
+        int g, kosong = 1;
+        for (k = 0; k < spek->jumlah_kunci; k++) {
+            if (isi[r][spek->kunci[k]][0] != '\0') {
+                kosong = 0;
+                break;
+            }
+        }
+        if (kosong) {
+            continue;
+        }
+        g = cari_grup(t, r, hash_kunci_pivot(spek, r));
+        if (g < 0) {
+            tp->gagal = 1;
+            return NULL;
+        }
+        for (v = 0; v < spek->jumlah_nilai; v++) {
+            const char *teks = isi[r][spek->kolom_nilai[v]];
+            struct agregat *a = &t->agg[g * spek->jumlah_nilai + v];
+            char *akhir;
+            double x;
+            if (teks[0] == '\0') {
+                continue;
+            }
+            a->isi++;
+            x = strtod(teks, &akhir);
+            if (akhir == teks) {
+                continue;
+            }
+            if (a->angka == 0 || x < a->min) {
+                a->min = x;
+            }
+            if (a->angka == 0 || x > a->max) {
+                a->max = x;
+            }
+            a->jumlah += x;
+            a->angka++;
+        }
+    }
+    return NULL;
+}
+
+static const char *nama_agregat(enum fungsi_agregat f)
+{
+    static const char *nama[] = { "SUM", "COUNT", "AVG", "MIN", "MAX" };
+    return nama[f];
+}
+
+static void format_agregat(const struct agregat *a, enum fungsi_agregat f,
+                           char *out, size_t ukuran)
+{
+    if (f == AGG_COUNT) {
+        snprintf(out, ukuran, "%d", a->isi);
+    } else if (f == AGG_SUM) {
+        snprintf(out, ukuran, "%.2f", a->jumlah);
+    } else if (a->angka == 0) {
+        out[0] = '\0';
+    } else if (f == AGG_AVG) {
+        snprintf(out, ukuran, "%.2f", a->jumlah / a->angka);
+    } else {
+        snprintf(out, ukuran, "%.2f", f == AGG_MIN ? a->min : a->max);
+    }
+}
+
+/* Urutkan grup menurut baris kemunculan pertama */
+static int bandingkan_grup_baris(const void *a, const void *b)
+{
+    const int *ga = a, *gb = b;
+    return ga[1] - gb[1];
+}
+
+/* Kelompokkan baris seleksi (atau seluruh sheet) menurut kolom kunci dan
+ * tulis ringkasan agregat ke wilayah mulai (tx, ty) sebagai satu langkah
+ * undo. Di atas AMBANG_PIVOT_PARALEL baris dibagi ke beberapa thread
+ * yang masing-masing punya tabel parsial, lalu digabung di akhir. */
+static int aksi_pivot(struct konfigurasi *cfg, const struct spesifikasi_pivot *spek,
+                      int tx, int ty)
+{
+    struct tugas_pivot tugas[MAKS_THREAD_PIVOT];
+    pthread_t th[MAKS_THREAD_PIVOT];
+    int dijalankan[MAKS_THREAD_PIVOT];
+    struct tabel_grup *hasil;
+    struct potret_area *potret;
+    const char **label;
+    int y1 = 0, y2 = cfg->baris - 1;
+    int jumlah = 1, i, g, k, v, lebar, tinggi, ditulis, gagal = 0;
+    int *urutan;
+    long cpu = sysconf(_SC_NPROCESSORS_ONLN);
+    char teks[MAX_TEXT];
+
+    if (selecting) {
+        y1 = sel_anchor_y < cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+        y2 = sel_anchor_y > cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+    }
+    lebar = spek->jumlah_kunci + spek->jumlah_nilai;
+    if (tx < 0 || tx + lebar > cfg->kolom || ty < 0 || ty >= cfg->baris) {
+        snprintf(status_msg, sizeof(status_msg), "Wilayah tujuan pivot tidak muat");
+        return -1;
+    }
+
+    if (y2 - y1 + 1 >= AMBANG_PIVOT_PARALEL && cpu > 1) {
+        jumlah = cpu > MAKS_THREAD_PIVOT ? MAKS_THREAD_PIVOT : (int)cpu;
+    }
+    for (i = 0; i < jumlah; i++) {
+        memset(&tugas[i], 0, sizeof(tugas[i]));
+        tugas[i].tabel.spek = spek;
+        tugas[i].awal = baris_terlihat_dari(y1 + (int)((long)(y2 - y1 + 1) * i / jumlah));
+        tugas[i].akhir = y1 + (int)((long)(y2 - y1 + 1) * (i + 1) / jumlah);
+        dijalankan[i] = 0;
+        if (i > 0 && pthread_create(&th[i], NULL, thread_pivot, &tugas[i]) == 0) {
+            dijalankan[i] = 1;
+        }
+    }
+    for (i = 0; i < jumlah; i++) {
+        if (!dijalankan[i]) {
+            thread_pivot(&tugas[i]);
+        }
+    }
+    for (i = 0; i < jumlah; i++) {
+        if (dijalankan[i]) {
+            pthread_join(th[i], NULL);
+        }
+        gagal |= tugas[i].gagal;
+    }
+
+    /* Gabungkan tabel parsial ke tabel thread pertama */
+    hasil = &tugas[0].tabel;
+    for (i = 1; i < jumlah && !gagal; i++) {
+        struct tabel_grup *t = &tugas[i].tabel;
+        for (g = 0; g < t->n; g++) {
+            int tujuan = cari_grup(hasil, t->baris[g], t->hash[g]);
+            if (tujuan < 0) {
+                gagal = 1;
+                break;
+            }
+            for (v = 0; v < spek->jumlah_nilai; v++) {
+                gabung_agregat(&hasil->agg[tujuan * spek->jumlah_nilai + v],
+                               &t->agg[g * spek->jumlah_nilai + v]);
+            }
+        }
+    }
+    for (i = 1; i < jumlah; i++) {
+        bebaskan_tabel_grup(&tugas[i].tabel);
+    }
+
+    urutan = gagal ? NULL : malloc((size_t)(hasil->n > 0 ? hasil->n : 1) * 2 * sizeof(int));
+    if (!urutan) {
+        bebaskan_tabel_grup(hasil);
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk pivot");
+        return -1;
+    }
+    for (g = 0; g < hasil->n; g++) {
+        urutan[g * 2] = g;
+        urutan[g * 2 + 1] = hasil->baris[g];
+    }
+    qsort(urutan, (size_t)hasil->n, 2 * sizeof(int), bandingkan_grup_baris);
+
+    /* Wilayah tujuan dipotret sekali sebagai satu op undo, sehingga
+     * pivot sebesar apa pun tidak menghabiskan slot undo per sel */
+    tinggi = hasil->n + 1;
+    if (ty + tinggi > cfg->baris) {
+        tinggi = cfg->baris - ty;
+    }
+    potret = buat_potret(tx, tx + lebar - 1);
+    for (i = 0; potret && i < tinggi; i++) {
+        if (potret_baris(potret, ty + i) != 0) {
+            buang_potret(potret);
+            potret = NULL;
+        }
+    }
+    /* Label grup diambil dari baris sumber sebelum apa pun ditulis,
+     * karena wilayah tujuan boleh menimpa baris data. Tiap label
+     * memegang satu referensi pool selama penulisan */
+    label = potret ? malloc((size_t)tinggi * (size_t)spek->jumlah_kunci * sizeof(*label)) : NULL;
+    if (!label) {
+        if (potret) {
+            buang_potret(potret);
+            snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk pivot");
+        }
+        free(urutan);
+        bebaskan_tabel_grup(hasil);
+        return -1;
+    }
+    for (g = 0; g < tinggi - 1; g++) {
+        int r = hasil->baris[urutan[g * 2]];
+        for (k = 0; k < spek->jumlah_kunci; k++) {
+            const char *t = isi[r][spek->kunci[k]];
+            if (t[0] != '\0') {
+                ENTRI_INTERN(t)->ref++;
+            }
+            label[g * spek->jumlah_kunci + k] = t;
+        }
+    }
+
+    /* Tulis header + satu baris per grup */
+    for (k = 0; k < spek->jumlah_kunci; k++) {
+        snprintf(teks, sizeof(teks), "%c", 'A' + spek->kunci[k]);
+        set_cell_text(cfg, tx + k, ty, teks, 0);
+    }
+    for (v = 0; v < spek->jumlah_nilai; v++) {
+        snprintf(teks, sizeof(teks), "%s(%c)", nama_agregat(spek->fungsi[v]),
+                 'A' + spek->kolom_nilai[v]);
+        set_cell_text(cfg, tx + spek->jumlah_kunci + v, ty, teks, 0);
+    }
+    for (ditulis = 0; ditulis < tinggi - 1; ditulis++) {
+        int gi = urutan[ditulis * 2];
+        for (k = 0; k < spek->jumlah_kunci; k++) {
+            set_cell_text(cfg, tx + k, ty + 1 + ditulis,
+                          label[ditulis * spek->jumlah_kunci + k], 0);
+        }
+        for (v = 0; v < spek->jumlah_nilai; v++) {
+            format_agregat(&hasil->agg[gi * spek->jumlah_nilai + v],
+                           spek->fungsi[v], teks, sizeof(teks));
+            set_cell_text(cfg, tx + spek->jumlah_kunci + v, ty + 1 + ditulis, teks, 0);
+        }
+    }
+    push_undo_area(potret);
+    for (i = 0; i < (tinggi - 1) * spek->jumlah_kunci; i++) {
+        lepas_intern(label[i]);
+    }
+    free(label);
+
+    if (ditulis < hasil->n) {
+        snprintf(status_msg, sizeof(status_msg), "Pivot: %d dari %d grup ditulis",
+                 ditulis, hasil->n);
+    } else {
+        snprintf(status_msg, sizeof(status_msg), "Pivot: %d grup di %c%d",
+                 hasil->n, 'A' + tx, ty + 1);
+    }
+    free(urutan);
+    bebaskan_tabel_grup(hasil);
+    return 0;
+}
+
+/* ============================================================
+ * Fungsi Workbook
+ * ============================================================ */
+/* Satu file memuat beberapa sheet jika baris pertamanya penanda ini;
+ * tiap sheet diawali satu baris penanda berisi namanya */
+#define PENANDA_SHEET "#SHEET "
+
+/* Op undo menyimpan indeks sheet, jadi dibuang saat indeks bergeser */
+static void kosongkan_undo(void)
+{
+    while (undo_top > 0) {
+        buang_op(&undo_stack[--undo_top]);
+    }
+    buang_redo();
+}
+
+/* Buang semua sheet selain sheet aktif, yang lalu menjadi sheet 1 */
+static void sisakan_sheet_aktif(struct konfigurasi *cfg)
+{
+    struct sheet *tetap = sheet[sheet_aktif];
+    int s;
+
+    if (jumlah_sheet <= 1) {
+        return;
+    }
+    if (file_pantau[0] && sheet[sheet_pantau] != tetap) {
+        file_pantau[0] = '\0';
+    }
+    for (s = jumlah_sheet - 1; s >= 0; s--) {
+        if (sheet[s] != tetap) {
+            buang_sheet(s);
+        }
+    }
+    sheet_pantau = 0;
+    kosongkan_undo();
+    aktifkan_sheet(cfg, 0);
+}
+
+static int hapus_sheet_aktif(struct konfigurasi *cfg)
+{
+    int s = sheet_aktif;
+
+    if (jumlah_sheet <= 1) {
+        snprintf(status_msg, sizeof(status_msg), "Sheet terakhir tidak bisa dihapus");
+        return -1;
+    }
+    if (file_pantau[0]) {
+        if (sheet_pantau == s) {
+            file_pantau[0] = '\0';
+        } else if (sheet_pantau > s) {
+            sheet_pantau--;
+        }
+    }
+    buang_sheet(s);
+    kosongkan_undo();
+    aktifkan_sheet(cfg, s < jumlah_sheet ? s : s - 1);
+    return 0;
+}
+
+/* Tulis semua sheet berurutan, masing-masing diawali penanda. Sheet
+ * hanya dipasang (pointer sel), tidak diaktifkan: seleksi, indeks,
+ * cache tata letak dan filter tidak tersentuh. cfg milik sheet aktif;
+ * sheet lain memakai cfg yang tersimpan */
+static void tulis_workbook(FILE *file, const struct konfigurasi *cfg,
+                           void (*tulis)(FILE *, const struct konfigurasi *, int))
+{
+    int asal = sheet_aktif, s;
+
+    for (s = 0; s < jumlah_sheet; s++) {
+        pasang_sheet(s);
+        fprintf(file, PENANDA_SHEET "%s\n", sheet[s]->nama);
+        tulis(file, s == asal ? cfg : &sheet[s]->cfg, 0);
+    }
+    pasang_sheet(asal);
+}
+
+/* ============================================================
+ * Fungsi Command Line
+ * ============================================================ */
+static int evaluasi_formula(const struct konfigurasi *cfg, const char *formula,
+                            double *hasil)
+{
+    /* Implementasi sederhana untuk evaluasi formula */
+    /* Contoh: :SUM A1-A8 atau :AVG A1-D4 */
+    char formula_copy[MAX_FORMULA_LENGTH];
+    char *token;
+    char fungsi[16];
+    int x1, y1, x2, y2;
+    double total = 0.0;
+    int count = 0;
+    int y;
+
+    if (formula[0] != ':') {
+        return -1;
+    }
+
+    strncpy(formula_copy, formula, MAX_FORMULA_LENGTH - 1);
+    formula_copy[MAX_FORMULA_LENGTH - 1] = '\0';
+
+    token = strtok(formula_copy + 1, " ");
+    if (!token) {
+        return -1;
+    }
+
+    strncpy(fungsi, token, sizeof(fungsi) - 1);
+    fungsi[sizeof(fungsi) - 1] = '\0';
+
+    token = strtok(NULL, " ");
+    if (!token) {
+        return -1;
+    }
+
+    /* Parse koordinat pertama; sel di luar sheet ditolak */
+    if (parse_sel(cfg, token, &x1, &y1) != 0) {
+        return -1;
+    }
+
+    token = strtok(NULL, " ");
+    if (!token) {
+        /* Hanya satu sel */
+        if (isi[y1][x1][0] != '\0') {
+            *hasil = atof(isi[y1][x1]);
+        } else {
+            *hasil = 0.0;
+        }
+        return 0;
+    }
+
+    /* Parse koordinat kedua */
+    if (parse_sel(cfg, token, &x2, &y2) != 0) {
+        return -1;
+    }
+
+    /* Hitung berdasarkan fungsi */
+    for (y = y1; y <= y2; y++) {
+        int x;
+        for (x = x1; x <= x2; x++) {
+            if (isi[y][x][0] != '\0') {
+                total += atof(isi[y][x]);
+                count++;
+            }
+        }
+    }
+
+    if (strcmp(fungsi, "SUM") == 0) {
+        *hasil = total;
+    } else if (strcmp(fungsi, "AVG") == 0) {
+        *hasil = count > 0 ? total / count : 0.0;
+    } else if (strcmp(fungsi, "COUNT") == 0) {
+        *hasil = count;
+    } else if (strcmp(fungsi, "MAX") == 0) {
+        double max = 0.0;
+        int first = 1;
+        for (y = y1; y <= y2; y++) {
+            int x;
+            for (x = x1; x <= x2; x++) {
+                if (isi[y][x][0] != '\0') {
+                    double val = atof(isi[y][x]);
+                    if (first || val > max) {
+                        max = val;
+                        first = 0;
+                    }
+                }
+            }
+        }
+        *hasil = first ? 0.0 : max;
+    } else if (strcmp(fungsi, "MIN") == 0) {
+        double min = 0.0;
+        int first = 1;
+        for (y = y1; y <= y2; y++) {
+            int x;
+            for (x = x1; x <= x2; x++) {
+                if (isi[y][x][0] != '\0') {
+                    double val = atof(isi[y][x]);
+                    if (first || val < min) {
+                        min = val;
+                        first = 0;
+                    }
+                }
+            }
+        }
+        *hasil = first ? 0.0 : min;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Parse referensi sel seperti "B12" menjadi (x, y) berbasis nol */
+static int parse_sel(const struct konfigurasi *cfg, const char *token,
+                     int *x, int *y)
+{
+    const char *p = token + 1;
+    if (token[0] < 'A' || token[0] > 'Z' || *p == '\0') {
+        return -1;
+    }
+    while (*p) {
+        if (*p < '0' || *p > '9') {
+            return -1;
+        }
+        p++;
+    }
+    *x = token[0] - 'A';
+    *y = atoi(token + 1) - 1;
+    if (*x >= cfg->kolom || *y < 0 || *y >= cfg->baris) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Ambil token berikutnya; token berkutip boleh mengandung spasi */
+static int ambil_token(const char **p, char *out, size_t ukuran, int *berkutip)
+{
+    const char *s = *p;
+    size_t n = 0;
+
+    while (*s == ' ') {
+        s++;
+    }
+    if (*s == '\0') {
+        *p = s;
+        return -1;
+    }
+    *berkutip = (*s == '"');
+    if (*berkutip) {
+        s++;
+        while (*s && *s != '"') {
+            if (n < ukuran - 1) {
+                out[n++] = *s;
+            }
+            s++;
+        }
+        if (*s == '"') {
+            s++;
+        }
+    } else {
+        while (*s && *s != ' ') {
+            if (n < ukuran - 1) {
+                out[n++] = *s;
+            }
+            s++;
+        }
+    }
+    out[n] = '\0';
+    *p = s;
+    return 0;
+}
+
+/* Evaluasi fungsi lookup berbasis indeks hash kolom:
+ *   :VLOOKUP kunci A1 C50 3
+ *   :MATCH   kunci A1 A50
+ *   :XLOOKUP kunci A1 A50 C1 C50
+ * Kunci berupa referensi sel, teks biasa, atau teks "berkutip".
+ * Kembali 0 jika berhasil, 1 jika bukan fungsi lookup,
+ * -2 jika kunci tidak ditemukan, -1 jika formula tidak valid. */
+static int evaluasi_lookup(const struct konfigurasi *cfg, const char *formula,
+                           char *hasil, size_t ukuran)
+{
+    char fungsi[16], kunci[MAX_TEXT], token[32];
+    const char *p;
+    int berkutip, kx, ky;
+    int x1, y1, x2, y2, rx1, ry1, rx2, ry2, y;
+
+    if (formula[0] != ':') {
+        return 1;
+    }
+    p = formula + 1;
+    if (ambil_token(&p, fungsi, sizeof(fungsi), &berkutip) != 0) {
+        return 1;
+    }
+    if (strcmp(fungsi, "VLOOKUP") != 0 && strcmp(fungsi, "MATCH") != 0 &&
+        strcmp(fungsi, "XLOOKUP") != 0) {
+        return 1;
+    }
+
+    if (ambil_token(&p, kunci, sizeof(kunci), &berkutip) != 0) {
+        return -1;
+    }
+    if (!berkutip && parse_sel(cfg, kunci, &kx, &ky) == 0) {
+        strncpy(kunci, isi[ky][kx], MAX_TEXT - 1);
+        kunci[MAX_TEXT - 1] = '\0';
+    }
+
+    if (ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+        parse_sel(cfg, token, &x1, &y1) != 0) {
+        return -1;
+    }
+    if (ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+        parse_sel(cfg, token, &x2, &y2) != 0 || x2 < x1 || y2 < y1) {
+        return -1;
+    }
+
+    y = cari_di_indeks(cfg, x1, y1, y2, kunci);
+
+    if (strcmp(fungsi, "MATCH") == 0) {
+        if (y < 0) {
+            return -2;
+        }
+        snprintf(hasil, ukuran, "%d", y - y1 + 1);
+        return 0;
+    }
+
+    if (strcmp(fungsi, "VLOOKUP") == 0) {
+        int indeks_kolom;
+        if (ambil_token(&p, token, sizeof(token), &berkutip) != 0) {
+            return -1;
+        }
+        indeks_kolom = atoi(token);
+        if (indeks_kolom < 1 || indeks_kolom > x2 - x1 + 1) {
+            return -1;
+        }
+        if (y < 0) {
+            return -2;
+        }
+        snprintf(hasil, ukuran, "%s", isi[y][x1 + indeks_kolom - 1]);
+        return 0;
+    }
+
+    /* XLOOKUP: rentang hasil sejajar dengan rentang pencarian */
+    if (ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+        parse_sel(cfg, token, &rx1, &ry1) != 0) {
+        return -1;
+    }
+    if (ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+        parse_sel(cfg, token, &rx2, &ry2) != 0 ||
+        rx1 != rx2 || ry2 - ry1 != y2 - y1) {
+        return -1;
+    }
+    if (y < 0) {
+        return -2;
+    }
+    snprintf(hasil, ukuran, "%s", isi[ry1 + (y - y1)][rx1]);
+    return 0;
+}
+
+/* Parse ":PIVOT A B SUM C AVG D [KE H1]" */
+static int parse_pivot(const struct konfigurasi *cfg, const char *arg,
+                       struct spesifikasi_pivot *spek, int *tx, int *ty)
+{
+    static const char *nama[] = { "SUM", "COUNT", "AVG", "MIN", "MAX" };
+    char token[32];
+    const char *p = arg;
+    int berkutip, f, x, y;
+
+    spek->jumlah_kunci = 0;
+    spek->jumlah_nilai = 0;
+    *tx = -1;
+    *ty = 0;
+    while (ambil_token(&p, token, sizeof(token), &berkutip) == 0) {
+        if (strcmp(token, "KE") == 0) {
+            if (ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+                parse_sel(cfg, token, tx, ty) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        for (f = 0; f < 5; f++) {
+            if (strcmp(token, nama[f]) == 0) {
+                break;
+            }
+        }
+        if (f < 5) {
+            if (spek->jumlah_nilai >= MAKS_NILAI_PIVOT ||
+                ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+                token[0] < 'A' || token[0] - 'A' >= cfg->kolom || token[1] != '\0') {
+                return -1;
+            }
+            spek->fungsi[spek->jumlah_nilai] = (enum fungsi_agregat)f;
+            spek->kolom_nilai[spek->jumlah_nilai++] = token[0] - 'A';
+        } else if (token[0] >= 'A' && token[0] - 'A' < cfg->kolom && token[1] == '\0' &&
+                   spek->jumlah_nilai == 0 && spek->jumlah_kunci < MAKS_KUNCI_PIVOT) {
+            spek->kunci[spek->jumlah_kunci++] = token[0] - 'A';
+        } else {
+            return -1;
+        }
+    }
+    if (spek->jumlah_kunci == 0 || spek->jumlah_nilai == 0) {
+        return -1;
+    }
+
+    /* Tujuan bawaan: kolom kosong pertama di kanan data */
+    if (*tx < 0) {
+        *tx = 0;
+        for (y = 0; y < cfg->baris; y++) {
+            for (x = cfg->kolom - 1; x >= *tx; x--) {
+                if (isi[y][x][0] != '\0') {
+                    *tx = x + 2;
+                    break;
+                }
+            }
+        }
+        *ty = 0;
+    }
+    return 0;
+}
+
+/* Tambah predikat auto-filter dari argumen ":FILTER B = teks",
+ * ":FILTER B ~ teks", ":FILTER B 10 20"; ":FILTER" atau ":FILTER OFF"
+ * menghapus semua filter */
+static int aksi_filter(struct konfigurasi *cfg, const char *arg)
+{
+    struct predikat_filter *pf;
+    char token[MAX_TEXT], token2[64];
+    char *akhir;
+    const char *p = arg;
+    int berkutip, terlihat;
+
+    if (ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+        strcmp(token, "OFF") == 0) {
+        hapus_filter();
+        snprintf(status_msg, sizeof(status_msg), "Filter dihapus");
+        return 0;
+    }
+    if (jumlah_predikat >= MAKS_PREDIKAT_FILTER || token[0] < 'A' ||
+        token[0] - 'A' >= cfg->kolom || token[1] != '\0') {
+        snprintf(status_msg, sizeof(status_msg), "Perintah FILTER tidak valid");
+        return -1;
+    }
+    pf = &predikat_filter[jumlah_predikat];
+    pf->kolom = token[0] - 'A';
+
+    if (ambil_token(&p, token, sizeof(token), &berkutip) != 0) {
+        snprintf(status_msg, sizeof(status_msg), "Perintah FILTER tidak valid");
+        return -1;
+    }
+    if (!berkutip && (strcmp(token, "=") == 0 || strcmp(token, "~") == 0)) {
+        pf->jenis = token[0] == '=' ? FILTER_SAMA : FILTER_MEMUAT;
+        if (ambil_token(&p, pf->teks, sizeof(pf->teks), &berkutip) != 0) {
+            pf->teks[0] = '\0';
+        }
+    } else {
+        pf->jenis = FILTER_RENTANG;
+        pf->min = strtod(token, &akhir);
+        if (akhir == token || *akhir != '\0' ||
+            ambil_token(&p, token2, sizeof(token2), &berkutip) != 0) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah FILTER tidak valid");
+            return -1;
+        }
+        pf->max = strtod(token2, &akhir);
+        if (akhir == token2 || *akhir != '\0') {
+            snprintf(status_msg, sizeof(status_msg), "Perintah FILTER tidak valid");
+            return -1;
+        }
+    }
+
+    jumlah_predikat++;
+    filter_baris = cfg->baris;
+    terlihat = evaluasi_filter();
+    if (terlihat == 0) {
+        jumlah_predikat--;
+        evaluasi_filter();
+        snprintf(status_msg, sizeof(status_msg), "Tidak ada baris yang cocok");
+        return -1;
+    }
+
+    cfg->view_row = baris_terlihat_dari(cfg->view_row);
+    if (cfg->view_row >= cfg->baris) {
+        cfg->view_row = baris_terlihat_sampai(cfg->baris - 1);
+    }
+    ensure_active_visible(cfg);
+    snprintf(status_msg, sizeof(status_msg), "Filter: %d dari %d baris",
+             terlihat, cfg->baris);
+    return 0;
+}
+
+/* Kelola sheet workbook: ":SHEET" menampilkan sheet aktif, ":SHEET BARU
+ * nama", ":SHEET HAPUS", ":SHEET NAMA nama", ":SHEET 2" atau ":SHEET nama"
+ * untuk berpindah */
+static int aksi_sheet(struct konfigurasi *cfg, const char *arg)
+{
+    char token[MAX_TEXT], nama[MAKS_NAMA_SHEET];
+    const char *p = arg;
+    int berkutip, s;
+
+    if (ambil_token(&p, token, sizeof(token), &berkutip) != 0) {
+        snprintf(status_msg, sizeof(status_msg), "Sheet %d/%d: %s",
+                 sheet_aktif + 1, jumlah_sheet, sheet[sheet_aktif]->nama);
+        return 0;
+    }
+    if (!berkutip && strcmp(token, "NAMA") == 0) {
+        if (ambil_token(&p, nama, sizeof(nama), &berkutip) != 0) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah SHEET tidak valid");
+            return -1;
+        }
+        snprintf(sheet[sheet_aktif]->nama, sizeof(sheet[0]->nama), "%s", nama);
+        minta_frame(FRAME_PENUH);
+        snprintf(status_msg, sizeof(status_msg), "Sheet %d: %s", sheet_aktif + 1, nama);
+        return 0;
+    }
+    if (tail_fd >= 0) {
+        snprintf(status_msg, sizeof(status_msg), "Sheet tidak bisa diganti saat mengikuti file");
+        return -1;
+    }
+    if (!berkutip && strcmp(token, "BARU") == 0) {
+        if (ambil_token(&p, nama, sizeof(nama), &berkutip) != 0) {
+            snprintf(nama, sizeof(nama), "Sheet%d", jumlah_sheet + 1);
+        }
+        s = buat_sheet(nama, cfg->kolom, cfg->baris);
+        if (s < 0) {
+            return -1;
+        }
+    } else if (!berkutip && strcmp(token, "HAPUS") == 0) {
+        return hapus_sheet_aktif(cfg);
+    } else {
+        s = berkutip ? 0 : atoi(token);
+        if (s >= 1 && s <= jumlah_sheet) {
+            s--;
+        } else {
+            for (s = 0; s < jumlah_sheet; s++) {
+                if (strcmp(sheet[s]->nama, token) == 0) {
+                    break;
+                }
+            }
+            if (s == jumlah_sheet) {
+                snprintf(status_msg, sizeof(status_msg), "Sheet tidak ditemukan: %.*s",
+                         MAKS_NAMA_STATUS, token);
+                return -1;
+            }
+        }
+    }
+    pindah_sheet(cfg, s);
+    snprintf(status_msg, sizeof(status_msg), "Sheet %d/%d: %s",
+             sheet_aktif + 1, jumlah_sheet, sheet[sheet_aktif]->nama);
+    return 0;
+}
+
+/* Pindah ke sheet berikut (arah 1) atau sebelumnya (arah -1), memutar */
+static void geser_sheet(struct konfigurasi *cfg, int arah)
+{
+    if (jumlah_sheet <= 1) {
+        snprintf(status_msg, sizeof(status_msg), "Hanya ada satu sheet (:SHEET BARU)");
+        return;
+    }
+    if (tail_fd >= 0) {
+        snprintf(status_msg, sizeof(status_msg), "Sheet tidak bisa diganti saat mengikuti file");
+        return;
+    }
+    pindah_sheet(cfg, (sheet_aktif + arah + jumlah_sheet) % jumlah_sheet);
+    snprintf(status_msg, sizeof(status_msg), "Sheet %d/%d: %s",
+             sheet_aktif + 1, jumlah_sheet, sheet[sheet_aktif]->nama);
+}
+
+/* Bagian gaya yang diubah :GAYA */
+#define UBAH_ALIGN   1
+#define UBAH_DESIMAL 2
+#define UBAH_WARNA   4
+#define UBAH_TEBAL   8
+
+static const struct {
+    const char *nama;
+    int rgb;
+} warna_gaya[] = {
+    { "MERAH", 0xD03030 }, { "HIJAU", 0x30B030 }, { "BIRU", 0x4070E0 },
+    { "KUNING", 0xD0C020 }, { "CYAN", 0x20C0D0 }, { "MAGENTA", 0xC040C0 },
+    { "ABU", 0x969696 }, { "PUTIH", 0xFFFFFF }
+};
+
+/* Ubah bagian `ubah` gaya baris y1..y2 kolom x menjadi nilai di `g`,
+ * bagian lain tiap run dipertahankan. Satu op undo per kolom */
+static int ubah_gaya_kolom(int x, int y1, int y2, const struct gaya *g, int ubah)
+{
+    struct kolom_gaya *k = &gaya_kolom[x], lama;
+    struct run_gaya *tengah = malloc((size_t)(k->jumlah + 1) * sizeof(*tengah));
+    int y = y1, n = 0;
+
+    if (!tengah) {
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk gaya");
+        return -1;
+    }
+    while (y <= y2) {
+        int i = k->jumlah > 0 ? cari_run(k, y) : 0;
+        int akhir = i + 1 < k->jumlah ? k->run[i + 1].awal - 1 : y2;
+        struct gaya baru = tabel_gaya[k->jumlah > 0 ? k->run[i].gaya : 0];
+        int indeks;
+
+        if (ubah & UBAH_ALIGN) {
+            baru.align = g->align;
+        }
+        if (ubah & UBAH_DESIMAL) {
+            baru.desimal = g->desimal;
+        }
+        if (ubah & UBAH_WARNA) {
+            baru.warna = g->warna;
+        }
+        if (ubah & UBAH_TEBAL) {
+            baru.tebal = g->tebal;
+        }
+        indeks = cari_gaya(&baru);
+        if (indeks < 0) {
+            free(tengah);
+            return -1;
+        }
+        dorong_run(tengah, &n, y, indeks);
+        y = (akhir < y2 ? akhir : y2) + 1;
+    }
+    if (sambung_run(k, y1, y2, tengah, n, &lama) != 0) {
+        free(tengah);
+        return -1;
+    }
+    free(tengah);
+    push_undo_gaya(x, y1, &lama);
+    return 0;
+}
+
+/* Format seleksi atau sel aktif: ":GAYA KANAN TEBAL", ":GAYA ANGKA 2",
+ * ":GAYA WARNA MERAH" / "#rrggbb" / OFF, ":GAYA RESET". KOLOM memformat
+ * seluruh baris kolom yang terpilih, cukup satu run per kolom */
+static int aksi_gaya(struct konfigurasi *cfg, const char *arg)
+{
+    struct gaya g = tabel_gaya[0];
+    char token[32];
+    const char *p = arg;
+    int berkutip, ubah = 0, x, x1, x2, y1, y2, i;
+    int kolom_penuh = 0, salah = 0;
+
+    while (ambil_token(&p, token, sizeof(token), &berkutip) == 0) {
+        if (strcmp(token, "KOLOM") == 0) {
+            kolom_penuh = 1;
+        } else if (strcmp(token, "KIRI") == 0 || strcmp(token, "TENGAH") == 0 ||
+                   strcmp(token, "KANAN") == 0) {
+            g.align = token[1] == 'I' ? LEFT : token[1] == 'E' ? CENTER : RIGHT;
+            ubah |= UBAH_ALIGN;
+        } else if (strcmp(token, "TEBAL") == 0 || strcmp(token, "TIPIS") == 0) {
+            g.tebal = (token[1] == 'E');
+            ubah |= UBAH_TEBAL;
+        } else if (strcmp(token, "RESET") == 0) {
+            g = tabel_gaya[0];
+            ubah = UBAH_ALIGN | UBAH_DESIMAL | UBAH_WARNA | UBAH_TEBAL;
+        } else if (strcmp(token, "ANGKA") == 0 &&
+                   ambil_token(&p, token, sizeof(token), &berkutip) == 0) {
+            if (strcmp(token, "OFF") == 0) {
+                g.desimal = -1;
+            } else if (token[0] >= '0' && token[0] <= '9' && token[1] == '\0') {
+                g.desimal = token[0] - '0';
+            } else {
+                salah = 1;
+                break;
+            }
+            ubah |= UBAH_DESIMAL;
+        } else if (strcmp(token, "WARNA") == 0 &&
+                   ambil_token(&p, token, sizeof(token), &berkutip) == 0) {
+            g.warna = -2;
+            if (strcmp(token, "OFF") == 0) {
+                g.warna = -1;
+            } else if (token[0] == '#' && strlen(token) == 7 &&
+                       strspn(token + 1, "0123456789abcdefABCDEF") == 6) {
+                g.warna = (int)strtol(token + 1, NULL, 16);
+            }
+            for (i = 0; i < (int)(sizeof(warna_gaya) / sizeof(warna_gaya[0])); i++) {
+                if (strcmp(token, warna_gaya[i].nama) == 0) {
+                    g.warna = warna_gaya[i].rgb;
+                }
+            }
+            if (g.warna == -2) {
+                salah = 1;
+                break;
+            }
+            ubah |= UBAH_WARNA;
+        } else {
+            salah = 1;
+            break;
+        }
+    }
+    if (salah || ubah == 0) {
+        snprintf(status_msg, sizeof(status_msg), "Perintah GAYA tidak valid");
+        return -1;
+    }
+
+    if (selecting && sel_anchor_x >= 0) {
+        x1 = sel_anchor_x < cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+        x2 = sel_anchor_x > cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+        y1 = sel_anchor_y < cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+        y2 = sel_anchor_y > cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+    } else {
+        x1 = x2 = cfg->aktif_x;
+        y1 = y2 = cfg->aktif_y;
+    }
+    if (kolom_penuh) {
+        y1 = 0;
+        y2 = MAKS_BARIS - 1;
+    }
+
+    mulai_transaksi();
+    for (x = x1; x <= x2; x++) {
+        if (ubah_gaya_kolom(x, y1, y2, &g, ubah) != 0) {
+            break;
+        }
+    }
+    akhiri_transaksi();
+    tampil_valid = 0;
+    minta_frame(FRAME_PENUH);
+    if (x <= x2) {
+        return -1;
+    }
+    if (kolom_penuh) {
+        snprintf(status_msg, sizeof(status_msg), "Gaya kolom %c-%c diubah", 'A' + x1, 'A' + x2);
+    } else {
+        snprintf(status_msg, sizeof(status_msg), "Gaya %c%d - %c%d diubah",
+                 'A' + x1, y1 + 1, 'A' + x2, y2 + 1);
+    }
+    return 0;
+}
+
+/* Jalankan satu baris command line: perintah (SORT) atau formula yang
+ * hasilnya ditulis ke sel aktif */
+static int jalankan_command_line(struct konfigurasi *cfg, const char *buf)
+{
+    double hasil, t0;
+    char teks[MAX_TEXT];
+    int st, kolom;
+
+    hasil_di_sel_aktif = 0;
+
+    if (strncmp(buf, ":SORT", 5) == 0 && (buf[5] == ' ' || buf[5] == '\0')) {
+        struct kunci_sort kunci[MAKS_KUNCI_SORT];
+        int n = parse_kunci_sort(buf + 5, kunci, MAKS_KUNCI_SORT);
+        if (n <= 0) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah SORT tidak valid");
+            return -1;
+        }
+        return aksi_sort(cfg, kunci, n);
+    }
+
+    if (strncmp(buf, ":PIVOT ", 7) == 0) {
+        struct spesifikasi_pivot spek;
+        int tx, ty;
+        if (parse_pivot(cfg, buf + 7, &spek, &tx, &ty) != 0) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah PIVOT tidak valid");
+            return -1;
+        }
+        return aksi_pivot(cfg, &spek, tx, ty);
+    }
+
+    if (strncmp(buf, ":FILTER", 7) == 0 && (buf[7] == ' ' || buf[7] == '\0')) {
+        return aksi_filter(cfg, buf + 7);
+    }
+
+    if (strncmp(buf, ":SHEET", 6) == 0 && (buf[6] == ' ' || buf[6] == '\0')) {
+        return aksi_sheet(cfg, buf + 6);
+    }
+
+    if (strncmp(buf, ":GAYA ", 6) == 0) {
+        return aksi_gaya(cfg, buf + 6);
+    }
+
+    if (strncmp(buf, ":SORTFILE ", 10) == 0) {
+        char sumber[MAX_NAMA_FILE], tujuan[MAX_NAMA_FILE], token[16];
+        const char *p = buf + 10;
+        int berkutip, menurun = 0;
+        if (ambil_token(&p, sumber, sizeof(sumber), &berkutip) != 0 ||
+            ambil_token(&p, tujuan, sizeof(tujuan), &berkutip) != 0 ||
+            ambil_token(&p, token, sizeof(token), &berkutip) != 0 ||
+            token[0] < 'A' || token[0] > 'Z' || token[1] != '\0') {
+            snprintf(status_msg, sizeof(status_msg), "Perintah SORTFILE tidak valid");
+            return -1;
+        }
+        kolom = token[0] - 'A';
+        if (ambil_token(&p, token, sizeof(token), &berkutip) == 0) {
+            menurun = (token[0] == 'd' || token[0] == 'D');
+        }
+        return sort_file_eksternal(sumber, tujuan, kolom, menurun);
+    }
+
+    if (strncmp(buf, ":WARNA ", 7) == 0) {
+        int mode = atoi(buf + 7);
+        if (mode != 16 && mode != 256 && mode != 24) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah WARNA tidak valid");
+            return -1;
+        }
+        atur_mode_warna(mode);
+        snprintf(status_msg, sizeof(status_msg), "Palet warna: %d", mode);
+        return 0;
+    }
+
+    if (strncmp(buf, ":FREEZE", 7) == 0 && (buf[7] == ' ' || buf[7] == '\0')) {
+        const char *p = buf + 7;
+        int nb, nk;
+        while (*p == ' ') {
+            p++;
+        }
+        if (*p == '\0') {
+            /* Bekukan baris di atas dan kolom di kiri sel aktif */
+            nb = cfg->aktif_y;
+            nk = cfg->aktif_x;
+        } else if (strcmp(p, "OFF") == 0) {
+            nb = nk = 0;
+        } else if (sscanf(p, "%d %d", &nb, &nk) != 2 ||
+                   nb < 0 || nb > cfg->baris || nk < 0 || nk > cfg->kolom) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah FREEZE tidak valid");
+            return -1;
+        }
+        beku_baris = nb;
+        beku_kolom = nk;
+        cfg->view_row = nb;
+        cfg->view_col = nk;
+        ensure_active_visible(cfg);
+        if (nb == 0 && nk == 0) {
+            snprintf(status_msg, sizeof(status_msg), "Freeze dimatikan");
+        } else {
+            snprintf(status_msg, sizeof(status_msg), "Freeze: %d baris, %d kolom", nb, nk);
+        }
+        return 0;
+    }
+
+    if (strncmp(buf, ":MAKRO ", 7) == 0) {
+        char aksi[16], reg[4], arg[256];
+        int n = sscanf(buf + 7, "%15s %3s %255s", aksi, reg, arg);
+        int r = n >= 2 && reg[1] == '\0' ? indeks_register_makro((unsigned char)reg[0]) : -1;
+
+        if (r < 0) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah MAKRO tidak valid");
+            return -1;
+        }
+        if (strcmp(aksi, "SIMPAN") == 0 && n == 3) {
+            return simpan_makro(r, arg);
+        }
+        if (strcmp(aksi, "BUKA") == 0 && n == 3) {
+            return buka_makro(r, arg);
+        }
+        if (strcmp(aksi, "PUTAR") == 0) {
+            int kali = n == 3 ? atoi(arg) : 1;
+            if (putar_makro(r, kali) != 0) {
+                return -1;
+            }
+            snprintf(status_msg, sizeof(status_msg), "Makro %c diputar %d kali", 'a' + r, kali);
+            return 0;
+        }
+        snprintf(status_msg, sizeof(status_msg), "Perintah MAKRO tidak valid");
+        return -1;
+    }
+
+    if (strncmp(buf, ":SOCKET ", 8) == 0) {
+        const char *p = buf + 8;
+        while (*p == ' ') {
+            p++;
+        }
+        if (strcmp(p, "OFF") == 0) {
+            tutup_server_soket();
+            snprintf(status_msg, sizeof(status_msg), "Soket ditutup");
+            return 0;
+        }
+        if (*p == '\0') {
+            snprintf(status_msg, sizeof(status_msg), "Perintah SOCKET tidak valid");
+            return -1;
+        }
+        return buka_server_soket(p);
+    }
+
+    if (strncmp(buf, ":SORTMEM ", 9) == 0) {
+        long mb = atol(buf + 9);
+        if (mb < 1) {
+            snprintf(status_msg, sizeof(status_msg), "Perintah SORTMEM tidak valid");
+            return -1;
+        }
+        batas_memori_sort = (size_t)mb * 1024 * 1024;
+        snprintf(status_msg, sizeof(status_msg), "Memori sort eksternal: %ld MB", mb);
+        return 0;
+    }
+
+    jejak_mulai("evaluasi_lookup");
+    t0 = waktu_ms();
+    st = evaluasi_lookup(cfg, buf, teks, sizeof(teks));
+    kinerja.formula_us = (waktu_ms() - t0) * 1000.0;
+    jejak_selesai();
+    if (st == 0) {
+        set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, teks, 1);
+        hasil_di_sel_aktif = 1;
+        snprintf(status_msg, sizeof(status_msg), "Lookup dievaluasi");
+        return 0;
+    } else if (st == -2) {
+        snprintf(status_msg, sizeof(status_msg), "Nilai tidak ditemukan");
+        return -1;
+    } else if (st == -1) {
+        snprintf(status_msg, sizeof(status_msg), "Formula tidak valid");
+        return -1;
+    }
+
+    jejak_mulai("evaluasi_formula");
+    t0 = waktu_ms();
+    st = evaluasi_formula(cfg, buf, &hasil);
+    kinerja.formula_us = (waktu_ms() - t0) * 1000.0;
+    jejak_selesai();
+    if (st == 0) {
+        snprintf(teks, sizeof(teks), "%.2f", hasil);
+        set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, teks, 1);
+        hasil_di_sel_aktif = 1;
+        snprintf(status_msg, sizeof(status_msg), "Formula dievaluasi");
+        return 0;
+    }
+    snprintf(status_msg, sizeof(status_msg), "Formula tidak valid");
+    return -1;
+}
+
+static void mode_command_line(struct konfigurasi *cfg)
+{
+    char buf[MAX_TEXT];
+    int len, cursor;
+    unsigned char ch;
+    char label[64];
+    int input_x;
+
+    buf[0] = ':';
+    buf[1] = '\0';
+    len = 1;
+    cursor = 1;
+    snprintf(label, sizeof(label), "formula");
+    input_x = 2 + (int)strlen(label);
+
+    /* Tampilkan label + isi lama */
+    kosongkan_baris(1);
+    pos(2, 1);
+    tulis_teks(label, strlen(label));
+    tulis_teks(buf, (size_t)len);
+    {
+        char judul[] = "TABEL v0.7";
+        pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
+        tulis_teks(judul, strlen(judul));
+    }
+    pos(input_x + lebar_teks(buf, cursor), 1);
+    tulis_teks("\033[?25h", 6);
+    flush();
+
+    while (baca_input(&ch) > 0) {
+        if (ch == '\n' || ch == '\r') {
+            jalankan_command_line(cfg, buf);
+            break;
+        } else if (ch == 0x1B) {
+            unsigned char s1;
+            if (baca_input(&s1) <= 0) {
+                continue;
+            }
+            if (s1 == '[') {
+                unsigned char s2;
+                if (baca_input(&s2) <= 0) {
+                    continue;
+                }
+                if (s2 == 'D') {
+                    if (cursor > 1) {
+                        cursor = mundur_utf8(buf, cursor);
+                    }
+                } else if (s2 == 'C') {
+                    if (cursor < len) {
+                        cursor = maju_utf8(buf, len, cursor);
+                    }
+                } else if (s2 == '3') {
+                    unsigned char t;
+                    if (baca_input(&t) <= 0) {
+                        continue;
+                    }
+                    if (t == '~') {
+                        if (cursor < len) {
+                            hapus_karakter(buf, &len, cursor);
+                        }
+                    }
+                }
+            }
+        } else if (ch == 0x7F) {
+            if (cursor > 1) {
+                cursor = mundur_utf8(buf, cursor);
+                hapus_karakter(buf, &len, cursor);
+            }
+        } else if ((ch >= 0x20 && ch <= 0x7E) || ch >= 0xC0) {
+            sisip_karakter(buf, &len, &cursor, ch);
+        }
+
+        /* Update tampilan */
+        kosongkan_baris(1);
+        pos(2, 1);
+        tulis_teks(label, strlen(label));
+        tulis_teks(buf, (size_t)len);
+        {
+            char judul[] = "TABEL v0.7";
+            pos(lebar_terminal() - (int)strlen(judul) - 1, 1);
+            tulis_teks(judul, strlen(judul));
+        }
+        pos(input_x + lebar_teks(buf, cursor), 1);
+        flush();
+    }
+
+    tulis_teks("\033[?25l", 6);
+    render(cfg);
+}
+
+/* ============================================================
+ * Fungsi File I/O
+ * ============================================================ */
+static int akhiran_csv(const char *nama_file)
+{
+    size_t i = strlen(nama_file);
+    return i > 4 && nama_file[i - 4] == '.' &&
+           (nama_file[i - 3] == 'c' || nama_file[i - 3] == 'C') &&
+           (nama_file[i - 2] == 's' || nama_file[i - 2] == 'S') &&
+           (nama_file[i - 1] == 'v' || nama_file[i - 1] == 'V');
+}
+
+/* hanya_terlihat != 0: baris yang tersembunyi filter tidak ditulis */
+static void tulis_sheet_csv(FILE *file, const struct konfigurasi *cfg,
+                            int hanya_terlihat)
+{
+    int y, x;
+
+    for (y = 0; y < cfg->baris; y++) {
+        if (hanya_terlihat && !baris_terlihat(y)) {
+            continue;
+        }
+        for (x = 0; x < cfg->kolom; x++) {
+            if (x > 0) {
+                fprintf(file, ",");
+            }
+            fprintf(file, "\"%s\"", isi[y][x]);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+static void tulis_sheet_txt(FILE *file, const struct konfigurasi *cfg,
+                            int hanya_terlihat)
+{
+    int y, x;
+
+    for (y = 0; y < cfg->baris; y++) {
+        if (hanya_terlihat && !baris_terlihat(y)) {
+            continue;
+        }
+        for (x = 0; x < cfg->kolom; x++) {
+            if (x > 0) {
+                fprintf(file, "\t");
+            }
+            fprintf(file, "%s", isi[y][x]);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+/* Simpan sheet aktif, atau seluruh workbook jika ada lebih dari satu
+ * sheet. hanya_terlihat (ekspor hasil filter) selalu satu sheet */
+static int simpan_berkas(const char *nama_file, struct konfigurasi *cfg,
+                         int hanya_terlihat, int csv)
+{
+    FILE *file = fopen(nama_file, "w");
+    void (*tulis)(FILE *, const struct konfigurasi *, int) =
+        csv ? tulis_sheet_csv : tulis_sheet_txt;
+
+    if (!file) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %s", nama_file);
+        return -1;
+    }
+    jejak_mulai(csv ? "simpan_csv" : "simpan_txt");
+
+    if (jumlah_sheet > 1 && !hanya_terlihat) {
+        tulis_workbook(file, cfg, tulis);
+    } else {
+        tulis(file, cfg, hanya_terlihat);
+    }
+
+    fclose(file);
+    jejak_selesai();
+    if (jumlah_sheet > 1 && !hanya_terlihat) {
+        snprintf(status_msg, sizeof(status_msg), "Workbook disimpan: %s (%d sheet)",
+                 nama_file, jumlah_sheet);
+    } else {
+        snprintf(status_msg, sizeof(status_msg), "File %s disimpan: %s",
+                 csv ? "CSV" : "TXT", nama_file);
+    }
+    return 0;
+}
+
+static int simpan_csv(const char *nama_file, struct konfigurasi *cfg,
+                      int hanya_terlihat)
+{
+    return simpan_berkas(nama_file, cfg, hanya_terlihat, 1);
+}
+
+static int simpan_txt(const char *nama_file, struct konfigurasi *cfg,
+                      int hanya_terlihat)
+{
+    return simpan_berkas(nama_file, cfg, hanya_terlihat, 0);
+}
+
+/* Pecah satu baris CSV (kutipan di tepi field dibuang) atau bertab di
+ * tempat; sel[x] menunjuk ke dalam baris. Mengembalikan jumlah field */
+static int urai_baris(char *baris, int csv, const char **sel, int kolom)
+{
+    const char *pemisah = csv ? ",\n" : "\t\n";
+    char *token = strtok(baris, pemisah);
+    int x = 0;
+
+    while (token && x < kolom) {
+        /* Hapus kutipan jika ada */
+        if (csv && token[0] == '"') {
+            size_t len = strlen(token);
+            if (len > 1 && token[len - 1] == '"') {
+                token[len - 1] = '\0';
+                token++;
+            }
+        }
+        if (strlen(token) >= MAX_TEXT) {
+            token[MAX_TEXT - 1] = '\0';
+        }
+        sel[x++] = token;
+        token = strtok(NULL, pemisah);
+    }
+    return x;
+}
+
+/* Urai satu baris file ke baris y sheet aktif; mengembalikan jumlah
+ * field, -1 jika memori habis */
+static int muat_baris(int y, char *baris, int csv, int kolom)
+{
+    const char *sel[MAKS_KOLOM];
+    int n = urai_baris(baris, csv, sel, kolom);
+    int x;
+
+    for (x = 0; x < n; x++) {
+        if (tulis_sel(x, y, sel[x]) != 0) {
+            return -1;
+        }
+    }
+    return n;
+}
+
+/* Baca file ke sheet aktif. File workbook (baris pertama PENANDA_SHEET)
+ * menggantikan sheet lain: tiap penanda berikutnya membuka sheet baru
+ * seukuran sheet pertama. Mengembalikan jumlah baris sheet pertama, -1
+ * jika file gagal dibuka */
+static int baca_berkas(const char *nama_file, struct konfigurasi *cfg, int csv)
+{
+    FILE *file = fopen(nama_file, "r");
+    char baris[MAX_TEXT * MAKS_KOLOM];
+    size_t panjang_penanda = strlen(PENANDA_SHEET);
+    int y = 0, n_pertama = -1, workbook = 0;
+    int max_x = 0;
+    int x;
+
+    if (!file) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %s", nama_file);
+        return -1;
+    }
+    jejak_mulai(csv ? "baca_csv" : "baca_txt");
+
+    while (fgets(baris, sizeof(baris), file)) {
+        if ((workbook || (y == 0 && n_pertama < 0)) &&
+            strncmp(baris, PENANDA_SHEET, panjang_penanda) == 0) {
+            char *nama = baris + panjang_penanda;
+            nama[strcspn(nama, "\r\n")] = '\0';
+            if (!workbook) {
+                workbook = 1;
+                sisakan_sheet_aktif(cfg);
+                n_pertama = -1;
+            } else {
+                if (n_pertama < 0) {
+                    n_pertama = y;
+                }
+                x = buat_sheet(nama, cfg->kolom, cfg->baris);
+                if (x < 0) {
+                    break;
+                }
+                pindah_sheet(cfg, x);
+                y = 0;
+            }
+            snprintf(sheet[sheet_aktif]->nama, MAKS_NAMA_SHEET, "%.*s",
+                     MAKS_NAMA_SHEET - 1, nama);
+            continue;
+        }
+        if (y >= cfg->baris) {
+            if (!workbook) {
+                break;
+            }
+            continue;
+        }
+        x = muat_baris(y, baris, csv, cfg->kolom);
+        if (x < 0) {
+            break;
+        }
+        if (x > max_x) {
+            max_x = x;
+        }
+        y++;
+    }
+    if (n_pertama < 0) {
+        n_pertama = y;
+    }
+
+    fclose(file);
+    jejak_selesai();
+    pindah_sheet(cfg, 0);
+    invalidasi_semua_indeks();
+    versi_isi++;
+    hapus_filter();
+
+    /* Update ukuran grid jika perlu */
+    if (max_x > cfg->kolom) {
+        cfg->kolom = max_x;
+    }
+    if (n_pertama > cfg->baris) {
+        cfg->baris = n_pertama;
+    }
+
+    if (jumlah_sheet > 1) {
+        snprintf(status_msg, sizeof(status_msg), "Workbook dibaca: %s (%d sheet)",
+                 nama_file, jumlah_sheet);
+    } else {
+        snprintf(status_msg, sizeof(status_msg), "File %s dibaca: %s",
+                 csv ? "CSV" : "TXT", nama_file);
+    }
+    return n_pertama;
+}
+
+/* Mengembalikan jumlah baris yang dibaca, -1 jika file gagal dibuka */
+static int baca_csv(const char *nama_file, struct konfigurasi *cfg)
+{
+    return baca_berkas(nama_file, cfg, 1);
+}
+
+/* Seperti baca_csv untuk teks bertab */
+static int baca_txt(const char *nama_file, struct konfigurasi *cfg)
+{
+    return baca_berkas(nama_file, cfg, 0);
+}
+
+/* ============================================================
+ * Fungsi Pantau File
+ * ============================================================ */
+/* File yang terakhir dibuka/disimpan diperiksa tiap INTERVAL_PANTAU_MS
+ * (stat, tanpa inotify). Saat berubah, tiap baris di-hash: baris mentah
+ * yang hash-nya sama dilewati tanpa diurai, baris lain dibandingkan
+ * dengan hash isi sel saat sinkron terakhir untuk memisahkan perubahan
+ * disk dari suntingan lokal */
+static unsigned int hash_isi_baris(const struct konfigurasi *cfg, const char *const *sel)
+{
+    unsigned int h = 2166136261u;
+    int x;
+    for (x = 0; x < cfg->kolom; x++) {
+        const char *p = sel[x];
+        while (*p) {
+            h ^= (unsigned char)*p++;
+            h *= 16777619u;
+        }
+        /* Pemisah agar "ab","" berbeda dari "a","b" */
+        h ^= 0x1Fu;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Jadikan isi sheet saat ini dan isi nama di disk sebagai acuan */
+static void catat_dasar_file(const struct konfigurasi *cfg, const char *nama, int csv)
+{
+    char baris[MAX_TEXT * MAKS_KOLOM];
+    FILE *file = fopen(nama, "r");
+    int y = 0;
+
+    file_pantau[0] = '\0';
+    /* Workbook tidak dipantau: baris disk tidak sejajar dengan satu sheet */
+    if (jumlah_sheet > 1) {
+        if (file) {
+            fclose(file);
+        }
+        return;
+    }
+    if (!file) {
+        return;
+    }
+    if (fstat(fileno(file), &stat_pantau) != 0) {
+        fclose(file);
+        return;
+    }
+    while (y < cfg->baris && fgets(baris, sizeof(baris), file)) {
+        hash_mentah[y++] = hash_teks(baris);
+    }
+    fclose(file);
+    baris_file = y;
+    for (; y < cfg->baris; y++) {
+        hash_mentah[y] = 0;
+    }
+    for (y = 0; y < cfg->baris; y++) {
+        hash_isi_dasar[y] = hash_isi_baris(cfg, isi[y]);
+    }
+    snprintf(file_pantau, sizeof(file_pantau), "%s", nama);
+    file_pantau_csv = csv;
+    sheet_pantau = sheet_aktif;
+    pantau_berikut = waktu_ms() + INTERVAL_PANTAU_MS;
+}
+
+/* Terapkan baris yang berubah di disk; baris yang juga diedit lokal
+ * dibiarkan dan dilaporkan sebagai konflik. Baris yang ditimpa dipotret
+ * lebih dulu sehingga seluruh muat ulang menjadi satu op undo, berapa
+ * pun banyak selnya */
+static void muat_ulang_file(struct konfigurasi *cfg)
+{
+    const char *baru[MAKS_KOLOM];
+    char baris[MAX_TEXT * MAKS_KOLOM];
+    FILE *file = fopen(file_pantau, "r");
+    struct potret_area *potret;
+    int y, x, n, jumlah = 0, berubah = 0, konflik = 0, konflik_pertama = -1;
+    int gagal = 0;
+    unsigned int h, h_baru, h_lokal;
+
+    if (!file) {
+        return;
+    }
+    fstat(fileno(file), &stat_pantau);
+    potret = buat_potret(0, cfg->kolom - 1);
+    for (y = 0; y < cfg->baris; y++) {
+        if (fgets(baris, sizeof(baris), file)) {
+            h = hash_teks(baris);
+            jumlah = y + 1;
+        } else if (y < baris_file) {
+            /* Baris terhapus di disk */
+            baris[0] = '\0';
+            h = 0;
+        } else {
+            break;
+        }
+        if (h == hash_mentah[y]) {
+            continue;
+        }
+        n = urai_baris(baris, file_pantau_csv, baru, cfg->kolom);
+        for (x = n; x < cfg->kolom; x++) {
+            baru[x] = teks_kosong;
+        }
+        h_baru = hash_isi_baris(cfg, baru);
+        h_lokal = hash_isi_baris(cfg, isi[y]);
+        if (h_lokal != hash_isi_dasar[y] && h_lokal != h_baru) {
+            konflik++;
+            if (konflik_pertama < 0) {
+                konflik_pertama = y;
+            }
+            continue;
+        }
+        if (h_lokal != h_baru && (!potret || potret_baris(potret, y) != 0)) {
+            /* Tanpa potret perubahan tidak bisa di-undo: berhenti di sini
+             * dan periksa ulang file pada interval berikutnya */
+            gagal = 1;
+            memset(&stat_pantau, 0, sizeof(stat_pantau));
+            break;
+        }
+        hash_mentah[y] = h;
+        hash_isi_dasar[y] = h_baru;
+        if (h_lokal == h_baru) {
+            continue;
+        }
+        for (x = 0; x < cfg->kolom; x++) {
+            if (strcmp(isi[y][x], baru[x]) != 0) {
+                set_cell_text(cfg, x, y, baru[x], 0);
+            }
+        }
+        berubah++;
+    }
+    fclose(file);
+    if (!gagal) {
+        baris_file = jumlah;
+    }
+
+    if (berubah > 0) {
+        push_undo_area(potret);
+        perbarui_filter();
+    } else {
+        buang_potret(potret);
+    }
+    if (gagal) {
+        minta_frame(FRAME_PENUH);
+        return;
+    }
+    if (konflik > 0) {
+        /* Suntingan lokal dipertahankan; baris konflik pertama ditunjuk */
+        snprintf(status_msg, sizeof(status_msg), "%d baris dimuat, %d konflik mulai baris %d",
+                 berubah, konflik, konflik_pertama + 1);
+    } else if (berubah > 0) {
+        snprintf(status_msg, sizeof(status_msg), "File berubah: %d baris dimuat", berubah);
+    }
+    if (berubah > 0 || konflik > 0) {
+        minta_frame(FRAME_PENUH);
+    }
+}
+
+/* Milidetik sampai file perlu diperiksa lagi */
+static int jeda_pantau(void)
+{
+    double sisa = pantau_berikut - waktu_ms();
+    return sisa > 0 ? (int)sisa + 1 : 0;
+}
+
+static void periksa_file_pantau(struct konfigurasi *cfg)
+{
+    struct stat st;
+
+    pantau_berikut = waktu_ms() + INTERVAL_PANTAU_MS;
+    /* Sheet yang dipantau sedang tidak tampil: diperiksa saat kembali */
+    if (sheet_aktif != sheet_pantau) {
+        return;
+    }
+    /* Gagal stat: file sedang diganti (rename), coba lagi nanti */
+    if (stat(file_pantau, &st) != 0) {
+        return;
+    }
+    if (st.st_ino == stat_pantau.st_ino && st.st_size == stat_pantau.st_size &&
+        st.st_mtim.tv_sec == stat_pantau.st_mtim.tv_sec &&
+        st.st_mtim.tv_nsec == stat_pantau.st_mtim.tv_nsec) {
+        return;
+    }
+    muat_ulang_file(cfg);
+}
+
+/* ============================================================
+ * Fungsi Sort Eksternal
+ * ============================================================ */
+
+/* Satu baris input yang menunggu di-sort di dalam run memori */
+struct rekaman_sort {
+    char *baris;
+    size_t panjang;
+    struct nilai_sort nilai;
+    long urutan;
+};
+
+/* Run yang sudah ditulis ke file sementara, dibaca ulang saat merge */
+struct run_sort {
+    FILE *file;
+    char *baris;
+    size_t kapasitas;
+    ssize_t panjang;
+    char kunci[MAX_TEXT];
+    struct nilai_sort nilai;
+    int habis;
+};
+
+static int sort_eksternal_menurun;
+
+/* Ambil kolom ke-kolom dari satu baris dengan aturan yang sama seperti
+ * baca_csv/baca_txt: pemisah berurutan dilewati, kutipan luar dibuang
+ * hanya untuk CSV */
+static void ambil_kolom_baris(const char *baris, const char *pemisah,
+                              int kolom, char *out, size_t ukuran)
+{
+    const char *p = baris;
+    size_t n;
+    int x = 0;
+
+    out[0] = '\0';
+    while (1) {
+        p += strspn(p, pemisah);
+        if (*p == '\0') {
+            return;
+        }
+        n = strcspn(p, pemisah);
+        if (x == kolom) {
+            if (pemisah[0] == ',' && n > 1 && p[0] == '"' && p[n - 1] == '"') {
+                p++;
+                n -= 2;
+            }
+            if (n > ukuran - 1) {
+                n = ukuran - 1;
+            }
+            memcpy(out, p, n);
+            out[n] = '\0';
+            return;
+        }
+        p += n;
+        x++;
+    }
+}
+
+static int bandingkan_rekaman(const void *a, const void *b)
+{
+    const struct rekaman_sort *ra = a, *rb = b;
+    int hasil = bandingkan_nilai(&ra->nilai, &rb->nilai, sort_eksternal_menurun);
+    if (hasil != 0) {
+        return hasil;
+    }
+    return ra->urutan < rb->urutan ? -1 : (ra->urutan > rb->urutan ? 1 : 0);
+}
+
+static int tulis_run(FILE *file, struct rekaman_sort *rek, size_t n)
+{
+    size_t i;
+    qsort(rek, n, sizeof(*rek), bandingkan_rekaman);
+    for (i = 0; i < n; i++) {
+        if (fwrite(rek[i].baris, 1, rek[i].panjang, file) != rek[i].panjang) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void maju_run(struct run_sort *run, const char *pemisah, int kolom)
+{
+    run->panjang = getline(&run->baris, &run->kapasitas, run->file);
+    if (run->panjang <= 0) {
+        run->habis = 1;
+        return;
+    }
+    ambil_kolom_baris(run->baris, pemisah, kolom, run->kunci, sizeof(run->kunci));
+    parse_nilai_sort(run->kunci, &run->nilai);
+}
+
+/* Run a menang atas run b; seri dimenangkan run yang lebih awal (stabil) */
+static int run_menang(const struct run_sort *runs, int a, int b)
+{
+    int hasil;
+    if (runs[a].habis || runs[b].habis) {
+        return runs[b].habis && (!runs[a].habis || a < b);
+    }
+    hasil = bandingkan_nilai(&runs[a].nilai, &runs[b].nilai,
+                             sort_eksternal_menurun);
+    return hasil < 0 || (hasil == 0 && a < b);
+}
+
+/* Naikkan pemenang s dari daun ke akar loser tree; tiap simpul
+ * menyimpan pihak yang kalah, akar tree[0] menyimpan pemenang */
+static void sesuaikan_loser_tree(const struct run_sort *runs, int *tree,
+                                 int k, int s)
+{
+    int t = (s + k) / 2;
+    while (t > 0) {
+        if (tree[t] < 0) {
+            tree[t] = s;
+            return;
+        }
+        if (run_menang(runs, tree[t], s)) {
+            int tukar = tree[t];
+            tree[t] = s;
+            s = tukar;
+        }
+        t /= 2;
+    }
+    tree[0] = s;
+}
+
+static int gabung_run_file(FILE **run_file, int k, FILE *keluar,
+                           const char *pemisah, int kolom)
+{
+    struct run_sort *runs = calloc((size_t)k, sizeof(*runs));
+    int *tree = malloc((size_t)k * sizeof(int));
+    int i, st = 0;
+
+    if (k < 1 || !runs || !tree) {
+        free(runs);
+        free(tree);
+        return -1;
+    }
+    for (i = 0; i < k; i++) {
+        runs[i].file = run_file[i];
+        rewind(runs[i].file);
+        maju_run(&runs[i], pemisah, kolom);
+        tree[i] = -1;
+    }
+    for (i = k - 1; i >= 0; i--) {
+        sesuaikan_loser_tree(runs, tree, k, i);
+    }
+
+    while (!runs[tree[0]].habis) {
+        struct run_sort *w = &runs[tree[0]];
+        if (fwrite(w->baris, 1, (size_t)w->panjang, keluar) != (size_t)w->panjang) {
+            st = -1;
+            break;
+        }
+        maju_run(w, pemisah, kolom);
+        sesuaikan_loser_tree(runs, tree, k, tree[0]);
+    }
+
+    for (i = 0; i < k; i++) {
+        free(runs[i].baris);
+    }
+    free(runs);
+    free(tree);
+    return st;
+}
+
+/* Run yang sudah ditumpahkan. tingkat[i] adalah berapa kali run ke-i
+ * sudah melewati merge; tingkat tidak pernah naik sepanjang daftar */
+struct daftar_run {
+    FILE **file;
+    int *tingkat;
+    int jumlah;
+    int maks;
+    int total;
+};
+
+static int tambah_run(struct daftar_run *d, FILE *file, int tingkat)
+{
+    if (d->jumlah == d->maks) {
+        int maks_baru = d->maks ? d->maks * 2 : MAKS_FANIN_SORT * 2;
+        FILE **file_baru = realloc(d->file, (size_t)maks_baru * sizeof(FILE *));
+        int *tingkat_baru;
+        if (!file_baru) {
+            return -1;
+        }
+        d->file = file_baru;
+        tingkat_baru = realloc(d->tingkat, (size_t)maks_baru * sizeof(int));
+        if (!tingkat_baru) {
+            return -1;
+        }
+        d->tingkat = tingkat_baru;
+        d->maks = maks_baru;
+    }
+    d->file[d->jumlah] = file;
+    d->tingkat[d->jumlah] = tingkat;
+    d->jumlah++;
+    return 0;
+}
+
+/* Gabungkan m run terakhir menjadi satu run baru di posisi yang sama,
+ * sehingga urutan run (dan stabilitas merge) tetap terjaga */
+static int gabung_ekor_run(struct daftar_run *d, int m, const char *pemisah,
+                           int kolom)
+{
+    int awal = d->jumlah - m, tingkat = d->tingkat[awal] + 1, i;
+    FILE *file = tmpfile();
+
+    if (!file || gabung_run_file(d->file + awal, m, file, pemisah, kolom) != 0
+        || fflush(file) != 0) {
+        if (file) {
+            fclose(file);
+        }
+        snprintf(status_msg, sizeof(status_msg), "Gagal menulis file sementara");
+        return -1;
+    }
+    for (i = awal; i < d->jumlah; i++) {
+        fclose(d->file[i]);
+    }
+    d->jumlah = awal;
+    return tambah_run(d, file, tingkat);
+}
+
+/* Sort rekaman run dan tumpahkan ke file sementara baru. Begitu
+ * MAKS_FANIN_SORT run setingkat terkumpul, run itu langsung digabung
+ * menjadi satu run tingkat berikutnya, sehingga jumlah file sementara
+ * yang terbuka tetap kecil (logaritmik terhadap jumlah run) */
+static int tumpahkan_run(struct daftar_run *d, struct rekaman_sort *rek,
+                         size_t n, const char *pemisah, int kolom)
+{
+    FILE *file = tmpfile();
+    if (!file || tulis_run(file, rek, n) != 0) {
+        if (file) {
+            fclose(file);
+        }
+        snprintf(status_msg, sizeof(status_msg), "Gagal menulis file sementara");
+        return -1;
+    }
+    if (tambah_run(d, file, 0) != 0) {
+        fclose(file);
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk sort");
+        return -1;
+    }
+    d->total++;
+    while (d->jumlah >= MAKS_FANIN_SORT
+           && d->tingkat[d->jumlah - MAKS_FANIN_SORT] == d->tingkat[d->jumlah - 1]) {
+        if (gabung_ekor_run(d, MAKS_FANIN_SORT, pemisah, kolom) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Sort file CSV/TXT berdasarkan satu kolom tanpa memuatnya ke grid.
+ * Input dibaca per run sebesar batas_memori_sort, tiap run di-sort dan
+ * ditumpahkan ke file sementara, lalu run digabung bertahap dengan loser
+ * tree, paling banyak MAKS_FANIN_SORT run per merge. */
+static int sort_file_eksternal(const char *sumber, const char *tujuan,
+                               int kolom, int menurun)
+{
+    const char *pemisah = akhiran_csv(sumber) ? ",\n" : "\t\n";
+    size_t batas_arena = batas_memori_sort / 4 * 3;
+    size_t maks_rekaman = batas_memori_sort / 4 / sizeof(struct rekaman_sort);
+    char *arena = malloc(batas_arena);
+    struct rekaman_sort *rek = malloc(maks_rekaman * sizeof(*rek));
+    struct daftar_run runs;
+    FILE *masuk = NULL, *keluar = NULL;
+    char *baris = NULL, kunci[MAX_TEXT];
+    size_t kapasitas = 0, terpakai = 0, n = 0;
+    ssize_t panjang;
+    long urutan = 0;
+    int st = -1, i;
+
+    memset(&runs, 0, sizeof(runs));
+    sort_eksternal_menurun = menurun;
+    if (!arena || !rek) {
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk sort");
+        goto selesai;
+    }
+    masuk = fopen(sumber, "r");
+    if (!masuk) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %.*s",
+                 MAKS_NAMA_STATUS, sumber);
+        goto selesai;
+    }
+
+    while ((panjang = getline(&baris, &kapasitas, masuk)) > 0) {
+        size_t butuh;
+        ambil_kolom_baris(baris, pemisah, kolom, kunci, sizeof(kunci));
+        butuh = (size_t)panjang + 1 + strlen(kunci) + 1;
+        if (butuh > batas_arena) {
+            snprintf(status_msg, sizeof(status_msg), "Baris terlalu panjang");
+            goto selesai;
+        }
+
+        /* Run penuh: sort dan tumpahkan ke file sementara */
+        if (terpakai + butuh > batas_arena || n == maks_rekaman) {
+            if (tumpahkan_run(&runs, rek, n, pemisah, kolom) != 0) {
+                goto selesai;
+            }
+            terpakai = 0;
+            n = 0;
+        }
+
+        rek[n].baris = arena + terpakai;
+        memcpy(rek[n].baris, baris, (size_t)panjang);
+        if (baris[panjang - 1] != '\n') {
+            rek[n].baris[panjang++] = '\n';
+        }
+        rek[n].panjang = (size_t)panjang;
+        terpakai += (size_t)panjang;
+        strcpy(arena + terpakai, kunci);
+        parse_nilai_sort(arena + terpakai, &rek[n].nilai);
+        terpakai += strlen(kunci) + 1;
+        rek[n].urutan = urutan++;
+        n++;
+    }
+    if (ferror(masuk)) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membaca file: %.*s",
+                 MAKS_NAMA_STATUS, sumber);
+        goto selesai;
+    }
+
+    if (runs.jumlah > 0) {
+        if (tumpahkan_run(&runs, rek, n, pemisah, kolom) != 0) {
+            goto selesai;
+        }
+        /* Arena run terakhir tidak dibutuhkan lagi selama merge */
+        free(arena);
+        arena = NULL;
+        free(rek);
+        rek = NULL;
+        /* Sisa run dari tingkat berbeda digabung per MAKS_FANIN_SORT
+         * sebelum merge terakhir ke file tujuan */
+        while (runs.jumlah > MAKS_FANIN_SORT) {
+            if (gabung_ekor_run(&runs, MAKS_FANIN_SORT, pemisah, kolom) != 0) {
+                goto selesai;
+            }
+        }
+    }
+
+    keluar = fopen(tujuan, "w");
+    if (!keluar) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %.*s",
+                 MAKS_NAMA_STATUS, tujuan);
+        goto selesai;
+    }
+
+    if (runs.jumlah == 0) {
+        /* Semua muat dalam satu run: langsung tulis hasil */
+        st = tulis_run(keluar, rek, n);
+    } else {
+        st = gabung_run_file(runs.file, runs.jumlah, keluar, pemisah, kolom);
+    }
+    if (fclose(keluar) != 0) {
+        st = -1;
+    }
+    keluar = NULL;
+    if (st == 0) {
+        snprintf(status_msg, sizeof(status_msg), "%ld baris di-sort (%d run): %.*s",
+                 urutan, runs.total ? runs.total : 1, MAKS_NAMA_STATUS, tujuan);
+    } else {
+        snprintf(status_msg, sizeof(status_msg), "Gagal menulis file: %.*s",
+                 MAKS_NAMA_STATUS, tujuan);
+    }
+
+selesai:
+    for (i = 0; i < runs.jumlah; i++) {
+        fclose(runs.file[i]);
+    }
+    free(runs.file);
+    free(runs.tingkat);
+    if (masuk) {
+        fclose(masuk);
+    }
+    if (keluar) {
+        fclose(keluar);
+    }
+    free(baris);
+    free(arena);
+    free(rek);
+    return st;
+}
+
+/* ============================================================
+ * Fungsi Aksi Modular
+ * ============================================================ */
+
+/* Terapkan op ke sheet: undo (balik = 1) menulis `before`, redo menulis
+ * `after`. Teks sel sebelum ditimpa disalin ke kini. Mengembalikan -1
+ * dengan status_msg terisi jika gagal; sheet tidak berubah */
+static int terapkan_op(struct op *op, int balik, char *kini)
+{
+    kini[0] = '\0';
+    if (op->gaya_ada) {
+        tukar_gaya_op(op);
+        return 0;
+    }
+    if (op->area) {
+        return tukar_area_op(op);
+    }
+    if (op->perm) {
+        if (terapkan_permutasi(op->x, op->y, op->x2, op->y2, op->perm, balik) != 0) {
+            snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk %s sort",
+                     balik ? "undo" : "redo");
+            return -1;
+        }
+        return 0;
+    }
+    strncpy(kini, isi[op->y][op->x], MAX_TEXT - 1);
+    kini[MAX_TEXT - 1] = '\0';
+    if (tulis_sel(op->x, op->y, balik ? op->before : op->after) != 0) {
+        return -1;
+    }
+    invalidasi_indeks_kolom(op->x);
+    invalidasi_letak_sel(op->x, op->y);
+    return 0;
+}
+
+/* Pindahkan op yang sudah diterapkan ke slot tujuan di stack seberang;
+ * perm, run gaya dan potret wilayah berpindah kepemilikan */
+static void pindahkan_op(struct op *tujuan, struct op *op, const char *kini)
+{
+    tujuan->x = op->x;
+    tujuan->y = op->y;
+    tujuan->x2 = op->x2;
+    tujuan->y2 = op->y2;
+    tujuan->perm = op->perm;
+    op->perm = NULL;
+    tujuan->gaya_ada = op->gaya_ada;
+    tujuan->gaya = op->gaya;
+    op->gaya_ada = 0;
+    tujuan->area = op->area;
+    op->area = NULL;
+    if (tujuan->perm || tujuan->gaya_ada || tujuan->area) {
+        tujuan->before[0] = '\0';
+        tujuan->after[0] = '\0';
+        return;
+    }
+    snprintf(tujuan->before, MAX_TEXT, "%s", kini);
+    snprintf(tujuan->after, MAX_TEXT, "%s", op->after);
+}
+
+/* Fungsi Undo */
+static void aksi_undo(struct konfigurasi *cfg)
+{
+    int grup;
+
+    if (undo_top <= 0) {
+        snprintf(status_msg, sizeof(status_msg), "Tidak ada yang bisa di-undo");
+        return;
+    }
+
+    grup = undo_stack[undo_top - 1].grup;
+    pindah_sheet(cfg, undo_stack[undo_top - 1].sheet);
+    while (undo_top > 0 && undo_stack[undo_top - 1].grup == grup) {
+        struct op *op = &undo_stack[undo_top - 1];
+        struct op *r;
+        char kini[MAX_TEXT];
+
+        /* Terapkan dulu; op yang gagal tetap di undo stack sehingga
+         * riwayat selalu cocok dengan isi sheet */
+        if (terapkan_op(op, 1, kini) != 0) {
+            return;
+        }
+        undo_top--;
+        if (redo_top >= UNDO_MAX) {
+            buang_grup_tertua(redo_stack, &redo_top);
+        }
+        r = &redo_stack[redo_top++];
+        pindahkan_op(r, op, kini);
+        r->grup = op->grup;
+        r->sheet = op->sheet;
+    }
+    snprintf(status_msg, sizeof(status_msg), "Undo berhasil");
+}
+
+/* Fungsi Redo */
+static void aksi_redo(struct konfigurasi *cfg)
+{
+    int grup;
+
+    if (redo_top <= 0) {
+        snprintf(status_msg, sizeof(status_msg), "Tidak ada yang bisa di-redo");
+        return;
+    }
+
+    grup = redo_stack[redo_top - 1].grup;
+    pindah_sheet(cfg, redo_stack[redo_top - 1].sheet);
+    mulai_transaksi();
+    while (redo_top > 0 && redo_stack[redo_top - 1].grup == grup) {
+        struct op *op = &redo_stack[redo_top - 1];
+        char kini[MAX_TEXT];
+
+        if (terapkan_op(op, 0, kini) != 0) {
+            akhiri_transaksi();
+            return;
+        }
+        redo_top--;
+        pindahkan_op(catat_undo(), op, kini);
+    }
+    akhiri_transaksi();
+    snprintf(status_msg, sizeof(status_msg), "Redo berhasil");
+}
+
+/* Fungsi Seleksi */
+static void update_seleksi_status(const struct konfigurasi *cfg)
+{
+    if (!selecting) return;
+
+    int minx = sel_anchor_x < cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+    int maxx = sel_anchor_x > cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+    int miny = sel_anchor_y < cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+    int maxy = sel_anchor_y > cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+
+    /* Hitung jumlah sel yang terseleksi */
+    int count = (maxx - minx + 1) * (maxy - miny + 1);
+
+    /* Update status message */
+    snprintf(status_msg, sizeof(status_msg), "Memilih kolom %c%d - %c%d (%d Sel)",
+             'A' + minx, miny + 1, 'A' + maxx, maxy + 1, count);
+}
+
+static void aksi_seleksi(struct konfigurasi *cfg)
+{
+    selecting = 1;
+    sel_anchor_x = cfg->aktif_x;
+    sel_anchor_y = cfg->aktif_y;
+    prev_sel_x = cfg->aktif_x;
+    prev_sel_y = cfg->aktif_y;
+    snprintf(status_msg, sizeof(status_msg), "Memilih kolom %c%d",
+             'A' + cfg->aktif_x, cfg->aktif_y + 1);
+    redraw_seleksi_parsial(cfg);
+}
+
+/* Salin area x1..x2, y1..y2 ke clipboard_area. Buffer dialokasikan
+ * ulang seukuran teks area sehingga salinan kecil tetap murah */
+static int salin_area_clipboard(int x1, int y1, int x2, int y2)
+{
+    size_t n = (size_t)(x2 - x1 + 1) * (size_t)(y2 - y1 + 1);
+    size_t total = 0, i = 0, len;
+    char *buf;
+    size_t *indeks;
+    int x, y;
+
+    for (y = y1; y <= y2; y++) {
+        for (x = x1; x <= x2; x++) {
+            total += strlen(isi[y][x]) + 1;
+        }
+    }
+    buf = malloc(total);
+    indeks = malloc(n * sizeof(size_t));
+    if (!buf || !indeks) {
+        free(buf);
+        free(indeks);
+        snprintf(status_msg, sizeof(status_msg), "Memori tidak cukup untuk menyalin area");
         return -1;
     }
+    free(clipboard_area);
+    free(indeks_clip);
+    clipboard_area = buf;
+    indeks_clip = indeks;
+
+    total = 0;
+    for (y = y1; y <= y2; y++) {
+        for (x = x1; x <= x2; x++) {
+            len = strlen(isi[y][x]) + 1;
+            indeks[i++] = total;
+            memcpy(buf + total, isi[y][x], len);
+            total += len;
+        }
+    }
+    clip_x1 = x1;
+    clip_y1 = y1;
+    clip_x2 = x2;
+    clip_y2 = y2;
+    clip_has_area = 1;
+    return 0;
+}
+
+static void akhiri_seleksi(struct konfigurasi *cfg)
+{
+    if (!selecting) return;
+
+    selecting = 0;
+
+    /* Simpan area yang terseleksi ke clipboard */
+    int minx = sel_anchor_x < cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+    int maxx = sel_anchor_x > cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
+    int miny = sel_anchor_y < cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+    int maxy = sel_anchor_y > cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
+
+    salin_area_clipboard(minx, miny, maxx, maxy);
+
+    render(cfg);
+}
+
+/* Fungsi Copy */
+static void aksi_copy(struct konfigurasi *cfg)
+{
+    int x1, y1, x2, y2;
+    int minx, maxx, miny, maxy;
+
+    if (selecting) {
+        x1 = sel_anchor_x;
+        y1 = sel_anchor_y;
+        x2 = cfg->aktif_x;
+        y2 = cfg->aktif_y;
+
+        if (x1 > x2) {
+            int t = x1;
+            x1 = x2;
+            x2 = t;
+        }
+        if (y1 > y2) {
+            int t = y1;
+            y1 = y2;
+            y2 = t;
+        }
+
+        selecting = 0;
+        sel_anchor_x = sel_anchor_y = -1;
+        prev_sel_x = -1;
+        prev_sel_y = -1;
+        if (salin_area_clipboard(x1, y1, x2, y2) == 0) {
+            snprintf(status_msg, sizeof(status_msg), "Area disalin");
+        }
+    } else {
+        /* Single cell copy */
+        strncpy(clipboard, isi[cfg->aktif_y][cfg->aktif_x], MAX_TEXT - 1);
+        clipboard[MAX_TEXT - 1] = '\0';
+        salin_area_clipboard(cfg->aktif_x, cfg->aktif_y, cfg->aktif_x, cfg->aktif_y);
+        snprintf(status_msg, sizeof(status_msg), "Sel %c%d disalin",
+                 'A' + cfg->aktif_x, cfg->aktif_y + 1);
+    }
+}
+
+/* Fungsi Cut */
+static void aksi_cut(struct konfigurasi *cfg)
+{
+    int x1, y1, x2, y2, xx, yy;
+    int minx, maxx, miny, maxy;
+
+    if (selecting) {
+        x1 = sel_anchor_x;
+        y1 = sel_anchor_y;
+        x2 = cfg->aktif_x;
+        y2 = cfg->aktif_y;
+
+        if (x1 > x2) {
+            int t = x1;
+            x1 = x2;
+            x2 = t;
+        }
+        if (y1 > y2) {
+            int t = y1;
+            y1 = y2;
+            y2 = t;
+        }
+
+        selecting = 0;
+        sel_anchor_x = sel_anchor_y = -1;
+        prev_sel_x = -1;
+        prev_sel_y = -1;
+        if (salin_area_clipboard(x1, y1, x2, y2) != 0) {
+            return;
+        }
+        for (yy = y1; yy <= y2; yy++) {
+            for (xx = x1; xx <= x2; xx++) {
+                set_cell_text(cfg, xx, yy, "", 1);
+            }
+        }
+        snprintf(status_msg, sizeof(status_msg), "Area dipotong");
+    } else {
+        /* Single cell cut */
+        strncpy(clipboard, isi[cfg->aktif_y][cfg->aktif_x], MAX_TEXT - 1);
+        clipboard[MAX_TEXT - 1] = '\0';
+        salin_area_clipboard(cfg->aktif_x, cfg->aktif_y, cfg->aktif_x, cfg->aktif_y);
+        set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, "", 1);
+        snprintf(status_msg, sizeof(status_msg), "Sel %c%d dipotong",
+                 'A' + cfg->aktif_x, cfg->aktif_y + 1);
+    }
+}
+
+/* Fungsi Paste */
+static void aksi_paste(struct konfigurasi *cfg)
+{
+    int src_w, src_h, dx, dy;
+
+    if (clip_has_area) {
+        src_w = clip_x2 - clip_x1 + 1;
+        src_h = clip_y2 - clip_y1 + 1;
+        for (dy = 0; dy < src_h; dy++) {
+            for (dx = 0; dx < src_w; dx++) {
+                int tx = cfg->aktif_x + dx;
+                int ty = cfg->aktif_y + dy;
+                if (tx >= 0 && tx < cfg->kolom && ty >= 0 && ty < cfg->baris) {
+                    set_cell_text(cfg, tx, ty, clipboard_area + indeks_clip[dy * src_w + dx], 1);
+                }
+            }
+        }
+        /* Hapus penanda hijau setelah paste */
+        clip_has_area = 0;
+        snprintf(status_msg, sizeof(status_msg), "Area ditempel");
+    } else {
+        set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, clipboard, 1);
+        snprintf(status_msg, sizeof(status_msg), "Sel ditempel");
+    }
+}
+
+/* Fungsi Resize Kolom */
+static void aksi_resize_kolom(struct konfigurasi *cfg, int arah)
+{
+    if (arah > 0) {
+        if (lebar_kolom[cfg->aktif_x] < 30) {
+            lebar_kolom[cfg->aktif_x]++;
+            versi_lebar++;
+            snprintf(status_msg, sizeof(status_msg), "Lebar kolom %c: %d",
+                     'A' + cfg->aktif_x, lebar_kolom[cfg->aktif_x]);
+        } else {
+            snprintf(status_msg, sizeof(status_msg), "Lebar kolom maksimal");
+        }
+    } else {
+        if (lebar_kolom[cfg->aktif_x] > 3) {
+            lebar_kolom[cfg->aktif_x]--;
+            versi_lebar++;
+            snprintf(status_msg, sizeof(status_msg), "Lebar kolom %c: %d",
+                     'A' + cfg->aktif_x, lebar_kolom[cfg->aktif_x]);
+        } else {
+            snprintf(status_msg, sizeof(status_msg), "Lebar kolom minimal");
+        }
+    }
+}
+
+/* Fungsi Resize Baris */
+static void aksi_resize_baris(struct konfigurasi *cfg, int arah)
+{
+    if (arah > 0) {
+        if (tinggi_baris[cfg->aktif_y] < 10) {
+            tinggi_baris[cfg->aktif_y]++;
+            snprintf(status_msg, sizeof(status_msg), "Tinggi baris %d: %d",
+                     cfg->aktif_y + 1, tinggi_baris[cfg->aktif_y]);
+        } else {
+            snprintf(status_msg, sizeof(status_msg), "Tinggi baris maksimal");
+        }
+    } else {
+        if (tinggi_baris[cfg->aktif_y] > 1) {
+            tinggi_baris[cfg->aktif_y]--;
+            snprintf(status_msg, sizeof(status_msg), "Tinggi baris %d: %d",
+                     cfg->aktif_y + 1, tinggi_baris[cfg->aktif_y]);
+        } else {
+            snprintf(status_msg, sizeof(status_msg), "Tinggi baris minimal");
+        }
+    }
+}
+
+/* Fungsi Goto Cell */
+static void aksi_goto_cell(struct konfigurasi *cfg)
+{
+    char buf[16];
+    int i = 0;
+    unsigned char ch;
+    int x = -1, y = -1;
+
+    pos(2, tinggi_terminal());
+    tulis_teks("Goto: ", 6);
+    flush();
+
+    while (i < 15 && baca_input(&ch) > 0) {
+        if (ch == '\n' || ch == '\r') {
+            break;
+        }
+        if (ch >= 'a' && ch <= 'z') {
+            ch = ch - 'a' + 'A';
+        }
+        if ((ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')) {
+            buf[i++] = ch;
+            tulis_teks(&ch, 1);
+            flush();
+        }
+    }
+    buf[i] = '\0';
+
+    if (i > 0) {
+        if (buf[0] >= 'A' && buf[0] <= 'Z') {
+            x = buf[0] - 'A';
+            if (i > 1) {
+                y = atoi(buf + 1) - 1;
+            }
+        }
+
+        if (x >= 0 && x < cfg->kolom && y >= 0 && y < cfg->baris) {
+            cfg->prev_x = cfg->aktif_x;
+            cfg->prev_y = cfg->aktif_y;
+            cfg->aktif_x = x;
+            cfg->aktif_y = y;
+            ensure_active_visible(cfg);
+            snprintf(status_msg, sizeof(status_msg), "Pindah ke sel %c%d",
+                     'A' + x, y + 1);
+        } else {
+            snprintf(status_msg, sizeof(status_msg), "Sel tidak valid: %s", buf);
+        }
+    }
+}
+
+/* Fungsi Simpan File */
+static void aksi_simpan_file(struct konfigurasi *cfg)
+{
+    char nama_file[MAX_NAMA_FILE];
+    int i = 0;
+    unsigned char ch;
+    int format_csv = 0; /* 0 = txt, 1 = csv */
+
+    pos(2, tinggi_terminal());
+    tulis_teks("Simpan (format: .txt atau .csv): ", 32);
+    flush();
+
+    while (i < MAX_NAMA_FILE - 1 && baca_input(&ch) > 0) {
+        if (ch == '\n' || ch == '\r') {
+            break;
+        }
+        if (ch >= 0x20 && ch <= 0x7E) {
+            nama_file[i++] = ch;
+            tulis_teks(&ch, 1);
+            flush();
+        }
+    }
+    nama_file[i] = '\0';
+
+    /* Periksa ekstensi file */
+    format_csv = akhiran_csv(nama_file);
+
+    if (i > 0) {
+        int st;
+        if (format_csv) {
+            st = simpan_csv(nama_file, cfg, 0);
+        } else {
+            st = simpan_txt(nama_file, cfg, 0);
+        }
+        if (st == 0) {
+            catat_dasar_file(cfg, nama_file, format_csv);
+        }
+    }
+}
 
-    while (fgets(baris, sizeof(baris), file) && y < cfg->baris) {
-        token = strtok(baris, ",\n");
-        x = 0;
+/* Fungsi Buka File */
+static void aksi_buka_file(struct konfigurasi *cfg)
+{
+    char nama_file[MAX_NAMA_FILE];
+    int i = 0;
+    unsigned char ch;
+    int format_csv = 0; /* 0 = txt, 1 = csv */
 
-        while (token && x < cfg->kolom) {
-            /* Hapus kutipan jika ada */
-            if (token[0] == '"') {
-                size_t len = strlen(token);
-                if (len > 1 && token[len - 1] == '"') {
-                    token[len - 1] = '\0';
-                    token++;
-                }
-            }
+    pos(2, tinggi_terminal());
+    tulis_teks("Buka (format: .txt atau .csv): ", 30);
+    flush();
 
-            strncpy(isi[y][x], token, MAX_TEXT - 1);
-            isi[y][x][MAX_TEXT - 1] = '\0';
-            x++;
-            token = strtok(NULL, ",\n");
+    while (i < MAX_NAMA_FILE - 1 && baca_input(&ch) > 0) {
+        if (ch == '\n' || ch == '\r') {
+            break;
         }
-
-        if (x > max_x) {
-            max_x = x;
+        if (ch >= 0x20 && ch <= 0x7E) {
+            nama_file[i++] = ch;
+            tulis_teks(&ch, 1);
+            flush();
         }
-        y++;
     }
+    nama_file[i] = '\0';
 
-    fclose(file);
+    /* Periksa ekstensi file */
+    format_csv = akhiran_csv(nama_file);
 
-    /* Update ukuran grid jika perlu */
-    if (max_x > cfg->kolom) {
-        cfg->kolom = max_x;
-    }
-    if (y > cfg->baris) {
-        cfg->baris = y;
+    if (i > 0) {
+        int n;
+        if (format_csv) {
+            n = baca_csv(nama_file, cfg);
+        } else {
+            n = baca_txt(nama_file, cfg);
+        }
+        if (n >= 0) {
+            catat_dasar_file(cfg, nama_file, format_csv);
+        }
     }
-
-    snprintf(status_msg, sizeof(status_msg), "File CSV dibaca: %s", nama_file);
-    return 0;
 }
 
-static int baca_txt(const char *nama_file, struct konfigurasi *cfg)
+/* Fungsi Bantuan */
+static void aksi_bantuan(void)
 {
-    FILE *file = fopen(nama_file, "r");
-    char baris[MAX_TEXT * MAKS_KOLOM];
-    int y = 0;
-    int max_x = 0;
-    char *token;
-    int x;
+    int rows = tinggi_terminal();
+    const char *help[] = {
+        "=== Bantuan TABEL v0.7 ===",
+        "",
+        "Navigasi:",
+        "  Panah ←↑→↓  : pindah sel",
+        "",
+        "Edit:",
+        "  Enter       : edit sel",
+        "  Tab         : commit & pindah ke sel berikutnya (dalam mode edit)",
+        "  :           : command line untuk formula",
+        "",
+        "Formula:",
+        "  :SUM A1 A8 (juga AVG COUNT MIN MAX)",
+        "  :VLOOKUP k A1 C50 3 / :MATCH k A1 A50",
+        "  :XLOOKUP k A1 A50 C1 C50",
+        "  :SORT B desc, A asc : sort seleksi/sheet",
+        "  :SORTFILE in.csv out.csv B desc : sort file besar",
+        "  :FILTER B = x / B ~ x / B 1 9 / OFF : auto-filter",
+        "  :PIVOT A SUM C AVG D KE H1 : ringkasan per grup",
+        "  :WARNA 16 / 256 / 24 : palet warna terminal",
+        "  :FREEZE 1 2 / :FREEZE / OFF : bekukan baris & kolom",
+        "  :MAKRO SIMPAN a f / BUKA a f / PUTAR a 100 : makro",
+        "  :SOCKET /tmp/tabel.sock / OFF : server GET/SET/EVAL",
+        "  :SHEET BARU x / HAPUS / NAMA x / 2 : sheet workbook",
+        "  :GAYA [KOLOM] KANAN TEBAL ANGKA 2 WARNA MERAH / RESET : format",
+        "",
+        "File:",
+        "  w           : simpan file",
+        "  e           : buka file",
+        "  ] / [       : sheet berikut / sebelumnya",
+        "",
+        "Seleksi & Clipboard:",
+        "  v           : mulai/batal seleksi area",
+        "  y / x / p   : copy / cut / paste",
+        "",
+        "Resize:",
+        "  Alt+←→      : ubah lebar kolom",
+        "  Alt+↑↓      : ubah tinggi baris",
+        "",
+        "Lainnya:",
+        "  u / U       : undo / redo",
+        "  s / S       : sort naik / turun kolom aktif",
+        "  g{col}{row} : lompat ke sel (ga25 → A25)",
+        "  m{a-z} / m  : mulai / selesai rekam makro",
+        "  @{a-z}      : putar ulang makro",
+        "  h           : HUD kinerja di status bar",
+        "  q           : keluar",
+    };
+    int n = (int)(sizeof(help) / sizeof(help[0])), i;
+    unsigned char ch;
     
-    if (!file) {
-        snprintf(status_msg, sizeof(status_msg), "Gagal membuka file: %s", nama_file);
-        return -1;
+    bersih();
+    for (i = 0; i < n && i < rows - 2; i++) {
+        pos(2, 2 + i);
+        tulis_teks(help[i], strlen(help[i]));
     }
+    pos(2, rows - 1);
+    tulis_teks("Tekan tombol apapun untuk kembali...", 36);
+    flush();
+    baca_input(&ch);
+}
 
-    while (fgets(baris, sizeof(baris), file) && y < cfg->baris) {
-        token = strtok(baris, "\t\n");
-        x = 0;
+/* ============================================================
+ * Fungsi Inisialisasi
+ * ============================================================ */
+static int inisialisasi_data(struct konfigurasi *cfg, int argc, char **argv)
+{
+    int i;
+    int k, b;
 
-        while (token && x < cfg->kolom) {
-            strncpy(isi[y][x], token, MAX_TEXT - 1);
-            isi[y][x][MAX_TEXT - 1] = '\0';
-            x++;
-            token = strtok(NULL, "\t\n");
-        }
+    cfg->kolom = 10;
+    cfg->baris = 10;
+    cfg->aktif_x = 0;
+    cfg->aktif_y = 0;
+    cfg->view_col = 0;
+    cfg->view_row = 0;
+    cfg->prev_x = 0;
+    cfg->prev_y = 0;
 
-        if (x > max_x) {
-            max_x = x;
+    if (argc >= 3) {
+        k = atoi(argv[1]);
+        b = atoi(argv[2]);
+        if (k <= 0 || b <= 0) {
+            return -1;
         }
-        y++;
+        if (k > MAKS_KOLOM) {
+            k = MAKS_KOLOM;
+        }
+        if (b > MAKS_BARIS) {
+            b = MAKS_BARIS;
+        }
+        cfg->kolom = k;
+        cfg->baris = b;
     }
 
-    fclose(file);
+    /* Sheet lama dibuang; baris sheet baru dialokasikan saat pertama
+     * ditulis sehingga start tidak menyentuh halaman sebanyak KOL x BAR */
+    while (jumlah_sheet > 0) {
+        buang_sheet(jumlah_sheet - 1);
+    }
+    if (buat_sheet("Sheet1", cfg->kolom, cfg->baris) < 0) {
+        return -1;
+    }
+    pasang_sheet(0);
+    file_pantau[0] = '\0';
 
-    /* Update ukuran grid jika perlu */
-    if (max_x > cfg->kolom) {
-        cfg->kolom = max_x;
+    for (i = 0; i < cfg->kolom; i++) {
+        lebar_kolom[i] = 8;
     }
-    if (y > cfg->baris) {
-        cfg->baris = y;
+    versi_lebar++;
+    versi_isi++;
+    for (i = 0; i < cfg->baris; i++) {
+        tinggi_baris[i] = 1;
     }
 
-    snprintf(status_msg, sizeof(status_msg), "File TXT dibaca: %s", nama_file);
+    clipboard[0] = '\0';
+    undo_top = 0;
+    redo_top = 0;
+    selecting = 0;
+    sel_anchor_x = sel_anchor_y = -1;
+    prev_sel_x = prev_sel_y = -1;
+    clip_has_area = 0;
+    clip_x1 = clip_y1 = clip_x2 = clip_y2 = -1;
+
     return 0;
 }
 
 /* ============================================================
- * Fungsi Aksi Modular
+ * Fungsi Server Soket
  * ============================================================ */
-
-/* Fungsi Undo */
-static void aksi_undo(struct konfigurasi *cfg)
+/* Protokol baris teks, satu permintaan per baris:
+ *   GET A1            -> OK nilai
+ *   GET A1 C3         -> OK 3 3, lalu tiap baris sel dipisah TAB
+ *   SET A1 a<TAB>b    -> OK 2; nilai ber-TAB mengisi sel ke kanan
+ *   EVAL SUM A1 A8    -> OK 36.00, formula/lookup tanpa menulis sel
+ * Kesalahan dijawab "ERR pesan". Semua SET dalam satu siklus poll
+ * menjadi satu langkah undo dan paling banyak satu frame */
+static void tutup_klien(struct klien_soket *k)
 {
-    if (undo_top <= 0) {
-        snprintf(status_msg, sizeof(status_msg), "Tidak ada yang bisa di-undo");
-        return;
-    }
-
-    undo_top--;
-    {
-        struct op op = undo_stack[undo_top];
-        if (redo_top >= UNDO_MAX) {
-            redo_top = UNDO_MAX - 1;
-        }
-        redo_stack[redo_top].x = op.x;
-        redo_stack[redo_top].y = op.y;
-        strncpy(redo_stack[redo_top].before, isi[op.y][op.x], MAX_TEXT - 1);
-        redo_stack[redo_top].before[MAX_TEXT - 1] = '\0';
-        strncpy(redo_stack[redo_top].after, op.after, MAX_TEXT - 1);
-        redo_stack[redo_top].after[MAX_TEXT - 1] = '\0';
-        redo_top++;
-        strncpy(isi[op.y][op.x], op.before, MAX_TEXT - 1);
-        isi[op.y][op.x][MAX_TEXT - 1] = '\0';
-    }
-    snprintf(status_msg, sizeof(status_msg), "Undo berhasil");
+    close(k->fd);
+    k->fd = -1;
+    bersihkan_buffer(&k->masuk);
+    bersihkan_buffer(&k->keluar);
 }
 
-/* Fungsi Redo */
-static void aksi_redo(struct konfigurasi *cfg)
+static int atur_nonblok(int fd)
 {
-    if (redo_top <= 0) {
-        snprintf(status_msg, sizeof(status_msg), "Tidak ada yang bisa di-redo");
-        return;
-    }
-
-    redo_top--;
-    {
-        struct op op = redo_stack[redo_top];
-        push_undo(op.x, op.y, isi[op.y][op.x], op.after);
-        strncpy(isi[op.y][op.x], op.after, MAX_TEXT - 1);
-        isi[op.y][op.x][MAX_TEXT - 1] = '\0';
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) {
+        return -1;
     }
-    snprintf(status_msg, sizeof(status_msg), "Redo berhasil");
-}
-
-/* Fungsi Seleksi */
-static void update_seleksi_status(const struct konfigurasi *cfg)
-{
-    if (!selecting) return;
-
-    int minx = sel_anchor_x < cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
-    int maxx = sel_anchor_x > cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
-    int miny = sel_anchor_y < cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
-    int maxy = sel_anchor_y > cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
-
-    /* Hitung jumlah sel yang terseleksi */
-    int count = (maxx - minx + 1) * (maxy - miny + 1);
-
-    /* Update status message */
-    snprintf(status_msg, sizeof(status_msg), "Memilih kolom %c%d - %c%d (%d Sel)",
-             'A' + minx, miny + 1, 'A' + maxx, maxy + 1, count);
-}
-
-static void aksi_seleksi(struct konfigurasi *cfg)
-{
-    selecting = 1;
-    sel_anchor_x = cfg->aktif_x;
-    sel_anchor_y = cfg->aktif_y;
-    prev_sel_x = cfg->aktif_x;
-    prev_sel_y = cfg->aktif_y;
-    snprintf(status_msg, sizeof(status_msg), "Memilih kolom %c%d",
-             'A' + cfg->aktif_x, cfg->aktif_y + 1);
-    redraw_seleksi_parsial(cfg);
+    return fcntl(fd, F_SETFD, FD_CLOEXEC);
 }
 
-static void akhiri_seleksi(struct konfigurasi *cfg)
+static int buka_server_soket(const char *jalur)
 {
-    if (!selecting) return;
-
-    selecting = 0;
-
-    /* Simpan area yang terseleksi ke clipboard */
-    int minx = sel_anchor_x < cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
-    int maxx = sel_anchor_x > cfg->aktif_x ? sel_anchor_x : cfg->aktif_x;
-    int miny = sel_anchor_y < cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
-    int maxy = sel_anchor_y > cfg->aktif_y ? sel_anchor_y : cfg->aktif_y;
-
-    clip_x1 = minx;
-    clip_y1 = miny;
-    clip_x2 = maxx;
-    clip_y2 = maxy;
-    clip_has_area = 1;
+    struct sockaddr_un alamat;
+    struct stat st;
+    int fd, i;
 
-    /* Salin isi sel ke clipboard_area */
-    int r, c;
-    for (r = miny; r <= maxy; r++) {
-        for (c = minx; c <= maxx; c++) {
-            strncpy(clipboard_area[r][c], isi[r][c], MAX_TEXT - 1);
-            clipboard_area[r][c][MAX_TEXT - 1] = '\0';
+    if (strlen(jalur) >= sizeof(alamat.sun_path)) {
+        snprintf(status_msg, sizeof(status_msg), "Jalur soket terlalu panjang");
+        return -1;
+    }
+    tutup_server_soket();
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || atur_nonblok(fd) != 0) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuat soket: %s", strerror(errno));
+        if (fd >= 0) {
+            close(fd);
         }
+        return -1;
     }
-
-    render(cfg);
+    memset(&alamat, 0, sizeof(alamat));
+    alamat.sun_family = AF_UNIX;
+    strcpy(alamat.sun_path, jalur);
+    /* Soket sisa sesi yang berhenti tidak wajar boleh ditimpa, file lain
+     * tidak */
+    if (lstat(jalur, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(jalur);
+    }
+    if (bind(fd, (struct sockaddr *)&alamat, sizeof(alamat)) != 0 ||
+        listen(fd, MAKS_KLIEN_SOKET) != 0) {
+        snprintf(status_msg, sizeof(status_msg), "Gagal membuka soket %s: %s",
+                 jalur, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    for (i = 0; i < MAKS_KLIEN_SOKET; i++) {
+        klien_soket[i].fd = -1;
+    }
+    soket_server = fd;
+    strcpy(jalur_soket, jalur);
+    snprintf(status_msg, sizeof(status_msg), "Soket aktif: %s", jalur);
+    return 0;
 }
 
-/* Fungsi Copy */
-static void aksi_copy(struct konfigurasi *cfg)
+static void tutup_server_soket(void)
 {
-    int x1, y1, x2, y2, xx, yy;
-    int minx, maxx, miny, maxy;
-
-    if (selecting) {
-        x1 = sel_anchor_x;
-        y1 = sel_anchor_y;
-        x2 = cfg->aktif_x;
-        y2 = cfg->aktif_y;
-
-        if (x1 > x2) {
-            int t = x1;
-            x1 = x2;
-            x2 = t;
-        }
-        if (y1 > y2) {
-            int t = y1;
-            y1 = y2;
-            y2 = t;
-        }
-
-        clip_x1 = x1;
-        clip_y1 = y1;
-        clip_x2 = x2;
-        clip_y2 = y2;
-        clip_has_area = 1;
-
-        for (yy = y1; yy <= y2; yy++) {
-            for (xx = x1; xx <= x2; xx++) {
-                strncpy(clipboard_area[yy][xx], isi[yy][xx], MAX_TEXT - 1);
-                clipboard_area[yy][xx][MAX_TEXT - 1] = '\0';
-            }
-        }
-
-        selecting = 0;
-        sel_anchor_x = sel_anchor_y = -1;
-        prev_sel_x = -1;
-        prev_sel_y = -1;
-        snprintf(status_msg, sizeof(status_msg), "Area disalin");
-    } else {
-        /* Single cell copy */
-        strncpy(clipboard, isi[cfg->aktif_y][cfg->aktif_x], MAX_TEXT - 1);
-        clipboard[MAX_TEXT - 1] = '\0';
-        clip_x1 = clip_x2 = cfg->aktif_x;
-        clip_y1 = clip_y2 = cfg->aktif_y;
-        strncpy(clipboard_area[clip_y1][clip_x1], clipboard, MAX_TEXT - 1);
-        clipboard_area[clip_y1][clip_x1][MAX_TEXT - 1] = '\0';
-        clip_has_area = 1;
-        snprintf(status_msg, sizeof(status_msg), "Sel %c%d disalin",
-                 'A' + cfg->aktif_x, cfg->aktif_y + 1);
+    int i;
+    if (soket_server < 0) {
+        return;
+    }
+    for (i = 0; i < MAKS_KLIEN_SOKET; i++) {
+        if (klien_soket[i].fd >= 0) {
+            tutup_klien(&klien_soket[i]);
+        }
     }
+    close(soket_server);
+    unlink(jalur_soket);
+    soket_server = -1;
+    jalur_soket[0] = '\0';
 }
 
-/* Fungsi Cut */
-static void aksi_cut(struct konfigurasi *cfg)
+static void terima_klien(void)
 {
-    int x1, y1, x2, y2, xx, yy;
-    int minx, maxx, miny, maxy;
-
-    if (selecting) {
-        x1 = sel_anchor_x;
-        y1 = sel_anchor_y;
-        x2 = cfg->aktif_x;
-        y2 = cfg->aktif_y;
-
-        if (x1 > x2) {
-            int t = x1;
-            x1 = x2;
-            x2 = t;
+    int fd, i;
+    while ((fd = accept(soket_server, NULL, NULL)) >= 0) {
+        for (i = 0; i < MAKS_KLIEN_SOKET && klien_soket[i].fd >= 0; i++) {
         }
-        if (y1 > y2) {
-            int t = y1;
-            y1 = y2;
-            y2 = t;
+        if (i == MAKS_KLIEN_SOKET || atur_nonblok(fd) != 0) {
+            close(fd);
+            continue;
         }
+        klien_soket[i].fd = fd;
+        klien_soket[i].masuk.size = 0;
+        klien_soket[i].keluar.size = 0;
+    }
+}
 
-        clip_x1 = x1;
-        clip_y1 = y1;
-        clip_x2 = x2;
-        clip_y2 = y2;
-        clip_has_area = 1;
+static void jawab_klien(struct klien_soket *k, const char *teks)
+{
+    tulis_buffer(&k->keluar, teks, strlen(teks));
+}
 
-        for (yy = y1; yy <= y2; yy++) {
-            for (xx = x1; xx <= x2; xx++) {
-                strncpy(clipboard_area[yy][xx], isi[yy][xx], MAX_TEXT - 1);
-                clipboard_area[yy][xx][MAX_TEXT - 1] = '\0';
-                set_cell_text(cfg, xx, yy, "", 1);
-            }
+/* Kirim jawaban sebanyak yang diterima soket; -1 jika koneksi putus */
+static int kirim_klien(struct klien_soket *k)
+{
+    size_t terkirim = 0;
+    while (terkirim < k->keluar.size) {
+        ssize_t n = send(k->fd, k->keluar.data + terkirim, k->keluar.size - terkirim,
+                         MSG_NOSIGNAL);
+        if (n > 0) {
+            terkirim += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return -1;
         }
+    }
+    if (terkirim > 0) {
+        memmove(k->keluar.data, k->keluar.data + terkirim, k->keluar.size - terkirim);
+        k->keluar.size -= terkirim;
+    }
+    return k->keluar.size > MAKS_KELUARAN_SOKET ? -1 : 0;
+}
 
-        selecting = 0;
-        sel_anchor_x = sel_anchor_y = -1;
-        prev_sel_x = -1;
-        prev_sel_y = -1;
-        snprintf(status_msg, sizeof(status_msg), "Area dipotong");
-    } else {
-        /* Single cell cut */
-        strncpy(clipboard, isi[cfg->aktif_y][cfg->aktif_x], MAX_TEXT - 1);
-        clipboard[MAX_TEXT - 1] = '\0';
-        clip_x1 = clip_x2 = cfg->aktif_x;
-        clip_y1 = clip_y2 = cfg->aktif_y;
-        strncpy(clipboard_area[clip_y1][clip_x1], clipboard, MAX_TEXT - 1);
-        clipboard_area[clip_y1][clip_x1][MAX_TEXT - 1] = '\0';
-        clip_has_area = 1;
-        set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, "", 1);
-        snprintf(status_msg, sizeof(status_msg), "Sel %c%d dipotong",
-                 'A' + cfg->aktif_x, cfg->aktif_y + 1);
+/* Potret baris y sebelum SET pertama siklus ini mengubahnya */
+static int potret_baris_soket(const struct konfigurasi *cfg, int y)
+{
+    unsigned long bit = 1UL << (y % BIT_KATA);
+
+    if (baris_potret_soket[y / BIT_KATA] & bit) {
+        return 0;
     }
+    if (!potret_soket && !(potret_soket = buat_potret(0, cfg->kolom - 1))) {
+        return -1;
+    }
+    if (potret_baris(potret_soket, y) != 0) {
+        return -1;
+    }
+    baris_potret_soket[y / BIT_KATA] |= bit;
+    return 0;
 }
 
-/* Fungsi Paste */
-static void aksi_paste(struct konfigurasi *cfg)
+/* Catat potret siklus ini sebagai satu op undo */
+static void akhiri_potret_soket(void)
 {
-    int src_w, src_h, dx, dy;
+    int i;
 
-    if (clip_has_area) {
-        src_w = clip_x2 - clip_x1 + 1;
-        src_h = clip_y2 - clip_y1 + 1;
-        for (dy = 0; dy < src_h; dy++) {
-            for (dx = 0; dx < src_w; dx++) {
-                int tx = cfg->aktif_x + dx;
-                int ty = cfg->aktif_y + dy;
-                int sx = clip_x1 + dx;
-                int sy = clip_y1 + dy;
-                if (tx >= 0 && tx < cfg->kolom && ty >= 0 && ty < cfg->baris) {
-                    set_cell_text(cfg, tx, ty, clipboard_area[sy][sx], 1);
-                }
-            }
-        }
-        /* Hapus penanda hijau setelah paste */
-        clip_has_area = 0;
-        snprintf(status_msg, sizeof(status_msg), "Area ditempel");
+    if (!potret_soket) {
+        return;
+    }
+    for (i = 0; i < potret_soket->jumlah; i++) {
+        int y = potret_soket->baris[i];
+        baris_potret_soket[y / BIT_KATA] &= ~(1UL << (y % BIT_KATA));
+    }
+    if (potret_soket->jumlah > 0) {
+        push_undo_area(potret_soket);
     } else {
-        set_cell_text(cfg, cfg->aktif_x, cfg->aktif_y, clipboard, 1);
-        snprintf(status_msg, sizeof(status_msg), "Sel ditempel");
+        buang_potret(potret_soket);
     }
+    potret_soket = NULL;
 }
 
-/* Fungsi Resize Kolom */
-static void aksi_resize_kolom(struct konfigurasi *cfg, int arah)
+/* Mengembalikan jumlah sel yang berubah */
+static int proses_permintaan_soket(struct konfigurasi *cfg, struct klien_soket *k,
+                                   const char *baris)
 {
-    if (arah > 0) {
-        if (lebar_kolom[cfg->aktif_x] < 30) {
-            lebar_kolom[cfg->aktif_x]++;
-            snprintf(status_msg, sizeof(status_msg), "Lebar kolom %c: %d",
-                     'A' + cfg->aktif_x, lebar_kolom[cfg->aktif_x]);
-        } else {
-            snprintf(status_msg, sizeof(status_msg), "Lebar kolom maksimal");
+    char teks[MAX_TEXT + 32], sel1[16], sel2[16];
+    int x1, y1, x2, y2, x, y, n, st;
+    double hasil;
+
+    if (strncmp(baris, "GET ", 4) == 0) {
+        n = sscanf(baris + 4, "%15s %15s", sel1, sel2);
+        if (n < 1 || parse_sel(cfg, sel1, &x1, &y1) != 0 ||
+            (n == 2 && parse_sel(cfg, sel2, &x2, &y2) != 0)) {
+            jawab_klien(k, "ERR sel tidak valid\n");
+            return 0;
         }
-    } else {
-        if (lebar_kolom[cfg->aktif_x] > 3) {
-            lebar_kolom[cfg->aktif_x]--;
-            snprintf(status_msg, sizeof(status_msg), "Lebar kolom %c: %d",
-                     'A' + cfg->aktif_x, lebar_kolom[cfg->aktif_x]);
+        if (n == 1) {
+            x2 = x1;
+            y2 = y1;
+        }
+        if (x2 < x1) {
+            x = x1;
+            x1 = x2;
+            x2 = x;
+        }
+        if (y2 < y1) {
+            y = y1;
+            y1 = y2;
+            y2 = y;
+        }
+        if (n == 1) {
+            jawab_klien(k, "OK ");
         } else {
-            snprintf(status_msg, sizeof(status_msg), "Lebar kolom minimal");
+            snprintf(teks, sizeof(teks), "OK %d %d\n", y2 - y1 + 1, x2 - x1 + 1);
+            jawab_klien(k, teks);
         }
+        for (y = y1; y <= y2; y++) {
+            for (x = x1; x <= x2; x++) {
+                if (x > x1) {
+                    jawab_klien(k, "\t");
+                }
+                jawab_klien(k, isi[y][x]);
+            }
+            jawab_klien(k, "\n");
+        }
+        return 0;
     }
-}
 
-/* Fungsi Resize Baris */
-static void aksi_resize_baris(struct konfigurasi *cfg, int arah)
-{
-    if (arah > 0) {
-        if (tinggi_baris[cfg->aktif_y] < 10) {
-            tinggi_baris[cfg->aktif_y]++;
-            snprintf(status_msg, sizeof(status_msg), "Tinggi baris %d: %d",
-                     cfg->aktif_y + 1, tinggi_baris[cfg->aktif_y]);
-        } else {
-            snprintf(status_msg, sizeof(status_msg), "Tinggi baris maksimal");
+    if (strncmp(baris, "SET ", 4) == 0) {
+        const char *p = baris + 4;
+        size_t len = strcspn(p, " ");
+        int berubah = 0;
+
+        if (len >= sizeof(sel1)) {
+            jawab_klien(k, "ERR sel tidak valid\n");
+            return 0;
         }
-    } else {
-        if (tinggi_baris[cfg->aktif_y] > 1) {
-            tinggi_baris[cfg->aktif_y]--;
-            snprintf(status_msg, sizeof(status_msg), "Tinggi baris %d: %d",
-                     cfg->aktif_y + 1, tinggi_baris[cfg->aktif_y]);
+        memcpy(sel1, p, len);
+        sel1[len] = '\0';
+        if (parse_sel(cfg, sel1, &x1, &y1) != 0) {
+            jawab_klien(k, "ERR sel tidak valid\n");
+            return 0;
+        }
+        p += len;
+        if (*p == ' ') {
+            p++;
+        }
+        n = 0;
+        for (x = x1; x < cfg->kolom; x++) {
+            size_t m = strcspn(p, "\t");
+            size_t salin = m < MAX_TEXT - 1 ? m : MAX_TEXT - 1;
+            memcpy(teks, p, salin);
+            teks[salin] = '\0';
+            /* Nilai sama tidak perlu mengisi undo */
+            if (strcmp(isi[y1][x], teks) != 0) {
+                if (potret_baris_soket(cfg, y1) != 0) {
+                    jawab_klien(k, "ERR memori tidak cukup\n");
+                    return berubah;
+                }
+                set_cell_text(cfg, x, y1, teks, 0);
+                berubah++;
+            }
+            n++;
+            if (p[m] != '\t') {
+                break;
+            }
+            p += m + 1;
+        }
+        snprintf(teks, sizeof(teks), "OK %d\n", n);
+        jawab_klien(k, teks);
+        return berubah;
+    }
+
+    if (strncmp(baris, "EVAL ", 5) == 0) {
+        char formula[MAX_FORMULA_LENGTH];
+        const char *e = baris + 5;
+        snprintf(formula, sizeof(formula), "%s%s", *e == ':' ? "" : ":", e);
+        st = evaluasi_lookup(cfg, formula, teks, sizeof(teks));
+        if (st == 0) {
+            jawab_klien(k, "OK ");
+            jawab_klien(k, teks);
+            jawab_klien(k, "\n");
+        } else if (st == -2) {
+            jawab_klien(k, "ERR nilai tidak ditemukan\n");
+        } else if (st == -1 || evaluasi_formula(cfg, formula, &hasil) != 0) {
+            jawab_klien(k, "ERR formula tidak valid\n");
         } else {
-            snprintf(status_msg, sizeof(status_msg), "Tinggi baris minimal");
+            snprintf(teks, sizeof(teks), "OK %.2f\n", hasil);
+            jawab_klien(k, teks);
         }
+        return 0;
     }
+
+    jawab_klien(k, "ERR perintah tidak dikenal\n");
+    return 0;
 }
 
-/* Fungsi Goto Cell */
-static void aksi_goto_cell(struct konfigurasi *cfg)
+/* Baca semua data yang tersedia lalu proses baris yang sudah lengkap;
+ * -1 jika koneksi harus ditutup */
+static int baca_klien(struct konfigurasi *cfg, struct klien_soket *k, int *berubah)
 {
-    char buf[16];
-    int i = 0;
-    unsigned char ch;
-    int x = -1, y = -1;
-
-    pos(2, tinggi_terminal());
-    tulis_teks("Goto: ", 6);
-    flush();
+    char tmp[65536];
+    size_t awal = 0;
+    ssize_t n;
+    int tutup = 0;
 
-    while (i < 15 && read(STDIN_FILENO, &ch, 1) > 0) {
-        if (ch == '\n' || ch == '\r') {
-            break;
+    while (1) {
+        n = read(k->fd, tmp, sizeof(tmp));
+        if (n > 0) {
+            tulis_buffer(&k->masuk, tmp, (size_t)n);
+            continue;
         }
-        if (ch >= 'a' && ch <= 'z') {
-            ch = ch - 'a' + 'A';
+        if (n < 0 && errno == EINTR) {
+            continue;
         }
-        if ((ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')) {
-            buf[i++] = ch;
-            tulis_teks(&ch, 1);
-            flush();
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            tutup = 1;
         }
+        break;
     }
-    buf[i] = '\0';
 
-    if (i > 0) {
-        if (buf[0] >= 'A' && buf[0] <= 'Z') {
-            x = buf[0] - 'A';
-            if (i > 1) {
-                y = atoi(buf + 1) - 1;
-            }
+    while (awal < k->masuk.size) {
+        char *baris = k->masuk.data + awal;
+        char *akhir = memchr(baris, '\n', k->masuk.size - awal);
+        if (!akhir) {
+            break;
         }
+        *akhir = '\0';
+        if (akhir > baris && akhir[-1] == '\r') {
+            akhir[-1] = '\0';
+        }
+        *berubah += proses_permintaan_soket(cfg, k, baris);
+        awal = (size_t)(akhir - k->masuk.data) + 1;
+    }
+    if (awal > 0) {
+        memmove(k->masuk.data, k->masuk.data + awal, k->masuk.size - awal);
+        k->masuk.size -= awal;
+    }
+    if (k->masuk.size > MAKS_BARIS_SOKET) {
+        jawab_klien(k, "ERR baris terlalu panjang\n");
+        tutup = 1;
+    }
+    if (kirim_klien(k) != 0) {
+        return -1;
+    }
+    return tutup ? -1 : 0;
+}
 
-        if (x >= 0 && x < cfg->kolom && y >= 0 && y < cfg->baris) {
-            cfg->prev_x = cfg->aktif_x;
-            cfg->prev_y = cfg->aktif_y;
-            cfg->aktif_x = x;
-            cfg->aktif_y = y;
-            ensure_active_visible(cfg);
-            snprintf(status_msg, sizeof(status_msg), "Pindah ke sel %c%d",
-                     'A' + x, y + 1);
-        } else {
-            snprintf(status_msg, sizeof(status_msg), "Sel tidak valid: %s", buf);
+/* Daftarkan listener dan klien ke pfd; idx mencatat klien tiap entri */
+static int isi_pfd_soket(struct pollfd *pfd, int *idx)
+{
+    int n = 0, i;
+
+    pfd[n].fd = soket_server;
+    pfd[n].events = POLLIN;
+    pfd[n].revents = 0;
+    idx[n] = -1;
+    n++;
+    for (i = 0; i < MAKS_KLIEN_SOKET; i++) {
+        if (klien_soket[i].fd >= 0) {
+            pfd[n].fd = klien_soket[i].fd;
+            pfd[n].events = POLLIN | (klien_soket[i].keluar.size > 0 ? POLLOUT : 0);
+            pfd[n].revents = 0;
+            idx[n] = i;
+            n++;
         }
     }
+    return n;
 }
 
-/* Fungsi Simpan File */
-static void aksi_simpan_file(struct konfigurasi *cfg)
+/* Layani hasil poll; semua SET dalam satu siklus menjadi satu langkah
+ * undo. Mengembalikan jumlah sel yang berubah */
+static int layani_pfd_soket(struct konfigurasi *cfg, const struct pollfd *pfd,
+                            const int *idx, int n)
 {
-    char nama_file[MAX_NAMA_FILE];
-    int i = 0;
-    unsigned char ch;
-    int format_csv = 0; /* 0 = txt, 1 = csv */
+    int berubah = 0, i;
 
-    pos(2, tinggi_terminal());
-    tulis_teks("Simpan (format: .txt atau .csv): ", 32);
-    flush();
+    if (pfd[0].revents & POLLIN) {
+        terima_klien();
+    }
+    for (i = 1; i < n; i++) {
+        struct klien_soket *k = &klien_soket[idx[i]];
+        int st = 0;
+        if (pfd[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+            st = baca_klien(cfg, k, &berubah);
+        } else if (pfd[i].revents & POLLOUT) {
+            st = kirim_klien(k);
+        }
+        if (st != 0) {
+            tutup_klien(k);
+        }
+    }
+    akhiri_potret_soket();
+    return berubah;
+}
 
-    while (i < MAX_NAMA_FILE - 1 && read(STDIN_FILENO, &ch, 1) > 0) {
-        if (ch == '\n' || ch == '\r') {
-            break;
+/* ============================================================
+ * Fungsi Tail
+ * ============================================================ */
+/* tabel -f FILE|- [-n BARIS]: baris yang ditambahkan ke sumber diurai
+ * per potongan tanpa membaca ulang file. File biasa diperiksa tiap
+ * INTERVAL_TAIL_MS, pipa ikut di-poll. Bila -n tercapai, baris tertua
+ * dibuang per 1/8 kapasitas sehingga memori tetap */
+static int buka_tail(const char *nama, int batas)
+{
+    struct stat st;
+    int fd;
+
+    if (strcmp(nama, "-") == 0) {
+        /* Data dari pipa di stdin; keyboard diambil dari /dev/tty */
+        int tty;
+        if (isatty(STDIN_FILENO)) {
+            fprintf(stderr, "-f - butuh data dari pipa\n");
+            return -1;
         }
-        if (ch >= 0x20 && ch <= 0x7E) {
-            nama_file[i++] = ch;
-            tulis_teks(&ch, 1);
-            flush();
+        fd = dup(STDIN_FILENO);
+        tty = open("/dev/tty", O_RDWR);
+        if (fd < 0 || tty < 0 || dup2(tty, STDIN_FILENO) < 0) {
+            fprintf(stderr, "Gagal membuka /dev/tty: %s\n", strerror(errno));
+            return -1;
+        }
+        close(tty);
+        tail_csv = 1;
+    } else {
+        fd = open(nama, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Gagal membuka file: %s\n", nama);
+            return -1;
         }
+        tail_csv = akhiran_csv(nama);
     }
-    nama_file[i] = '\0';
+    if (fstat(fd, &st) != 0 || atur_nonblok(fd) != 0 ||
+        inisialisasi_buffer(&tail_sisa, POTONGAN_TAIL * 2) != 0) {
+        close(fd);
+        fprintf(stderr, "Gagal membuka sumber tail: %s\n", nama);
+        return -1;
+    }
+    tail_fd = fd;
+    tail_pipa = !S_ISREG(st.st_mode);
+    tail_offset = 0;
+    tail_ada_lagi = 1;
+    tail_baris = 0;
+    tail_dibuang = 0;
+    tail_batas = (batas > 0 && batas < MAKS_BARIS) ? batas : MAKS_BARIS;
+    return 0;
+}
 
-    /* Periksa ekstensi file */
-    if (i > 4 && nama_file[i - 4] == '.' && 
-        (nama_file[i - 3] == 'c' || nama_file[i - 3] == 'C') &&
-        (nama_file[i - 2] == 's' || nama_file[i - 2] == 'S') &&
-        (nama_file[i - 1] == 'v' || nama_file[i - 1] == 'V')) {
-        format_csv = 1;
+static void tutup_tail(void)
+{
+    if (tail_fd >= 0) {
+        close(tail_fd);
+        tail_fd = -1;
+        bersihkan_buffer(&tail_sisa);
     }
+}
 
-    if (i > 0) {
-        if (format_csv) {
-            simpan_csv(nama_file, cfg);
-        } else {
-            simpan_txt(nama_file, cfg);
-        }
+/* Milidetik sampai sumber perlu dibaca lagi; -1 = tunggu poll */
+static int jeda_tail(void)
+{
+    double sisa;
+    if (tail_ada_lagi) {
+        return 0;
+    }
+    if (tail_pipa) {
+        return -1;
     }
+    sisa = tail_cek_berikut - waktu_ms();
+    return sisa > 0 ? (int)sisa + 1 : 0;
 }
 
-/* Fungsi Buka File */
-static void aksi_buka_file(struct konfigurasi *cfg)
+/* Buang k baris tertua; posisi kursor dan viewport ikut bergeser. Undo
+ * dikosongkan karena koordinatnya tidak lagi berlaku */
+static void geser_ring_tail(struct konfigurasi *cfg, int k)
 {
-    char nama_file[MAX_NAMA_FILE];
-    int i = 0;
-    unsigned char ch;
-    int format_csv = 0; /* 0 = txt, 1 = csv */
+    int y;
 
-    pos(2, tinggi_terminal());
-    tulis_teks("Buka (format: .txt atau .csv): ", 30);
-    flush();
+    /* Cukup geser pointer baris; isi sel tidak disalin */
+    for (y = 0; y < k; y++) {
+        lepas_baris(y);
+    }
+    memmove(isi, isi + k, (size_t)(tail_baris - k) * sizeof(isi[0]));
+    memmove(tinggi_baris, tinggi_baris + k, (size_t)(tail_baris - k) * sizeof(tinggi_baris[0]));
+    geser_gaya(k);
+    for (y = tail_baris - k; y < tail_baris; y++) {
+        isi[y] = baris_kosong;
+        tinggi_baris[y] = 1;
+    }
+    tail_baris -= k;
+    tail_dibuang += k;
+    cfg->baris -= k;
 
-    while (i < MAX_NAMA_FILE - 1 && read(STDIN_FILENO, &ch, 1) > 0) {
-        if (ch == '\n' || ch == '\r') {
+    cfg->aktif_y = cfg->aktif_y > k ? cfg->aktif_y - k : 0;
+    cfg->prev_y = cfg->prev_y > k ? cfg->prev_y - k : 0;
+    cfg->view_row = cfg->view_row - k > beku_baris ? cfg->view_row - k : beku_baris;
+    selecting = 0;
+    kosongkan_undo();
+}
+
+/* Baris aktif di dasar viewport, seperti saat menggulir turun */
+static void gulir_ke_dasar(struct konfigurasi *cfg)
+{
+    int xa, ya, pad, vw, vh, cs, ce, rs, re;
+
+    ensure_active_visible(cfg);
+    while (cfg->view_row > beku_baris) {
+        int lama = cfg->view_row;
+        cfg->view_row = baris_sebelum(lama);
+        if (cfg->view_row < beku_baris) {
+            cfg->view_row = lama;
             break;
         }
-        if (ch >= 0x20 && ch <= 0x7E) {
-            nama_file[i++] = ch;
-            tulis_teks(&ch, 1);
-            flush();
+        hitung_viewport(cfg, &xa, &ya, &pad, &vw, &vh, &cs, &ce, &rs, &re);
+        if (re < cfg->aktif_y) {
+            cfg->view_row = lama;
+            break;
         }
     }
-    nama_file[i] = '\0';
+}
 
-    /* Periksa ekstensi file */
-    if (i > 4 && nama_file[i - 4] == '.' && 
-        (nama_file[i - 3] == 'c' || nama_file[i - 3] == 'C') &&
-        (nama_file[i - 2] == 's' || nama_file[i - 2] == 'S') &&
-        (nama_file[i - 1] == 'v' || nama_file[i - 1] == 'V')) {
-        format_csv = 1;
-    }
+static void tambah_baris_tail(struct konfigurasi *cfg, char *baris)
+{
+    int x, y;
 
-    if (i > 0) {
-        if (format_csv) {
-            baca_csv(nama_file, cfg);
-        } else {
-            baca_txt(nama_file, cfg);
-        }
+    if (tail_baris >= tail_batas) {
+        geser_ring_tail(cfg, tail_batas / 8 > 0 ? tail_batas / 8 : 1);
+    }
+    y = tail_baris++;
+    if (y >= cfg->baris) {
+        cfg->baris = y + 1;
+        tinggi_baris[y] = 1;
+    }
+    x = muat_baris(y, baris, tail_csv, cfg->kolom);
+    if (x < 0) {
+        return;
+    }
+    for (; x < cfg->kolom; x++) {
+        tulis_sel(x, y, "");
     }
 }
 
-/* Fungsi Bantuan */
-static void aksi_bantuan(void)
+/* Baca satu potongan dari sumber dan urai baris yang sudah lengkap.
+ * Kursor di baris data terakhir ikut turun ke baris baru */
+static int baca_tail(struct konfigurasi *cfg)
 {
-    int rows = tinggi_terminal();
-    const char *help[] = {
-        "=== Bantuan TABEL v0.7 ===",
-        "",
-        "Navigasi:",
-        "  Panah ←↑→↓  : pindah sel",
-        "",
-        "Edit:",
-        "  Enter       : edit sel",
-        "  Tab         : commit & pindah ke sel berikutnya (dalam mode edit)",
-        "  :           : command line untuk formula",
-        "",
-        "File:",
-        "  w           : simpan file",
-        "  e           : buka file",
-        "",
-        "Seleksi & Clipboard:",
-        "  v           : mulai/batal seleksi area",
-        "  y / x / p   : copy / cut / paste",
-        "",
-        "Resize:",
-        "  Alt+←→      : ubah lebar kolom",
-        "  Alt+↑↓      : ubah tinggi baris",
-        "",
-        "Lainnya:",
-        "  u / U       : undo / redo",
-        "  g{col}{row} : lompat ke sel (ga25 → A25)",
-        "  q           : keluar",
-    };
-    int n = (int)(sizeof(help) / sizeof(help[0])), i;
-    unsigned char ch;
-    
-    bersih();
-    for (i = 0; i < n && i < rows - 2; i++) {
-        pos(2, 2 + i);
-        tulis_teks(help[i], strlen(help[i]));
+    int ikut = cfg->aktif_y >= tail_baris - 1;
+    int baru = 0, selesai = 0;
+    size_t awal = 0;
+    ssize_t n;
+
+    tail_ada_lagi = 0;
+    if (!tail_pipa) {
+        struct stat st;
+        tail_cek_berikut = waktu_ms() + INTERVAL_TAIL_MS;
+        if (fstat(tail_fd, &st) == 0 && st.st_size < tail_offset) {
+            /* File dipotong (copytruncate): ikuti lagi dari awal */
+            lseek(tail_fd, 0, SEEK_SET);
+            tail_offset = 0;
+            reset_buffer(&tail_sisa);
+        }
     }
-    pos(2, rows - 1);
-    tulis_teks("Tekan tombol apapun untuk kembali...", 36);
-    flush();
-    read(STDIN_FILENO, &ch, 1);
+    if (siapkan_ruang_buffer(&tail_sisa, POTONGAN_TAIL) != 0) {
+        return 0;
+    }
+    n = read(tail_fd, tail_sisa.data + tail_sisa.size, POTONGAN_TAIL);
+    if (n > 0) {
+        tail_sisa.size += (size_t)n;
+        tail_offset += n;
+        tail_ada_lagi = (n == POTONGAN_TAIL);
+    } else if (n == 0 && tail_pipa) {
+        selesai = 1;
+    } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        selesai = 1;
+    }
+
+    while (awal < tail_sisa.size) {
+        char *baris = tail_sisa.data + awal;
+        char *akhir = memchr(baris, '\n', tail_sisa.size - awal);
+        if (!akhir) {
+            /* Baris terakhir pipa yang ditutup tanpa newline tetap dipakai;
+             * baris raksasa dipotong */
+            if (!selesai && tail_sisa.size - awal < MAX_TEXT * MAKS_KOLOM) {
+                break;
+            }
+            siapkan_ruang_buffer(&tail_sisa, 1);
+            akhir = tail_sisa.data + tail_sisa.size;
+            baris = tail_sisa.data + awal;
+        }
+        *akhir = '\0';
+        tambah_baris_tail(cfg, baris);
+        baru++;
+        awal = (size_t)(akhir - tail_sisa.data) + 1;
+    }
+    if (awal >= tail_sisa.size) {
+        reset_buffer(&tail_sisa);
+    } else if (awal > 0) {
+        memmove(tail_sisa.data, tail_sisa.data + awal, tail_sisa.size - awal);
+        tail_sisa.size -= awal;
+    }
+
+    if (baru > 0) {
+        versi_isi++;
+        invalidasi_semua_indeks();
+        if (filter_aktif) {
+            filter_baris = cfg->baris;
+            perbarui_filter();
+        }
+        if (ikut) {
+            cfg->aktif_y = tail_baris - 1;
+            gulir_ke_dasar(cfg);
+        }
+        minta_frame(FRAME_PENUH);
+    }
+    if (selesai) {
+        tutup_tail();
+        snprintf(status_msg, sizeof(status_msg), "Tail selesai: %d baris", tail_baris);
+        minta_frame(FRAME_PENUH);
+    } else if (baru > 0) {
+        snprintf(status_msg, sizeof(status_msg), "Tail: %d baris, %ld dibuang",
+                 tail_baris, tail_dibuang);
+    }
+    return baru;
 }
 
 /* ============================================================
- * Fungsi Inisialisasi
+ * Fungsi Loop Utama
  * ============================================================ */
-static int inisialisasi_data(struct konfigurasi *cfg, int argc, char **argv)
+/* Tunggu sampai stdin siap. Sementara itu klien soket dilayani dan
+ * sumber tail dibaca per potongan; frame tertunda tetap digambar per
+ * INTERVAL_FRAME_MS sehingga keyboard tidak menunggu sumber data */
+static void tunggu_input(struct konfigurasi *cfg)
 {
-    int i, xx, yy;
-    int k, b;
+    struct pollfd pfd[MAKS_KLIEN_SOKET + 3];
+    int idx[MAKS_KLIEN_SOKET + 3];
 
-    cfg->kolom = 10;
-    cfg->baris = 10;
-    cfg->aktif_x = 0;
-    cfg->aktif_y = 0;
-    cfg->view_col = 0;
-    cfg->view_row = 0;
-    cfg->prev_x = 0;
-    cfg->prev_y = 0;
+    while ((soket_server >= 0 || tail_fd >= 0 || file_pantau[0]) && !input_tersedia(0)) {
+        int n = 1, timeout = -1, i_tail = -1, i_soket = -1, t;
 
-    if (argc >= 3) {
-        k = atoi(argv[1]);
-        b = atoi(argv[2]);
-        if (k <= 0 || b <= 0) {
-            return -1;
+        if (frame_tertunda != FRAME_TIDAK) {
+            timeout = (int)(waktu_frame_terakhir + INTERVAL_FRAME_MS - waktu_ms());
+            if (timeout <= 0) {
+                gambar_frame(cfg);
+                waktu_frame_terakhir = waktu_ms();
+                continue;
+            }
         }
-        if (k > MAKS_KOLOM) {
-            k = MAKS_KOLOM;
+        if (tail_fd >= 0) {
+            t = jeda_tail();
+            if (t >= 0 && (timeout < 0 || t < timeout)) {
+                timeout = t;
+            }
         }
-        if (b > MAKS_BARIS) {
-            b = MAKS_BARIS;
+        if (file_pantau[0]) {
+            t = jeda_pantau();
+            if (timeout < 0 || t < timeout) {
+                timeout = t;
+            }
         }
-        cfg->kolom = k;
-        cfg->baris = b;
-    }
 
-    for (i = 0; i < cfg->kolom; i++) {
-        lebar_kolom[i] = 8;
-    }
-    for (i = 0; i < cfg->baris; i++) {
-        tinggi_baris[i] = 1;
-    }
-    for (yy = 0; yy < cfg->baris; yy++) {
-        for (xx = 0; xx < cfg->kolom; xx++) {
-            isi[yy][xx][0] = '\0';
-            align_sel[yy][xx] = LEFT;
+        pfd[0].fd = STDIN_FILENO;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        if (tail_fd >= 0 && tail_pipa) {
+            pfd[n].fd = tail_fd;
+            pfd[n].events = POLLIN;
+            pfd[n].revents = 0;
+            i_tail = n++;
+        }
+        if (soket_server >= 0) {
+            i_soket = n;
+            n += isi_pfd_soket(pfd + n, idx + n);
+        }
+        kinerja.syscall++;
+        if (poll(pfd, (nfds_t)n, timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (pfd[0].revents) {
+            return;
         }
-    }
-
-    clipboard[0] = '\0';
-    undo_top = 0;
-    redo_top = 0;
-    selecting = 0;
-    sel_anchor_x = sel_anchor_y = -1;
-    prev_sel_x = prev_sel_y = -1;
-    clip_has_area = 0;
-    clip_x1 = clip_y1 = clip_x2 = clip_y2 = -1;
 
-    return 0;
+        if (i_soket >= 0 &&
+            layani_pfd_soket(cfg, pfd + i_soket, idx + i_soket, n - i_soket) > 0) {
+            minta_frame(FRAME_PENUH);
+        }
+        if (tail_fd >= 0 && ((i_tail >= 0 && pfd[i_tail].revents) || jeda_tail() == 0)) {
+            baca_tail(cfg);
+        }
+        if (file_pantau[0] && jeda_pantau() == 0) {
+            periksa_file_pantau(cfg);
+        }
+    }
+    /* Sumber yang baru selesai masih menyisakan frame */
+    sajikan_frame(cfg);
 }
 
-/* ============================================================
- * Fungsi Loop Utama
- * ============================================================ */
 static int loop(struct konfigurasi *cfg)
 {
     unsigned char ch;
-    int viewport_changed = 0;
-    int old_view_col, old_view_row;
+    int span_tombol = 0;
 
     while (1) {
-        if (read(STDIN_FILENO, &ch, 1) <= 0) {
+        /* Gambar frame tertunda hanya jika tidak ada input menunggu */
+        sajikan_frame(cfg);
+        /* Span tombol sebelumnya mencakup frame yang dihasilkannya */
+        if (span_tombol) {
+            jejak_selesai();
+            span_tombol = 0;
+        }
+        if (jumlah_jejak > 0 && !input_tersedia(0)) {
+            tulis_jejak();
+        }
+        tunggu_input(cfg);
+        if (baca_input(&ch) <= 0) {
             return -1;
         }
+        jejak_mulai_tombol(ch);
+        span_tombol = 1;
+        /* Syscall sejak tombol sebelumnya: proses, frame dan tunggu */
+        kinerja.syscall_per_tombol = kinerja.syscall - kinerja.syscall_tombol;
+        kinerja.syscall_tombol = kinerja.syscall;
 
         if (ch == 'q' || ch == 'Q') {
             return 0;
@@ -2396,49 +8587,27 @@ static int loop(struct konfigurasi *cfg)
         /* Navigasi */
         if (ch == 0x1B) {
             unsigned char seq0, seq1;
-            if (read(STDIN_FILENO, &seq0, 1) <= 0) {
+            if (baca_input(&seq0) <= 0) {
                 continue;
             }
             if (seq0 == '[') {
-                if (read(STDIN_FILENO, &seq1, 1) <= 0) {
+                if (baca_input(&seq1) <= 0) {
                     continue;
                 }
 
-                old_view_col = cfg->view_col;
-                old_view_row = cfg->view_row;
-
-                if (seq1 == 'A') {
-                    move_up(cfg);
-                } else if (seq1 == 'B') {
-                    move_down(cfg);
-                } else if (seq1 == 'C') {
-                    move_right(cfg);
-                } else if (seq1 == 'D') {
-                    move_left(cfg);
-                }
-
-                /* Periksa apakah viewport perlu diubah */
-                ensure_active_visible(cfg);
-                viewport_changed = (old_view_col != cfg->view_col || 
-                                  old_view_row != cfg->view_row);
-
-                if (viewport_changed) {
-                    render(cfg);
-                } else {
-                    redraw_navigasi_parsial(cfg);
-                }
+                navigasi_panah(cfg, seq1);
                 continue;
             }
             /* Alt+arrow: ESC [ 1 ; 3 A/B/C/D */
             else if (seq0 == '1') {
                 unsigned char semi, three, dir;
-                if (read(STDIN_FILENO, &semi, 1) <= 0) {
+                if (baca_input(&semi) <= 0) {
                     continue;
                 }
-                if (read(STDIN_FILENO, &three, 1) <= 0) {
+                if (baca_input(&three) <= 0) {
                     continue;
                 }
-                if (read(STDIN_FILENO, &dir, 1) <= 0) {
+                if (baca_input(&dir) <= 0) {
                     continue;
                 }
                 if (semi == ';' && three == '3') {
@@ -2485,6 +8654,11 @@ static int loop(struct konfigurasi *cfg)
             render(cfg);
             continue;
         }
+        if (ch == ']' || ch == '[') {
+            geser_sheet(cfg, ch == ']' ? 1 : -1);
+            render(cfg);
+            continue;
+        }
         if (ch == 'y') {
             aksi_copy(cfg);
             render(cfg);
@@ -2515,13 +8689,385 @@ static int loop(struct konfigurasi *cfg)
             render(cfg);
             continue;
         }
+        if (ch == 's' || ch == 'S') {
+            struct kunci_sort kunci;
+            kunci.kolom = cfg->aktif_x;
+            kunci.menurun = (ch == 'S');
+            aksi_sort(cfg, &kunci, 1);
+            render(cfg);
+            continue;
+        }
         if (ch == '?') {
             aksi_bantuan();
             render(cfg);
             continue;
         }
+        if (ch == 'm') {
+            aksi_rekam_makro();
+            render(cfg);
+            continue;
+        }
+        if (ch == 'h') {
+            hud_aktif = !hud_aktif;
+            render(cfg);
+            continue;
+        }
+        if (ch == '@') {
+            aksi_putar_makro();
+            render(cfg);
+            continue;
+        }
+    }
+}
+
+/* ============================================================
+ * Fungsi Mode Batch
+ * ============================================================ */
+static void cetak_penggunaan(const char *prog)
+{
+    fprintf(stderr, "Penggunaan: %s [KOL] [BAR] [--socket JALUR] [-f FILE|- [-n BARIS]]\n",
+            prog);
+    fprintf(stderr, "            %s --batch MASUK [-c SEL] [-e PERINTAH]... [-o KELUARAN]\n",
+            prog);
+}
+
+/* Lebar sheet sampai kolom terakhir yang terisi di cfg->baris baris */
+static void pas_kolom_batch(struct konfigurasi *cfg)
+{
+    int x, y;
+
+    cfg->kolom = 1;
+    for (y = 0; y < cfg->baris; y++) {
+        for (x = cfg->kolom; x < MAKS_KOLOM; x++) {
+            if (isi[y][x][0] != '\0') {
+                cfg->kolom = x + 1;
+            }
+        }
+    }
+}
+
+/* tabel --batch MASUK [-c SEL] [-e PERINTAH]... [-o KELUARAN]
+ *
+ * Tanpa termios, alt screen maupun ioctl. MASUK dibaca dengan loader
+ * biasa, lalu opsi dijalankan berurutan: -c memindah sel aktif, -e
+ * menjalankan perintah command line (formula, lookup, SORT, FILTER,
+ * PIVOT, ...) dan mencetak hasil formula ke stdout, -o menyimpan sheet
+ * (.csv atau teks bertab) selebar kolom terakhir yang terisi, tanpa
+ * baris yang tersaring. Keluar 1 pada perintah pertama yang gagal, 2
+ * pada argumen yang salah. */
+static int jalankan_batch(int argc, char **argv)
+{
+    static struct konfigurasi cfg;
+    struct konfigurasi batas;
+    char *arg_awal[1];
+    int i, x, y, n;
+
+    if (argc < 3) {
+        cetak_penggunaan(argv[0]);
+        return 2;
+    }
+    arg_awal[0] = argv[0];
+    if (inisialisasi_data(&cfg, 1, arg_awal) != 0) {
+        return 1;
+    }
+    /* Semua baris masih menunjuk baris_kosong; cukup buka sheet ke
+     * ukuran maksimum tanpa mengalokasikan apa pun */
+    for (i = 0; i < MAKS_KOLOM; i++) {
+        lebar_kolom[i] = 8;
+    }
+    for (i = 0; i < MAKS_BARIS; i++) {
+        tinggi_baris[i] = 1;
+    }
+    cfg.kolom = MAKS_KOLOM;
+    cfg.baris = MAKS_BARIS;
+    batas = cfg;
+
+    n = akhiran_csv(argv[2]) ? baca_csv(argv[2], &cfg) : baca_txt(argv[2], &cfg);
+    if (n < 0) {
+        fprintf(stderr, "%s\n", status_msg);
+        return 1;
+    }
+
+    /* Tinggi sheet mengikuti isi file (sheet workbook selain yang
+     * pertama: baris terakhir yang terisi). Lebar tetap MAKS_KOLOM
+     * selama -e berjalan supaya hasil boleh ditulis ke kolom kosong
+     * (PIVOT ... KE H1); -o memangkasnya ke kolom terakhir yang terisi */
+    for (i = 1; i < jumlah_sheet; i++) {
+        pindah_sheet(&cfg, i);
+        for (y = MAKS_BARIS - 1; y > 0 && isi[y] == baris_kosong; y--) {
+        }
+        cfg.baris = y + 1;
+        cfg.kolom = MAKS_KOLOM;
+    }
+    pindah_sheet(&cfg, 0);
+    cfg.baris = n > 0 ? n : 1;
+    cfg.kolom = MAKS_KOLOM;
+
+    for (i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            i++;
+            if (parse_sel(&batas, argv[i], &x, &y) != 0) {
+                fprintf(stderr, "Sel tidak valid: %s\n", argv[i]);
+                return 1;
+            }
+            cfg.aktif_x = x;
+            cfg.aktif_y = y;
+            if (x >= cfg.kolom) {
+                cfg.kolom = x + 1;
+            }
+            if (y >= cfg.baris) {
+                cfg.baris = y + 1;
+            }
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            i++;
+            if (jalankan_command_line(&cfg, argv[i]) != 0) {
+                fprintf(stderr, "%s: %s\n", argv[i], status_msg);
+                return 1;
+            }
+            if (hasil_di_sel_aktif) {
+                printf("%s\n", isi[cfg.aktif_y][cfg.aktif_x]);
+            }
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            struct konfigurasi keluar = cfg;
+            i++;
+            pas_kolom_batch(&keluar);
+            if ((akhiran_csv(argv[i]) ? simpan_csv(argv[i], &keluar, 1)
+                                      : simpan_txt(argv[i], &keluar, 1)) != 0) {
+                fprintf(stderr, "%s\n", status_msg);
+                return 1;
+            }
+        } else {
+            cetak_penggunaan(argv[0]);
+            return 2;
+        }
+    }
+    return 0;
+}
+
+#ifdef TABEL_BENCH
+/* ============================================================
+ * Fungsi Benchmark Render
+ * ============================================================
+ * Build: cc -std=gnu99 -O2 -DTABEL_BENCH -o tabel-bench tabel.c -lm -pthread
+ * Jalankan: ./tabel-bench [LEBAR TINGGI [WARNA [MAKRO]]]
+ *
+ * Skenario dijalankan terhadap terminal virtual (lihat lebar_terminal,
+ * keluarkan, flush) tanpa tty. Byte, escape, panggilan tulis_buffer dan
+ * pertumbuhan buffer deterministik sehingga bisa dibandingkan antar
+ * commit; waktu per frame bergantung mesin.
+ *
+ * Startup sheet maksimum diukur lebih dulu; keluar dengan status 3 jika
+ * melewati BATAS_STARTUP_MS, atau 4 jika permintaan soket di luar sheet
+ * tidak dijawab ERR. */
+#define BATAS_STARTUP_MS 5.0
+
+struct hasil_bench {
+    unsigned long frame;
+    unsigned long tumbuh;
+    struct ukuran_render total;
+    double total_us;
+    double maks_us;
+};
+
+/* Gambar frame tertunda dan catat biayanya */
+static void bench_frame(const struct konfigurasi *cfg, struct hasil_bench *h)
+{
+    struct ukuran_render awal = ukuran;
+    unsigned long tumbuh = buffer_tumbuh;
+    double t0 = waktu_ms(), us;
+
+    gambar_frame(cfg);
+    flush();
+    us = (waktu_ms() - t0) * 1000.0;
+    h->frame++;
+    h->tumbuh += buffer_tumbuh - tumbuh;
+    h->total.byte += ukuran.byte - awal.byte;
+    h->total.escape += ukuran.escape - awal.escape;
+    h->total.tulis += ukuran.tulis - awal.tulis;
+    h->total_us += us;
+    if (us > h->maks_us) {
+        h->maks_us = us;
+    }
+}
+
+/* Mulai skenario dari A1 dengan layar baru; render awal tidak dihitung */
+static void bench_mulai(struct konfigurasi *cfg, struct hasil_bench *h)
+{
+    cfg->aktif_x = cfg->aktif_y = 0;
+    cfg->view_col = cfg->view_row = 0;
+    selecting = 0;
+    clip_has_area = 0;
+    tampil_valid = 0;
+    render(cfg);
+    flush();
+    memset(h, 0, sizeof(*h));
+}
+
+static void bench_cetak(const char *nama, const struct hasil_bench *h)
+{
+    unsigned long n = h->frame ? h->frame : 1;
+    printf("%-12s %7lu %10.1f %9.1f %8.1f %9.1f %9.1f %7lu\n", nama, h->frame,
+           (double)h->total.byte / n, (double)h->total.escape / n,
+           (double)h->total.tulis / n, h->total_us / n, h->maks_us, h->tumbuh);
+}
+
+/* Regresi: referensi di luar sheet dari klien soket harus ditolak,
+ * bukan membaca isi[] di luar batas */
+static int bench_regresi_soket(struct konfigurasi *cfg)
+{
+    static const char *const permintaan[] = {
+        "EVAL SUM A1 A99999", "EVAL :SUM C0 C6", "EVAL SUM A-1 A2",
+        "EVAL MAX A1 A10001", "GET A0", "SET A99999 x"
+    };
+    struct klien_soket k;
+    size_t i;
+    int gagal = 0;
+
+    k.fd = -1;
+    if (inisialisasi_buffer(&k.masuk, 16) != 0 ||
+        inisialisasi_buffer(&k.keluar, 256) != 0) {
+        return -1;
+    }
+    for (i = 0; i < sizeof(permintaan) / sizeof(permintaan[0]); i++) {
+        reset_buffer(&k.keluar);
+        proses_permintaan_soket(cfg, &k, permintaan[i]);
+        if (k.keluar.size < 3 || memcmp(k.keluar.data, "ERR", 3) != 0) {
+            fprintf(stderr, "Regresi soket: \"%s\" tidak ditolak\n", permintaan[i]);
+            gagal = 1;
+        }
+    }
+    bersihkan_buffer(&k.masuk);
+    bersihkan_buffer(&k.keluar);
+    return gagal ? -1 : 0;
+}
+
+static int jalankan_bench(int argc, char **argv)
+{
+    static struct konfigurasi cfg;
+    char *arg_data[3] = { "tabel", "52", "10000" };
+    struct hasil_bench h;
+    double t_startup;
+    long rss_startup;
+    int x, y, i;
+
+    if (argc >= 3) {
+        bench_lebar = atoi(argv[1]);
+        bench_tinggi = atoi(argv[2]);
+        if (bench_lebar < 20 || bench_tinggi < 8) {
+            fprintf(stderr, "Penggunaan: %s [LEBAR TINGGI [WARNA [MAKRO]]]\n", argv[0]);
+            return 1;
+        }
+    }
+    t_startup = waktu_ms();
+    if (inisialisasi_buffer(&back_buffer, 4096) != 0 ||
+        inisialisasi_data(&cfg, 3, arg_data) != 0) {
+        fprintf(stderr, "Gagal inisialisasi benchmark\n");
+        return 1;
+    }
+    siapkan_back_buffer();
+    t_startup = waktu_ms() - t_startup;
+    rss_startup = rss_kb();
+    atur_mode_warna(argc >= 4 ? atoi(argv[3]) : 24);
+
+    /* Isi tetap agar keluaran sama di setiap run */
+    for (y = 0; y < cfg.baris; y++) {
+        siapkan_baris(y);
+        for (x = 0; x < cfg.kolom; x++) {
+            if ((x + y) % 3 != 0) {
+                char teks[16];
+                snprintf(teks, sizeof(teks), "%c%d", 'A' + x, y + 1);
+                tulis_sel(x, y, teks);
+            }
+        }
+    }
+    versi_isi++;
+
+    printf("# terminal %dx%d, warna %d, sheet %dx%d\n", bench_lebar, bench_tinggi,
+           mode_warna, cfg.kolom, cfg.baris);
+    printf("# startup %.3f ms, rss %ld KB%s\n", t_startup, rss_startup,
+           t_startup > BATAS_STARTUP_MS ? " (melewati batas)" : "");
+    printf("%-12s %7s %10s %9s %8s %9s %9s %7s\n", "skenario", "frame",
+           "byte/fr", "esc/fr", "tulis/fr", "us/fr", "us_maks", "tumbuh");
+
+    /* Gulir seluruh sheet satu baris per frame, turun lalu naik */
+    bench_mulai(&cfg, &h);
+    for (i = 1; i < cfg.baris; i++) {
+        navigasi_panah(&cfg, 'B');
+        bench_frame(&cfg, &h);
+    }
+    bench_cetak("gulir_turun", &h);
+    memset(&h, 0, sizeof(h));
+    for (i = 1; i < cfg.baris; i++) {
+        navigasi_panah(&cfg, 'A');
+        bench_frame(&cfg, &h);
+    }
+    bench_cetak("gulir_naik", &h);
+
+    /* Seleksi 1000 baris x 50 kolom, satu sel per frame */
+    bench_mulai(&cfg, &h);
+    aksi_seleksi(&cfg);
+    for (i = 1; i < 1000; i++) {
+        navigasi_panah(&cfg, 'B');
+        bench_frame(&cfg, &h);
+    }
+    for (i = 1; i < 50; i++) {
+        navigasi_panah(&cfg, 'C');
+        bench_frame(&cfg, &h);
+    }
+    bench_cetak("seleksi", &h);
+
+    /* Tempel blok 8x20 menuruni sheet; area clipboard dipakai ulang */
+    bench_mulai(&cfg, &h);
+    aksi_seleksi(&cfg);
+    for (i = 1; i < 20; i++) {
+        navigasi_panah(&cfg, 'B');
+    }
+    for (i = 1; i < 8; i++) {
+        navigasi_panah(&cfg, 'C');
+    }
+    frame_tertunda = FRAME_TIDAK;
+    aksi_copy(&cfg);
+    for (i = 0; i < 200; i++) {
+        cfg.aktif_x = (i * 5) % (cfg.kolom - 8);
+        cfg.aktif_y = 20 + i * 20;
+        ensure_active_visible(&cfg);
+        clip_has_area = 1;
+        aksi_paste(&cfg);
+        minta_frame(FRAME_PENUH);
+        bench_frame(&cfg, &h);
+    }
+    bench_cetak("tempel", &h);
+
+    /* Putar makro rekaman lewat loop utama; output tertahan sampai
+     * antrean habis sehingga hanya frame terakhir yang digambar */
+    if (argc >= 5) {
+        struct ukuran_render awal;
+        double t0;
+
+        bench_mulai(&cfg, &h);
+        if (buka_makro(0, argv[4]) != 0 || putar_makro(0, 1) != 0) {
+            fprintf(stderr, "%s\n", status_msg);
+            return 1;
+        }
+        awal = ukuran;
+        waktu_frame_terakhir = 0.0;
+        t0 = waktu_ms();
+        loop(&cfg);
+        h.frame = 1;
+        h.total_us = h.maks_us = (waktu_ms() - t0) * 1000.0;
+        h.total.byte = ukuran.byte - awal.byte;
+        h.total.escape = ukuran.escape - awal.escape;
+        h.total.tulis = ukuran.tulis - awal.tulis;
+        bench_cetak("makro", &h);
+    }
+
+    bersihkan_buffer(&back_buffer);
+    if (bench_regresi_soket(&cfg) != 0) {
+        return 4;
     }
+    return t_startup > BATAS_STARTUP_MS ? 3 : 0;
 }
+#endif
 
 /* ============================================================
  * Fungsi Utama
@@ -2529,7 +9075,46 @@ static int loop(struct konfigurasi *cfg)
 int main(int argc, char *argv[])
 {
     struct konfigurasi cfg;
-    int st;
+    const char *jalur = NULL, *sumber = NULL;
+    int st, i, n, batas = 0;
+
+    buka_jejak();
+#ifdef TABEL_BENCH
+    st = jalankan_bench(argc, argv);
+    tutup_jejak();
+    return st;
+#endif
+
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        st = jalankan_batch(argc, argv);
+        tutup_jejak();
+        return st;
+    }
+
+    /* Opsi boleh di mana saja; sisanya KOL BAR seperti biasa */
+    for (i = 1, n = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--socket") == 0 || strcmp(argv[i], "-f") == 0 ||
+             strcmp(argv[i], "-n") == 0) && i + 1 >= argc) {
+            cetak_penggunaan(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--socket") == 0) {
+            jalur = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0) {
+            sumber = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0) {
+            batas = atoi(argv[++i]);
+        } else {
+            argv[n++] = argv[i];
+        }
+    }
+    argv[n] = NULL;
+    argc = n;
+
+    /* Sebelum termios: -f - mengganti stdin dengan /dev/tty */
+    if (sumber && buka_tail(sumber, batas) != 0) {
+        return 1;
+    }
 
     signal(SIGINT, tangani_sinyal);
     signal(SIGTERM, tangani_sinyal);
@@ -2544,20 +9129,29 @@ int main(int argc, char *argv[])
         pulihkan_terminal();
         return 1;
     }
+    siapkan_back_buffer();
 
     if (inisialisasi_data(&cfg, argc, argv) != 0) {
-        fprintf(stderr, "Penggunaan: %s [KOL] [BAR]\n", argv[0]);
+        cetak_penggunaan(argv[0]);
         bersihkan_buffer(&back_buffer);
         pulihkan_terminal();
         return 1;
     }
 
+    deteksi_sinkron_output();
+    atur_mode_warna(0);
+    if (jalur) {
+        buka_server_soket(jalur);
+    }
     masuk_alt();
     bersih();
     render(&cfg);
 
     st = loop(&cfg);
 
+    tutup_server_soket();
+    tutup_tail();
+    tutup_jejak();
     bersihkan_buffer(&back_buffer);
     pulihkan_terminal();
     keluar_alt();